@@ -0,0 +1,265 @@
+/* Copyright (c) 2012 - 2013 by William Hallatt.
+ *
+ * This file forms part of "XML Mill".
+ *
+ * The official website for this project is <http://www.goblincoding.com> and,
+ * although not compulsory, it would be appreciated if all works of whatever
+ * nature using this source code (in whole or in part) include a reference to
+ * this site.
+ *
+ * Should you wish to contact me for whatever reason, please do so via:
+ *
+ *                 <http://www.goblincoding.com/contact>
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program (GNUGPL.txt).  If not, see
+ *
+ *                    <http://www.gnu.org/licenses/>
+ */
+
+#include "gcattributepolicy.h"
+
+#include <QDateTime>
+#include <QRegularExpression>
+
+/*--------------------------------------------------------------------------------------*/
+
+const int GCAttributePolicy::ENUM_VALUES( 20 );
+const int GCAttributePolicy::COMPACT_VALUES( 100 );
+const int GCAttributePolicy::TEXT_VALUES( 1000 );
+const int GCAttributePolicy::PROTECTION_PERIOD( 30 * 24 * 60 * 60 );   // thirty days
+
+/* With or without braces, e.g. "{21EC2020-3AEA-1069-A2DD-08002B30309D}". */
+static const QRegularExpression GUID_PATTERN(
+  "^\\{?[0-9a-fA-F]{8}-[0-9a-fA-F]{4}-[0-9a-fA-F]{4}-[0-9a-fA-F]{4}-[0-9a-fA-F]{12}\\}?$" );
+
+/*--------------------------------- MEMBER FUNCTIONS ----------------------------------*/
+
+GCAttributePolicy::GCAttributePolicy()
+: m_flags   ( 0 ),
+  m_hasRange( false ),
+  m_minimum ( 0.0 ),
+  m_maximum ( 0.0 )
+{
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+GCAttributePolicy::GCAttributePolicy( int flags, const QVariant& minimum, const QVariant& maximum )
+: m_flags   ( flags ),
+  m_hasRange( !minimum.isNull() && !maximum.isNull() ),
+  m_minimum ( minimum.toDouble() ),
+  m_maximum ( maximum.toDouble() )
+{
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCAttributePolicy::addValue( const QString& value )
+{
+  /* Checks are skipped once their types have been ruled out (these are done for every
+    value of every import, so it's worth the trouble). */
+  if( !( m_flags & NotBoolean ) &&
+      value != "true" && value != "false" && value != "0" && value != "1" )  // as per xs:boolean
+  {
+    m_flags |= NotBoolean;
+  }
+
+  bool isNumber = false;
+
+  if( !( m_flags & NotNumber ) )
+  {
+    double number = value.toDouble( &isNumber );
+
+    if( isNumber )
+    {
+      addToRange( number );
+    }
+    else
+    {
+      m_flags |= NotNumber;
+    }
+  }
+
+  if( !( m_flags & NotInteger ) )
+  {
+    bool isInteger = false;
+    value.toLongLong( &isInteger );
+
+    if( !isInteger )
+    {
+      m_flags |= NotInteger;
+    }
+  }
+
+  if( !( m_flags & NotTimestamp ) )
+  {
+    /* The date part is required, otherwise years would also pass as timestamps. */
+    QDateTime timestamp;
+
+    if( !isNumber && value.size() >= 10 && value.at( 4 ) == '-' )
+    {
+      timestamp = QDateTime::fromString( value, Qt::ISODate );
+    }
+
+    if( timestamp.isValid() )
+    {
+      addToRange( timestamp.toMSecsSinceEpoch() );
+    }
+    else
+    {
+      m_flags |= NotTimestamp;
+    }
+  }
+
+  if( !( m_flags & NotIdentifier ) && !GUID_PATTERN.match( value ).hasMatch() )
+  {
+    m_flags |= NotIdentifier;
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCAttributePolicy::merge( const GCAttributePolicy& other )
+{
+  m_flags |= other.m_flags;
+
+  if( other.m_hasRange )
+  {
+    addToRange( other.m_minimum );
+    addToRange( other.m_maximum );
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+int GCAttributePolicy::flags() const
+{
+  return m_flags;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QVariant GCAttributePolicy::minimum() const
+{
+  return m_hasRange ? QVariant( m_minimum ) : QVariant( QVariant::Double );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QVariant GCAttributePolicy::maximum() const
+{
+  return m_hasRange ? QVariant( m_maximum ) : QVariant( QVariant::Double );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+GCAttributePolicy::Type GCAttributePolicy::type( int distinctValues ) const
+{
+  /* Without values, nothing has been ruled out yet. */
+  if( distinctValues == 0 )
+  {
+    return TextType;
+  }
+
+  if( !( m_flags & NotBoolean ) )
+  {
+    return BooleanType;
+  }
+
+  if( !( m_flags & NotInteger ) )
+  {
+    return IntegerType;
+  }
+
+  if( !( m_flags & NotNumber ) )
+  {
+    return NumberType;
+  }
+
+  if( !( m_flags & NotTimestamp ) )
+  {
+    return TimestampType;
+  }
+
+  if( !( m_flags & NotIdentifier ) )
+  {
+    return IdentifierType;
+  }
+
+  return ( distinctValues <= ENUM_VALUES ) ? EnumType : TextType;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+int GCAttributePolicy::valueLimit() const
+{
+  return valueLimit( m_flags );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+int GCAttributePolicy::valueLimit( int flags )
+{
+  return ( ( flags & NotCompact ) == NotCompact ) ? TEXT_VALUES : COMPACT_VALUES;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+uint GCAttributePolicy::protectionCutoff()
+{
+  return QDateTime::currentDateTimeUtc().toTime_t() - PROTECTION_PERIOD;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QString GCAttributePolicy::description( int distinctValues ) const
+{
+  switch( type( distinctValues ) )
+  {
+    case BooleanType:
+      return QString( "Boolean" );
+    case IntegerType:
+      return QString( "Integer values from %1 to %2" ).arg( qint64( m_minimum ) ).arg( qint64( m_maximum ) );
+    case NumberType:
+      return QString( "Numeric values from %1 to %2" ).arg( m_minimum ).arg( m_maximum );
+    case TimestampType:
+      return QString( "Timestamps from %1 to %2" )
+        .arg( QDateTime::fromMSecsSinceEpoch( qint64( m_minimum ) ).toString( Qt::ISODate ) )
+        .arg( QDateTime::fromMSecsSinceEpoch( qint64( m_maximum ) ).toString( Qt::ISODate ) );
+    case IdentifierType:
+      return QString( "Identifiers (GUIDs)" );
+    case EnumType:
+      return QString( "One of %1 values" ).arg( distinctValues );
+    default:
+      return QString( "Text" );
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCAttributePolicy::addToRange( double value )
+{
+  if( !m_hasRange )
+  {
+    m_minimum = value;
+    m_maximum = value;
+    m_hasRange = true;
+  }
+  else
+  {
+    m_minimum = qMin( m_minimum, value );
+    m_maximum = qMax( m_maximum, value );
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
\ No newline at end of file
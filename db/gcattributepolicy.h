@@ -0,0 +1,143 @@
+/* Copyright (c) 2012 - 2013 by William Hallatt.
+ *
+ * This file forms part of "XML Mill".
+ *
+ * The official website for this project is <http://www.goblincoding.com> and,
+ * although not compulsory, it would be appreciated if all works of whatever
+ * nature using this source code (in whole or in part) include a reference to
+ * this site.
+ *
+ * Should you wish to contact me for whatever reason, please do so via:
+ *
+ *                 <http://www.goblincoding.com/contact>
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program (GNUGPL.txt).  If not, see
+ *
+ *                    <http://www.gnu.org/licenses/>
+ */
+
+#ifndef GCATTRIBUTEPOLICY_H
+#define GCATTRIBUTEPOLICY_H
+
+#include <QString>
+#include <QVariant>
+
+/// Describes the kind of values an attribute takes and how many of them are worth keeping.
+
+/**
+  Attributes such as numeric IDs, timestamps and GUIDs take a different value in just about
+  every document, which means that storing every value ever encountered grows a profile without
+  bounds (while adding very little of value to the user).  This class infers an attribute's type
+  from its values and derives the number of values that should be kept for it:
+
+    * boolean, numeric, timestamp and identifier (GUID) attributes are described by their type
+      (and, where it makes sense, by the range of the values encountered) and only their most
+      frequently used values are kept (see COMPACT_VALUES).
+
+    * free text attributes keep up to TEXT_VALUES of their most frequently used values (with
+      few enough values, they are treated as enumerations).
+
+  The type is tracked as a set of flags, each ruling out one of the types, so that policies are
+  merged by simply combining their flags (which is also how the database merges them).
+*/
+class GCAttributePolicy
+{
+public:
+  /*! The inferred attribute types, from the most to the least specific. */
+  enum Type
+  {
+    BooleanType,
+    IntegerType,
+    NumberType,
+    TimestampType,
+    IdentifierType,
+    EnumType,
+    TextType
+  };
+
+  /*! Each flag rules out a type (flags are never cleared once set). */
+  enum Flag
+  {
+    NotBoolean    = 0x01,
+    NotInteger    = 0x02,
+    NotNumber     = 0x04,
+    NotTimestamp  = 0x08,
+    NotIdentifier = 0x10,
+    NotCompact    = 0x1F    // free text, i.e. all of the above
+  };
+
+  /*! Attributes with (at most) this many distinct text values are considered enumerations. */
+  static const int ENUM_VALUES;
+
+  /*! The number of values kept for boolean, numeric, timestamp and identifier attributes. */
+  static const int COMPACT_VALUES;
+
+  /*! The number of values kept for free text attributes. */
+  static const int TEXT_VALUES;
+
+  /*! Values the user assigned within this many seconds are kept no matter how rarely they have been
+      used (and in addition to the values allowed by "valueLimit"), so that a new value doesn't get
+      evicted as soon as it is entered. */
+  static const int PROTECTION_PERIOD;
+
+  /*! Constructor.  Creates a policy that doesn't rule anything out (yet). */
+  GCAttributePolicy();
+
+  /*! Constructor.  Recreates a policy from its stored "flags" and range (null variants if the
+      policy doesn't have a range). */
+  GCAttributePolicy( int flags, const QVariant& minimum, const QVariant& maximum );
+
+  /*! Updates the flags and range with "value". */
+  void addValue( const QString& value );
+
+  /*! Merges "other" into this policy. */
+  void merge( const GCAttributePolicy& other );
+
+  /*! Returns the flags ruling out types (see Flag). */
+  int flags() const;
+
+  /*! Returns the smallest numeric value (or timestamp in milliseconds since the epoch) encountered,
+      or a null variant if there is no range. */
+  QVariant minimum() const;
+
+  /*! Returns the largest numeric value (or timestamp in milliseconds since the epoch) encountered,
+      or a null variant if there is no range. */
+  QVariant maximum() const;
+
+  /*! Returns the inferred type of an attribute with "distinctValues" known values. */
+  Type type( int distinctValues ) const;
+
+  /*! Returns the maximum number of values that should be kept. */
+  int valueLimit() const;
+
+  /*! Returns a short, user friendly description of the attribute's type and range. */
+  QString description( int distinctValues ) const;
+
+  /*! Returns the maximum number of values that should be kept for an attribute with "flags". */
+  static int valueLimit( int flags );
+
+  /*! Returns the time (in seconds since the epoch) from which assigned values are protected from
+      eviction (see PROTECTION_PERIOD). */
+  static uint protectionCutoff();
+
+private:
+  /*! Extends the range to include "value". */
+  void addToRange( double value );
+
+  int m_flags;
+  bool m_hasRange;
+  double m_minimum;
+  double m_maximum;
+};
+
+#endif // GCATTRIBUTEPOLICY_H
\ No newline at end of file
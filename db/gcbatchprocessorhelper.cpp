@@ -27,59 +27,292 @@
  */
 
 #include "gcbatchprocessorhelper.h"
+#include "gcprofilecache.h"
+#include "gcattributepolicy.h"
 
 #include <QDomDocument>
+#include <QXmlStreamReader>
+#include <QStack>
+#include <QFile>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentMap>
+
+/*--------------------------------------------------------------------------------------*/
+
+/* The number of elements processed between progress reports (and cancellation checks). */
+static const int PROGRESS_INTERVAL( 1000 );
 
 /*--------------------------------- MEMBER FUNCTIONS ----------------------------------*/
 
 GCBatchProcessorHelper::GCBatchProcessorHelper( const QDomDocument* domDoc,
-                                                const QString& stringListSeparator,
-                                                const QStringList& knownElements,
-                                                const QStringList& knownAttributes )
-: m_stringListSeparator       ( stringListSeparator ),
-  m_knownElements             ( knownElements ),
-  m_knownAttributeKeys        ( knownAttributes ),
-  m_newElementsToAdd          (),
-  m_newElementChildrenToAdd   (),
-  m_newElementAttributesToAdd (),
-  m_elementsToUpdate          (),
-  m_elementChildrenToUpdate   (),
-  m_elementAttributesToUpdate (),
-  m_newAttributeKeysToAdd     (),
-  m_newAssociatedElementsToAdd(),
-  m_newAttributeValuesToAdd   (),
-  m_attributeKeysToUpdate     (),
-  m_associatedElementsToUpdate(),
-  m_attributeValuesToUpdate   (),
-  m_unsorted                  (),
-  m_records                   ()
+                                                const QSet< QString >& knownElements,
+                                                const GCRelationshipKeySet& knownChildKeys,
+                                                const GCRelationshipKeySet& knownAttributeKeys,
+                                                int contextDepth )
+: m_extraction                 (),
+  m_contextDepth               ( contextDepth ),
+  m_knownElements              ( knownElements ),
+  m_knownChildKeys             ( knownChildKeys ),
+  m_knownAttributeKeys         ( knownAttributeKeys ),
+  m_newElementsToAdd           (),
+  m_newChildParentsToAdd       (),
+  m_newChildElementsToAdd      (),
+  m_newAttributeElementsToAdd  (),
+  m_newAttributesToAdd         (),
+  m_attributeValueElementsToAdd(),
+  m_attributeValueKeysToAdd    (),
+  m_attributeValuesToAdd       (),
+  m_attributeValueCountsToAdd  (),
+  m_policyElementsToAdd        (),
+  m_policyAttributesToAdd      (),
+  m_policyFlagsToAdd           (),
+  m_policyMinimumsToAdd        (),
+  m_policyMaximumsToAdd        (),
+  m_contextsToAdd              (),
+  m_contextChildContextsToAdd  (),
+  m_contextChildrenToAdd       (),
+  m_contextValueContextsToAdd  (),
+  m_contextValueAttributesToAdd(),
+  m_contextValuesToAdd         ()
 {
   QDomElement root = domDoc->documentElement();
-  createRecord( root );
-  processElement( root );   // kicks off a chain of recursive DOM element traversals
-  sortRecords();
+  QString rootContext = ( m_contextDepth > 0 ) ? GCProfileCache::childContext( QString(), root.tagName(), m_contextDepth ) : QString();
+
+  m_extraction.rootElements << root.tagName();
+  createRecord( root, rootContext );
+  processElement( root, rootContext );   // kicks off a chain of recursive DOM element traversals
+  createVariantLists();
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+GCBatchProcessorHelper::GCBatchProcessorHelper( QXmlStreamReader* reader,
+                                                const QSet< QString >& knownElements,
+                                                const GCRelationshipKeySet& knownChildKeys,
+                                                const GCRelationshipKeySet& knownAttributeKeys,
+                                                int contextDepth,
+                                                GCBatchProgress* progress )
+: m_extraction                 (),
+  m_contextDepth               ( contextDepth ),
+  m_knownElements              ( knownElements ),
+  m_knownChildKeys             ( knownChildKeys ),
+  m_knownAttributeKeys         ( knownAttributeKeys ),
+  m_newElementsToAdd           (),
+  m_newChildParentsToAdd       (),
+  m_newChildElementsToAdd      (),
+  m_newAttributeElementsToAdd  (),
+  m_newAttributesToAdd         (),
+  m_attributeValueElementsToAdd(),
+  m_attributeValueKeysToAdd    (),
+  m_attributeValuesToAdd       (),
+  m_attributeValueCountsToAdd  (),
+  m_policyElementsToAdd        (),
+  m_policyAttributesToAdd      (),
+  m_policyFlagsToAdd           (),
+  m_policyMinimumsToAdd        (),
+  m_policyMaximumsToAdd        (),
+  m_contextsToAdd              (),
+  m_contextChildContextsToAdd  (),
+  m_contextChildrenToAdd       (),
+  m_contextValueContextsToAdd  (),
+  m_contextValueAttributesToAdd(),
+  m_contextValuesToAdd         ()
+{
+  processStream( reader, m_extraction, m_contextDepth, progress );
+
+  if( !m_extraction.canceled )
+  {
+    createVariantLists();
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+GCBatchProcessorHelper::GCBatchProcessorHelper( const QStringList& fileNames,
+                                                const QSet< QString >& knownElements,
+                                                const GCRelationshipKeySet& knownChildKeys,
+                                                const GCRelationshipKeySet& knownAttributeKeys,
+                                                int contextDepth,
+                                                GCBatchProgress* progress )
+: m_extraction                 (),
+  m_contextDepth               ( contextDepth ),
+  m_knownElements              ( knownElements ),
+  m_knownChildKeys             ( knownChildKeys ),
+  m_knownAttributeKeys         ( knownAttributeKeys ),
+  m_newElementsToAdd           (),
+  m_newChildParentsToAdd       (),
+  m_newChildElementsToAdd      (),
+  m_newAttributeElementsToAdd  (),
+  m_newAttributesToAdd         (),
+  m_attributeValueElementsToAdd(),
+  m_attributeValueKeysToAdd    (),
+  m_attributeValuesToAdd       (),
+  m_attributeValueCountsToAdd  (),
+  m_policyElementsToAdd        (),
+  m_policyAttributesToAdd      (),
+  m_policyFlagsToAdd           (),
+  m_policyMinimumsToAdd        (),
+  m_policyMaximumsToAdd        (),
+  m_contextsToAdd              (),
+  m_contextChildContextsToAdd  (),
+  m_contextChildrenToAdd       (),
+  m_contextValueContextsToAdd  (),
+  m_contextValueAttributesToAdd(),
+  m_contextValuesToAdd         ()
+{
+  /* Each file is parsed and consolidated on its own, after which the per-file results are
+    merged into one (QtConcurrent serialises the calls to the reduce function, so no locking
+    is required).  The order in which the results are merged doesn't matter. */
+  QFuture< Extraction > future = QtConcurrent::mappedReduced( fileNames,
+                                                              FileExtractor( m_contextDepth ),
+                                                              &GCBatchProcessorHelper::mergeExtraction,
+                                                              QtConcurrent::UnorderedReduce );
+
+  if( progress )
+  {
+    progress->setProgressRange( 0, fileNames.size() );
+
+    /* The files are processed by the thread pool, so all we can do here is keep an eye on things. */
+    while( !future.isFinished() )
+    {
+      if( progress->isCanceled() )
+      {
+        future.cancel();
+        future.waitForFinished();
+        m_extraction.canceled = true;
+        return;
+      }
+
+      progress->setProgressValue( future.progressValue() );
+      QThread::msleep( 50 );
+    }
+  }
+
+  m_extraction = future.result();
   createVariantLists();
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-void GCBatchProcessorHelper::processElement( const QDomElement& parentElement )
+const QStringList& GCBatchProcessorHelper::rootElements() const
+{
+  return m_extraction.rootElements;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+const QStringList& GCBatchProcessorHelper::errors() const
+{
+  return m_extraction.errors;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCBatchProcessorHelper::wasCanceled() const
+{
+  return m_extraction.canceled;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCBatchProcessorHelper::isCompatible( const QDomDocument* domDoc, const GCProfileCache& profile, QStringList* differences )
+{
+  bool compatible = isCompatible( domDoc->documentElement(), QString(), profile, differences );
+
+  if( differences )
+  {
+    differences->removeDuplicates();
+  }
+
+  return compatible;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCBatchProcessorHelper::isCompatible( QXmlStreamReader* reader, const GCProfileCache& profile, QStringList* differences, GCBatchProgress* progress )
+{
+  /* See "processStream". */
+  reader->setNamespaceProcessing( false );
+
+  QStack< QString > parents;
+  int elementCount = 0;
+  bool compatible = true;
+
+  while( !reader->atEnd() )
+  {
+    reader->readNext();
+
+    if( reader->isStartElement() )
+    {
+      if( progress && ++elementCount % PROGRESS_INTERVAL == 0 )
+      {
+        if( progress->isCanceled() )
+        {
+          return false;
+        }
+
+        progress->setProgressValue( static_cast< int >( reader->characterOffset() ) );
+      }
+
+      QString element = reader->qualifiedName().toString();
+      QStringList attributes;
+
+      foreach( QXmlStreamAttribute attribute, reader->attributes() )
+      {
+        attributes << attribute.qualifiedName().toString();
+      }
+
+      if( !isKnown( profile, parents.isEmpty() ? QString() : parents.top(), element, attributes, differences ) )
+      {
+        compatible = false;
+
+        /* No need to read any further if the caller only wants to know yes or no. */
+        if( !differences )
+        {
+          return false;
+        }
+      }
+
+      parents.push( element );
+    }
+    else if( reader->isEndElement() )
+    {
+      parents.pop();
+    }
+  }
+
+  if( differences )
+  {
+    differences->removeDuplicates();
+  }
+
+  return ( compatible && !reader->hasError() );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCBatchProcessorHelper::processElement( const QDomElement& parentElement, const QString& parentContext )
 {
   QDomElement element = parentElement.firstChildElement();
 
   while( !element.isNull() )
   {
-    createRecord( element );
-    processElement( element );
+    QString context = ( m_contextDepth > 0 ) ? GCProfileCache::childContext( parentContext, element.tagName(), m_contextDepth ) : QString();
+    createRecord( element, context );
+    processElement( element, context );
     element = element.nextSiblingElement();
   }
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-void GCBatchProcessorHelper::createRecord( const QDomElement& element )
+void GCBatchProcessorHelper::createRecord( const QDomElement& element, const QString& context )
 {
-  ElementRecord record;
+  /* Creates a new record if this is the first time we encounter an element of this name. */
+  ElementRecord& record = m_extraction.records[ element.tagName() ];
+
+  /* The contexts live in a hash of their own, so the two references can't invalidate each other. */
+  ElementRecord* contextRecord = context.isEmpty() ? 0 : &m_extraction.contexts[ context ];
 
   /* Stick the attributes and their corresponding values into the record map. */
   QDomNamedNodeMap attributeNodes = element.attributes();
@@ -90,7 +323,12 @@ void GCBatchProcessorHelper::createRecord( const QDomElement& element )
 
     if( !attribute.isNull() )
     {
-      record.attributes.insert( attribute.name(), QStringList( attribute.value() ) );
+      ++record.attributes[ attribute.name() ][ attribute.value() ];
+
+      if( contextRecord )
+      {
+        ++contextRecord->attributes[ attribute.name() ][ attribute.value() ];
+      }
     }
   }
 
@@ -103,207 +341,388 @@ void GCBatchProcessorHelper::createRecord( const QDomElement& element )
 
     if( child.isElement() )
     {
-      record.children.append( child.toElement().tagName() );
+      record.children.insert( child.toElement().tagName() );
+
+      if( contextRecord )
+      {
+        contextRecord->children.insert( child.toElement().tagName() );
+      }
     }
   }
-
-  /* We'll sort it all later, for now get the recursive calls out of the way. */
-  m_unsorted.insert( element.tagName(), record );
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-void GCBatchProcessorHelper::sortRecords()
+bool GCBatchProcessorHelper::isCompatible( const QDomElement& element, const QString& parent, const GCProfileCache& profile, QStringList* differences )
 {
-  /* We inserted every element in the DOM doc into the unsorted map and will almost
-    definitely have duplicates.  Since the DB requires unique element entries (elements
-    are the primary keys), we iterate through the unique keys and consolidate the entries
-    per element. */
-  foreach( QString element, m_unsorted.uniqueKeys() )
+  QStringList attributes;
+  QDomNamedNodeMap attributeNodes = element.attributes();
+
+  for( int i = 0; i < attributeNodes.size(); ++i )
+  {
+    QDomAttr attribute = attributeNodes.item( i ).toAttr();
+
+    if( !attribute.isNull() )
+    {
+      attributes << attribute.name();
+    }
+  }
+
+  bool compatible = isKnown( profile, parent, element.tagName(), attributes, differences );
+
+  if( !compatible && !differences )
   {
-   /* Retrieve all the records associated with this element. */
-   QList< ElementRecord > duplicateRecords = m_unsorted.values( element );
-
-   /* If we have more than one record for the same element, then we need to consolidate
-     all the attributes associated with this particular element. */
-   if( duplicateRecords.size() > 1 )
-   {
-     ElementRecord record;
-
-     /* Just stick all the attributes and their values into a map for now
-       so that we don't have to run the consolidation functionality on
-       each iteration...that would just be silly... */
-     QMultiMap< QString, QStringList > recordAttributes;
-
-     for( int i = 0; i < duplicateRecords.size(); ++i )
-     {
-       recordAttributes += duplicateRecords.at( i ).attributes;
-
-       /* Don't consolidate the attribute values here (see above comment) but since
-         we're already iterating through the list, we may as well consolidate the
-         children while we're at it (they are relatively simple to handle compared
-         to the attribute value maps). */
-       record.children.append( duplicateRecords.at( i ).children );
-     }
-
-     record.children.removeDuplicates();
-
-     /* Now we can sort out the chaos. For each unique attribute, we will obtain
-       the associated QStringList(s) of attribute values and consolidate the lot. */
-     foreach( QString attribute, recordAttributes.uniqueKeys() )
-     {
-      QList< QStringList > attributeValues = recordAttributes.values( attribute );
-      QStringList finalListOfAttributeValues;
-
-      for( int j = 0; j < attributeValues.size(); ++j )
+    return false;
+  }
+
+  QDomElement child = element.firstChildElement();
+
+  while( !child.isNull() )
+  {
+    if( !isCompatible( child, element.tagName(), profile, differences ) )
+    {
+      compatible = false;
+
+      if( !differences )
       {
-        finalListOfAttributeValues.append( attributeValues.at( j ) );
+        return false;
       }
+    }
 
-      finalListOfAttributeValues.removeDuplicates();
-      record.attributes.insert( attribute, finalListOfAttributeValues );
-     }
-
-     m_records.insert( element, record );
-   }
-   else
-   {
-     /* If we only have one entry for this particular element name, we can
-       safely insert it into the sorted map. */
-     ElementRecord record = duplicateRecords.at( 0 );
-     record.children.removeDuplicates();
-     m_records.insert( element, record );
-   }
+    child = child.nextSiblingElement();
   }
+
+  return compatible;
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-void GCBatchProcessorHelper::createVariantLists()
+bool GCBatchProcessorHelper::isKnown( const GCProfileCache& profile,
+                                      const QString& parent,
+                                      const QString& element,
+                                      const QStringList& attributes,
+                                      QStringList* differences )
 {
-  /* First see which of the records we created from the DOM doc are completely new
-    and which ones we have prior knowledge of. */
-  QList< QString > elementNames = m_records.keys();
+  bool known = true;
 
-  for( int i = 0; i < elementNames.size(); ++i )
+  if( !profile.containsElement( element ) )
   {
-    if( !m_knownElements.contains( elementNames.at( i ) ) )
-    {
-      m_newElementsToAdd << elementNames.at( i );
-    }
-    else
+    if( !differences )
     {
-      m_elementsToUpdate << elementNames.at( i );
+      return false;
     }
+
+    differences->append( QString( "Unknown element \"%1\"" ).arg( element ) );
+    known = false;
   }
 
-  /* Deal with all the new elements first. */
-  foreach( QVariant var, m_newElementsToAdd )
+  if( !parent.isEmpty() && !profile.containsChild( parent, element ) )
   {
-   QString element = var.toString();
-
-   /* Do we have first level children? */
-   if( !m_records.value( element ).children.isEmpty() )
-   {
-     m_newElementChildrenToAdd << m_records.value( element ).children.join( m_stringListSeparator );
-   }
-   else
-   {
-     /* To keep the indices in sync, the following will result in a NULL value
-       being bound to the relevant prepared query on the DB side (we need to have
-       exactly the same number of items in all lists associated with the "new elements"
-       in order for the batch bind to succeed). The same argument holds for the
-       "elements to update" and two types of attribute lists below. */
-     m_newElementChildrenToAdd << QVariant( QVariant::String );
-   }
-
-   /* Do we have associated attributes? */
-   if( !m_records.value( element ).attributes.keys().isEmpty() )
-   {
-     QStringList attributeNames = m_records.value( element ).attributes.keys();
-     m_newElementAttributesToAdd << attributeNames.join( m_stringListSeparator );
-   }
-   else
-   {
-     /* See comment for "m_newElementChildrenToAdd" above.*/
-     m_newElementAttributesToAdd << QVariant( QVariant::String );
-   }
+    if( !differences )
+    {
+      return false;
+    }
+
+    differences->append( QString( "Unknown child \"%1\" of element \"%2\"" ).arg( element ).arg( parent ) );
+    known = false;
   }
 
-  /* Now we deal with all the elements that will have to be updated. */
-  foreach( QVariant var, m_elementsToUpdate )
+  foreach( QString attribute, attributes )
   {
-   QString element = var.toString();
-
-   /* Do we have first level children? */
-   if( !m_records.value( element ).children.isEmpty() )
-   {
-     m_elementChildrenToUpdate << m_records.value( element ).children.join( m_stringListSeparator );
-   }
-   else
-   {
-     /* See comment for "m_newElementChildrenToAdd" above.*/
-     m_elementChildrenToUpdate << QVariant( QVariant::String );
-   }
-
-   /* Do we have associated attributes? */
-   if( !m_records.value( element ).attributes.keys().isEmpty() )
-   {
-     QStringList attributeNames = m_records.value( element ).attributes.keys();
-     m_elementAttributesToUpdate << attributeNames.join( m_stringListSeparator );
-   }
-   else
-   {
-     /* See comment for "m_newElementChildrenToAdd" above.*/
-     m_elementAttributesToUpdate << QVariant( QVariant::String );
-   }
+    if( !profile.containsAttribute( element, attribute ) )
+    {
+      if( !differences )
+      {
+        return false;
+      }
+
+      differences->append( QString( "Unknown attribute \"%1\" of element \"%2\"" ).arg( attribute ).arg( element ) );
+      known = false;
+    }
   }
 
-  /* Separate the new attribute keys and associated values from the existing ones. */
-  foreach( QString element, elementNames )
+  return known;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCBatchProcessorHelper::processStream( QXmlStreamReader* reader, Extraction& extraction, int contextDepth, GCBatchProgress* progress )
+{
+  /* We want the same element and attribute names that we'd get from a DOM document (which
+    doesn't process namespaces either when the content is set from text). */
+  reader->setNamespaceProcessing( false );
+
+  /* The top of the stack is the parent of the next start element we encounter (the context stack
+    is kept in step with it, but only if contexts are recorded at all). */
+  QStack< QString > parents;
+  QStack< QString > contexts;
+  int elementCount = 0;
+
+  while( !reader->atEnd() )
   {
-    QList< QString > attributeNames = m_records.value( element ).attributes.keys();
+    reader->readNext();
 
-    foreach( QString attribute, attributeNames )
+    if( reader->isStartElement() )
     {
-      QStringList attributeValues = m_records.value( element ).attributes.value( attribute );
-      attributeValues.removeDuplicates();
-
-      /* Do we know about this attribute? (by the way, the "!" is a separator
-        used to create a unique string name from the element and associated
-        attribute for ease of comparison with the attribute keys list we get
-        given...this is not ideal, but the only solution I have at the moment. */
-      if( !m_knownAttributeKeys.contains( attribute + "!" + element ) )
+      /* Don't bother the progress reporter with every single element. */
+      if( progress && ++elementCount % PROGRESS_INTERVAL == 0 )
       {
-        m_newAttributeKeysToAdd << attribute;
-        m_newAssociatedElementsToAdd << element;
+        if( progress->isCanceled() )
+        {
+          extraction.canceled = true;
+          return;
+        }
 
-        if( !attributeValues.isEmpty() )
+        progress->setProgressValue( static_cast< int >( reader->characterOffset() ) );
+      }
+
+      QString element = reader->qualifiedName().toString();
+      QXmlStreamAttributes attributes = reader->attributes();
+
+      /* Creates a new record if this is the first time we encounter an element of this name. */
+      ElementRecord& record = extraction.records[ element ];
+
+      foreach( QXmlStreamAttribute attribute, attributes )
+      {
+        ++record.attributes[ attribute.qualifiedName().toString() ][ attribute.value().toString() ];
+      }
+
+      /* Don't use "record" beyond this point, inserting into the hash may invalidate the reference. */
+      if( parents.isEmpty() )
+      {
+        extraction.rootElements << element;
+      }
+      else
+      {
+        extraction.records[ parents.top() ].children.insert( element );
+      }
+
+      if( contextDepth > 0 )
+      {
+        QString context = GCProfileCache::childContext( contexts.isEmpty() ? QString() : contexts.top(), element, contextDepth );
+        ElementRecord& contextRecord = extraction.contexts[ context ];
+
+        foreach( QXmlStreamAttribute attribute, attributes )
         {
-          m_newAttributeValuesToAdd << attributeValues.join( m_stringListSeparator );
+          ++contextRecord.attributes[ attribute.qualifiedName().toString() ][ attribute.value().toString() ];
         }
-        else
+
+        /* Same as above. */
+        if( !contexts.isEmpty() )
         {
-          /* See comment for "m_newElementChildrenToAdd" above.*/
-          m_newAttributeValuesToAdd << QVariant( QVariant::String );
+          extraction.contexts[ contexts.top() ].children.insert( element );
         }
+
+        contexts.push( context );
       }
-      else
+
+      parents.push( element );
+    }
+    else if( reader->isEndElement() )
+    {
+      parents.pop();
+
+      if( !contexts.isEmpty() )
+      {
+        contexts.pop();
+      }
+    }
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+GCBatchProcessorHelper::Extraction GCBatchProcessorHelper::extractFile( const QString& fileName, int contextDepth )
+{
+  Extraction extraction;
+  QFile file( fileName );
+
+  /* Not opened in text mode, the stream reader takes care of the encoding. */
+  if( !file.open( QIODevice::ReadOnly ) )
+  {
+    extraction.errors << QString( "Failed to open file \"%1\": [%2]" )
+                         .arg( fileName )
+                         .arg( file.errorString() );
+    return extraction;
+  }
+
+  QXmlStreamReader reader( &file );
+  processStream( &reader, extraction, contextDepth );
+  file.close();
+
+  /* Rather skip a broken file entirely than import half of it. */
+  if( reader.hasError() )
+  {
+    Extraction broken;
+    broken.errors << QString( "XML in \"%1\" is broken - Error [%2], line [%3], column [%4]" )
+                     .arg( fileName )
+                     .arg( reader.errorString() )
+                     .arg( reader.lineNumber() )
+                     .arg( reader.columnNumber() );
+    return broken;
+  }
+
+  return extraction;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCBatchProcessorHelper::mergeExtraction( Extraction& result, const Extraction& extraction )
+{
+  foreach( QString root, extraction.rootElements )
+  {
+    if( !result.rootElements.contains( root ) )
+    {
+      result.rootElements << root;
+    }
+  }
+
+  result.errors << extraction.errors;
+
+  mergeRecords( result.records, extraction.records );
+  mergeRecords( result.contexts, extraction.contexts );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCBatchProcessorHelper::mergeRecords( QHash< QString, ElementRecord >& result, const QHash< QString, ElementRecord >& records )
+{
+  QHash< QString, ElementRecord >::const_iterator iter = records.constBegin();
+
+  while( iter != records.constEnd() )
+  {
+    /* Creates a new record if the element (or context) hasn't been encountered in any of the previous files. */
+    ElementRecord& record = result[ iter.key() ];
+    record.children.unite( iter.value().children );
+
+    QMap< QString, QHash< QString, int > >::const_iterator attribute = iter.value().attributes.constBegin();
+
+    while( attribute != iter.value().attributes.constEnd() )
+    {
+      QHash< QString, int >& valueCounts = record.attributes[ attribute.key() ];
+      QHash< QString, int >::const_iterator value = attribute.value().constBegin();
+
+      while( value != attribute.value().constEnd() )
+      {
+        valueCounts[ value.key() ] += value.value();
+        ++value;
+      }
+
+      ++attribute;
+    }
+
+    ++iter;
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCBatchProcessorHelper::createVariantLists()
+{
+  /* The records have already been consolidated, so all that remains is to see which of the
+    relationships we extracted from the document are completely new and which ones we have
+    prior knowledge of. */
+  QHash< QString, ElementRecord >::const_iterator iter = m_extraction.records.constBegin();
+
+  while( iter != m_extraction.records.constEnd() )
+  {
+    const QString& element = iter.key();
+    const ElementRecord& record = iter.value();
+
+    if( !m_knownElements.contains( element ) )
+    {
+      m_newElementsToAdd << element;
+    }
+
+    foreach( QString child, record.children )
+    {
+      /* Do we know about this relationship?  The keys are hashed, so this doesn't depend
+        on the size of the profile. */
+      if( !m_knownChildKeys.contains( GCRelationshipKey( element, child ) ) )
       {
-        m_attributeKeysToUpdate << attribute;
-        m_associatedElementsToUpdate << element;
+        m_newChildParentsToAdd << element;
+        m_newChildElementsToAdd << child;
+      }
+    }
 
-        if( !attributeValues.isEmpty() )
+    foreach( QString attribute, record.attributes.keys() )
+    {
+      if( !m_knownAttributeKeys.contains( GCRelationshipKey( element, attribute ) ) )
+      {
+        m_newAttributeElementsToAdd << element;
+        m_newAttributesToAdd << attribute;
+      }
+
+      QHash< QString, int > valueCounts = record.attributes.value( attribute );
+      QHash< QString, int >::const_iterator value = valueCounts.constBegin();
+
+      /* The type of each attribute is inferred from its values in this batch (the database merges
+        the result with whatever it inferred before). */
+      GCAttributePolicy policy;
+      bool hasValues = false;
+
+      while( value != valueCounts.constEnd() )
+      {
+        if( !value.key().isEmpty() )
         {
-          m_attributeValuesToUpdate << attributeValues.join( m_stringListSeparator );
+          m_attributeValueElementsToAdd << element;
+          m_attributeValueKeysToAdd << attribute;
+          m_attributeValuesToAdd << value.key();
+          m_attributeValueCountsToAdd << value.value();
+
+          policy.addValue( value.key() );
+          hasValues = true;
         }
-        else
+
+        ++value;
+      }
+
+      if( hasValues )
+      {
+        m_policyElementsToAdd << element;
+        m_policyAttributesToAdd << attribute;
+        m_policyFlagsToAdd << policy.flags();
+        m_policyMinimumsToAdd << policy.minimum();
+        m_policyMaximumsToAdd << policy.maximum();
+      }
+    }
+
+    ++iter;
+  }
+
+  /* We don't keep track of known contexts the way we do with elements (the database simply
+    ignores what it already knows about).  Value counts aren't needed either, frequencies are
+    kept per element. */
+  QHash< QString, ElementRecord >::const_iterator context = m_extraction.contexts.constBegin();
+
+  while( context != m_extraction.contexts.constEnd() )
+  {
+    m_contextsToAdd << context.key();
+
+    foreach( QString child, context.value().children )
+    {
+      m_contextChildContextsToAdd << context.key();
+      m_contextChildrenToAdd << child;
+    }
+
+    QMap< QString, QHash< QString, int > >::const_iterator attribute = context.value().attributes.constBegin();
+
+    while( attribute != context.value().attributes.constEnd() )
+    {
+      foreach( QString value, attribute.value().keys() )
+      {
+        if( !value.isEmpty() )
         {
-          /* See comment for "m_newElementChildrenToAdd" above.*/
-          m_attributeValuesToUpdate << QVariant( QVariant::String );
+          m_contextValueContextsToAdd << context.key();
+          m_contextValueAttributesToAdd << attribute.key();
+          m_contextValuesToAdd << value;
         }
       }
+
+      ++attribute;
     }
+
+    ++context;
   }
 }
 
@@ -316,78 +735,135 @@ const QVariantList& GCBatchProcessorHelper::newElementsToAdd() const
 
 /*--------------------------------------------------------------------------------------*/
 
-const QVariantList& GCBatchProcessorHelper::newElementChildrenToAdd() const
+const QVariantList& GCBatchProcessorHelper::newChildParentsToAdd() const
 {
-  return m_newElementChildrenToAdd;
+  return m_newChildParentsToAdd;
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-const QVariantList& GCBatchProcessorHelper::newElementAttributesToAdd() const
+const QVariantList& GCBatchProcessorHelper::newChildElementsToAdd() const
 {
-  return m_newElementAttributesToAdd;
+  return m_newChildElementsToAdd;
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-const QVariantList& GCBatchProcessorHelper::elementsToUpdate() const
+const QVariantList& GCBatchProcessorHelper::newAttributeElementsToAdd() const
 {
-  return m_elementsToUpdate;
+  return m_newAttributeElementsToAdd;
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-const QVariantList& GCBatchProcessorHelper::elementChildrenToUpdate() const
+const QVariantList& GCBatchProcessorHelper::newAttributesToAdd() const
 {
-  return m_elementChildrenToUpdate;
+  return m_newAttributesToAdd;
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-const QVariantList& GCBatchProcessorHelper::elementAttributesToUpdate() const
+const QVariantList& GCBatchProcessorHelper::attributeValueElementsToAdd() const
 {
-  return m_elementAttributesToUpdate;
+  return m_attributeValueElementsToAdd;
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-const QVariantList& GCBatchProcessorHelper::newAttributeKeysToAdd() const
+const QVariantList& GCBatchProcessorHelper::attributeValueKeysToAdd() const
 {
-  return m_newAttributeKeysToAdd;
+  return m_attributeValueKeysToAdd;
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-const QVariantList& GCBatchProcessorHelper::newAssociatedElementsToAdd() const
+const QVariantList& GCBatchProcessorHelper::attributeValuesToAdd() const
 {
-  return m_newAssociatedElementsToAdd;
+  return m_attributeValuesToAdd;
 }
+
+/*--------------------------------------------------------------------------------------*/
+
+const QVariantList& GCBatchProcessorHelper::attributeValueCountsToAdd() const
+{
+  return m_attributeValueCountsToAdd;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+const QVariantList& GCBatchProcessorHelper::policyElementsToAdd() const
+{
+  return m_policyElementsToAdd;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+const QVariantList& GCBatchProcessorHelper::policyAttributesToAdd() const
+{
+  return m_policyAttributesToAdd;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+const QVariantList& GCBatchProcessorHelper::policyFlagsToAdd() const
+{
+  return m_policyFlagsToAdd;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+const QVariantList& GCBatchProcessorHelper::policyMinimumsToAdd() const
+{
+  return m_policyMinimumsToAdd;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+const QVariantList& GCBatchProcessorHelper::policyMaximumsToAdd() const
+{
+  return m_policyMaximumsToAdd;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+const QVariantList& GCBatchProcessorHelper::contextsToAdd() const
+{
+  return m_contextsToAdd;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+const QVariantList& GCBatchProcessorHelper::contextChildContextsToAdd() const
+{
+  return m_contextChildContextsToAdd;
+}
+
 /*--------------------------------------------------------------------------------------*/
 
-const QVariantList& GCBatchProcessorHelper::newAttributeValuesToAdd() const
+const QVariantList& GCBatchProcessorHelper::contextChildrenToAdd() const
 {
-  return m_newAttributeValuesToAdd;
+  return m_contextChildrenToAdd;
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-const QVariantList& GCBatchProcessorHelper::attributeKeysToUpdate() const
+const QVariantList& GCBatchProcessorHelper::contextValueContextsToAdd() const
 {
-  return m_attributeKeysToUpdate;
+  return m_contextValueContextsToAdd;
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-const QVariantList& GCBatchProcessorHelper::associatedElementsToUpdate() const
+const QVariantList& GCBatchProcessorHelper::contextValueAttributesToAdd() const
 {
-  return m_associatedElementsToUpdate;
+  return m_contextValueAttributesToAdd;
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-const QVariantList& GCBatchProcessorHelper::attributeValuesToUpdate() const
+const QVariantList& GCBatchProcessorHelper::contextValuesToAdd() const
 {
-  return m_attributeValuesToUpdate;
+  return m_contextValuesToAdd;
 }
 
 /*--------------------------------------------------------------------------------------*/
\ No newline at end of file
@@ -30,21 +30,65 @@
 #define GCBATCHPROCESSORHELPER_H
 
 #include <QMap>
-#include <QMultiHash>
+#include <QHash>
+#include <QSet>
+#include <QPair>
 #include <QStringList>
 #include <QVariantList>
 
 class QDomDocument;
 class QDomElement;
+class QXmlStreamReader;
+class GCProfileCache;
+
+/*! Identifies an element/child or element/attribute relationship (in that order). */
+typedef QPair< QString/*element*/, QString/*child or attribute*/ > GCRelationshipKey;
+
+/*! A set of known relationships, see GCRelationshipKey. */
+typedef QSet< GCRelationshipKey > GCRelationshipKeySet;
+
+/// Interface through which GCBatchProcessorHelper reports its progress.
+
+/**
+  Long-running extractions (large streams or long file lists) report their progress through
+  this interface and check it regularly to see whether or not they should be abandoned.  The
+  function names mirror those of QFutureInterface, which is what implementations are expected
+  to forward the calls to.
+*/
+class GCBatchProgress
+{
+public:
+  virtual ~GCBatchProgress() {}
+
+  /*! Sets the range within which progress values will be reported. */
+  virtual void setProgressRange( int minimum, int maximum ) = 0;
+
+  /*! Reports the progress made so far. */
+  virtual void setProgressValue( int value ) = 0;
+
+  /*! Returns "true" if the extraction should be abandoned. */
+  virtual bool isCanceled() const = 0;
+};
 
 /// Helper class assisting with batch updates to the database.
 
 /**
   The purpose of this class is to (1) extract all the elements and their associated attributes
-  and attribute values from the DOM document passed in as parameter to the constructor and
-  (2) to consolidate the lot into QVariantLists that can be used as bind variables for prepared
-  queries intended to be executed in batches (that's quite a mouthful, see "execBatch" in the Qt
-  documentation for more information on this topic).
+  and attribute values from the XML document passed in as parameter to the constructor (either as a
+  DOM document or as a stream) and (2) to consolidate the lot into QVariantLists that can be used as
+  bind variables for prepared queries intended to be executed in batches (that's quite a mouthful, see
+  "execBatch" in the Qt documentation for more information on this topic).
+
+  All duplicates are removed in memory (elements are consolidated as they are encountered) and
+  relationships that are already known to the database are filtered out, so that the lists contain
+  only the records that actually have to be written.  Each set of lists is "flat", i.e. there is one
+  entry per relationship and the lists in a set are kept in synch with regards to their indices (e.g.
+  "newChildElementsToAdd().at( i )" is a first level child of "newChildParentsToAdd().at( i )").
+
+  If a context depth is provided, the children and attribute values of each element are also recorded
+  against the element's context, i.e. its own name preceded by those of its closest ancestors (see
+  GCProfileCache::childContext), so that an "item" in an "order" isn't confused with an "item" in a
+  "menu".  This is what path-aware profiles are built from.
 
   The idea is not really to have a long-lived instance of this object in the calling object (i.e.
   it isn't intended to be used as a member variable, although it isn't prevented either), but rather
@@ -60,190 +104,296 @@ public:
   /*! Constructor
       @param domDoc - the DOM document from which all information will be extracted.
 
-      @param stringSeparator - the string sequence by which list elements in the database are
-                               separated (attribute values are stored as lists in the database,
-                               separated by a special character sequence.  In other words, although
-                               the database sees a list of attribute values as a single string, we
-                               can extract the list elements later if we know which string sequence
-                               was used in the creation of the string list).  This value should be
-                               unusual and unique.
-
-      @param knownElements - the list of elements known to the active database.  If empty, all the
+      @param knownElements - the set of elements known to the active database.  If empty, all the
                              elements in the DOM will be assumed to be new.
 
-      @param knownAttributes - the list of attributes known to the active database, if empty,
-                               all the attributes in the DOM will be assumed to be new.  */
-  GCBatchProcessorHelper( const QDomDocument* domDoc,
-                          const QString& stringSeparator,
-                          const QStringList& knownElements,
-                          const QStringList& knownAttributes );
+      @param knownChildKeys - the set of element/child relationships known to the active database.
+                              If empty, all the relationships in the DOM will be assumed to be new.
+
+      @param knownAttributeKeys - the set of element/attribute relationships known to the active database.
+                                  If empty, all the attributes in the DOM will be assumed to be new.
 
-  /*! Returns a list of all the new element names that should be added to the database.
-      \sa newElementChildrenToAdd
-      \sa newElementAttributesToAdd */
+      @param contextDepth - the maximum number of element names in a context.  If zero, no contexts
+                            are recorded.  */
+  GCBatchProcessorHelper( const QDomDocument* domDoc,
+                          const QSet< QString >& knownElements,
+                          const GCRelationshipKeySet& knownChildKeys,
+                          const GCRelationshipKeySet& knownAttributeKeys,
+                          int contextDepth = 0 );
+
+  /*! Constructor.  Extracts all the information in a single forward pass over "reader" without
+      building a DOM document, which makes this the constructor of choice for large files.  If the
+      XML is broken, "reader" will be in an error state when the constructor returns and the lists
+      will be incomplete, so check "reader->hasError()" before using them.  If "progress" is provided,
+      the reader's character offset is reported through it (the caller is responsible for setting the
+      range) and the extraction is abandoned if it is cancelled.  The remaining parameters are the
+      same as for the DOM constructor. */
+  GCBatchProcessorHelper( QXmlStreamReader* reader,
+                          const QSet< QString >& knownElements,
+                          const GCRelationshipKeySet& knownChildKeys,
+                          const GCRelationshipKeySet& knownAttributeKeys,
+                          int contextDepth = 0,
+                          GCBatchProgress* progress = 0 );
+
+  /*! Constructor.  Extracts all the information from every file in "fileNames".  The files are
+      parsed concurrently (one stream reader per worker thread in the global thread pool), after
+      which the per-file results are merged.  Files that can't be opened or contain broken XML
+      are skipped entirely (see "errors").  If "progress" is provided, the number of files processed
+      is reported through it and the extraction is abandoned if it is cancelled.  The remaining
+      parameters are the same as for the DOM constructor. */
+  GCBatchProcessorHelper( const QStringList& fileNames,
+                          const QSet< QString >& knownElements,
+                          const GCRelationshipKeySet& knownChildKeys,
+                          const GCRelationshipKeySet& knownAttributeKeys,
+                          int contextDepth = 0,
+                          GCBatchProgress* progress = 0 );
+
+  /*! Returns the names of the documents' root elements. */
+  const QStringList& rootElements() const;
+
+  /*! Returns a description of each file that was skipped by the file list constructor
+      (empty if all the files were processed successfully). */
+  const QStringList& errors() const;
+
+  /*! Returns "true" if the extraction was cancelled (in which case all the lists will be empty). */
+  bool wasCanceled() const;
+
+  /*! Checks "domDoc" against "profile" and returns "true" if all of the document's elements, element
+      relationships and attributes are known (new attribute values don't count since they don't affect
+      the XML relationships).  Unlike the constructors, nothing is extracted: the check stops at the first
+      difference unless "differences" is provided, in which case the entire document is checked and a
+      description of every difference is returned in the list. */
+  static bool isCompatible( const QDomDocument* domDoc, const GCProfileCache& profile, QStringList* differences = 0 );
+
+  /*! Overloaded to check the XML in "reader" in a single forward pass.  Broken XML is never compatible.
+      If "progress" is provided, the reader's character offset is reported through it (the caller is
+      responsible for setting the range) and the check is abandoned (returning "false") if it is cancelled. */
+  static bool isCompatible( QXmlStreamReader* reader, const GCProfileCache& profile, QStringList* differences = 0, GCBatchProgress* progress = 0 );
+
+  /*! Returns a list of all the new element names that should be added to the database. */
   const QVariantList& newElementsToAdd() const;
 
-  /*! Returns a list of lists of all new first level child element namess that should be added to
-      the database. Each item in this list is a list of first level child elements corresponding
-      to an element in the "new elements to add" list.  In other words, for each item in the "new
-      elements to add" list, there is a corresponding QVariant item in this list (with the same
-      index) that represents the list of the element's first level children.  Each QVariant consists of
-      all these first level child elements concatenated into a single string value with the individuals
-      separated by the unique string separator that was passed in as constructor parameter.
-      Where an element does not have first level children, a NULL QVariant value is added to the
-      list to ensure that the indices of all lists are kept in synch.
-      \sa newElementsToAdd
-      \sa newElementAttributesToAdd */
-  const QVariantList& newElementChildrenToAdd() const;
-
-  /*! Returns a list of lists of all new associated attribute names that should be added to
-      the database. Each item in this list is a list of associated attributes corresponding
-      to an element in the "new elements to add" list.  In other words, for each item in the "new
-      elements to add" list, there is a corresponding QVariant item in this list (with the same
-      index number) that represents the list of the element's associated attributes.  Each QVariant
-      consists of all these associated attributes concatenated into a single string value with the
-      individuals separated by the unique string separator that was passed in as constructor parameter.
-      Where an element does not have associated attributes, a NULL QVariant value is added to the
-      list to ensure that the indices of all lists are kept in synch.
-      \sa newElementsToAdd
-      \sa newElementChildrenToAdd */
-  const QVariantList& newElementAttributesToAdd() const;
-
-  /*! Returns a list of all the element names that should be updated.
-      \sa elementChildrenToUpdate
-      \sa elementAttributesToUpdate */
-  const QVariantList& elementsToUpdate() const;
-
-  /*! Returns a list of lists of all first level child element names corresponding to existing elements
-      that should be updated. Each item in this list is a list of first level child elements corresponding
-      to an element in the "elements to update" list.  In other words, for each item in the "elements
-      to update" list, there is a corresponding QVariant item in this list (with the same
-      index number) that represents the list of the element's first level children.  Each QVariant consists
-      of all these first level child elements concatenated into a single string value with the individuals
-      separated by the unique string separator that was passed in as constructor parameter.
-      Where an element does not have first level children, a NULL QVariant value is added to the
-      list to ensure that the indices of all lists are kept in synch.
-      \sa elementsToUpdate
-      \sa elementAttributesToUpdate */
-  const QVariantList& elementChildrenToUpdate() const;
-
-  /*! Returns a list of lists of all associated attribute names corresponding to existing elements that
-      should be updated. Each item in this list is a list of associated attributes corresponding
-      to an element in the "elements to update" list.  In other words, for each item in the "elements
-      to update" list, there is a corresponding QVariant item in this list (with the same
-      index number) that represents the list of the element's associated attributes.  Each QVariant consists
-      of all these associated attributes concatenated into a single string value with the individuals
-      separated by the unique string separator that was passed in as constructor parameter.
-      Where an element does not have associated attributes, a NULL QVariant value is added to the
-      list to ensure that the indices of all lists are kept in synch.
-      \sa elementsToUpdate
-      \sa elementChildrenToUpdate */
-  const QVariantList& elementAttributesToUpdate() const;
-
-  /*! Returns a list of all the new attribute names that should be added to the database.
-      \sa newAssociatedElementsToAdd()
-      \sa newAttributeValuesToAdd() */
-  const QVariantList& newAttributeKeysToAdd() const;
-
-  /*! Returns a list of all the new associated element names that should be added to the database.
-      All attributes are associated with specific elements (this allows us to save different values
-      against attributes of the same name that are associated with different elements).
-      Each item in this list is the specific element associated with an attribute in the "new attribute
-      keys to add" list.
-      \sa newAttributeKeysToAdd()
-      \sa newAttributeValuesToAdd() */
-  const QVariantList& newAssociatedElementsToAdd() const;
-
-  /*! Returns a list of lists of all new attribute values that should be added to
-      the database. Each item in this list is a list of known attribute values corresponding
-      to an attribute in the "new attribute keys to add" list.  In other words, for each item in the
-      "new attribute keys to add" list, there is a corresponding QVariant item in this list (with the
-      same index number) that represents the list of the attribute's known values.  Each QVariant consists
-      of all these known values concatenated into a single string value with the individuals
-      separated by the unique string separator that was passed in as constructor parameter.
-      \sa newAttributeKeysToAdd()
-      \sa newAssociatedElementsToAdd() */
-  const QVariantList& newAttributeValuesToAdd() const;
-
-  /*! Returns a list of all the attribute keys that should be updated.
-      \sa associatedElementsToUpdate()
-      \sa attributeValuesToUpdate() */
-  const QVariantList& attributeKeysToUpdate() const;
-
-  /*! Returns a list of all the associated element names corresponding to existing attribute keys
-      that should be updated. All attributes are associated with specific elements (this allows us to
-      save different values against attributes of the same name that are associated with different elements).
-      Each item in this list is the specific element associated with an attribute in the "attribute keys to
-      update" list.
-      \sa attributeKeysToUpdate()
-      \sa attributeValuesToUpdate() */
-  const QVariantList& associatedElementsToUpdate() const;
-
-  /*! Returns a list of lists of all attribute values associated with existing attributes that should be
-      updated. Each item in this list is a list of known attribute values corresponding
-      to an attribute in the "attribute keys to update" list.  In other words, for each item in the
-      "attribute keys to update" list, there is a corresponding QVariant item in this list (with the same
-      index number) that represents the list of the attribute's known values.  Each QVariant consists of
-      all these known values concatenated into a single string value with the individuals
-      separated by the unique string separator that was passed in as constructor parameter.
-      \sa attributeKeysToUpdate()
-      \sa associatedElementsToUpdate() */
-  const QVariantList& attributeValuesToUpdate() const;
+  /*! Returns a list of the parent elements of all the new element/first level child relationships
+      that should be added to the database.
+      \sa newChildElementsToAdd */
+  const QVariantList& newChildParentsToAdd() const;
+
+  /*! Returns a list of the first level children of all the new element/first level child relationships
+      that should be added to the database.  Each item in this list is a first level child of the element
+      with the same index in the "new child parents to add" list.
+      \sa newChildParentsToAdd */
+  const QVariantList& newChildElementsToAdd() const;
+
+  /*! Returns a list of the elements of all the new element/attribute relationships that should be added
+      to the database.
+      \sa newAttributesToAdd */
+  const QVariantList& newAttributeElementsToAdd() const;
+
+  /*! Returns a list of the attribute names of all the new element/attribute relationships that should be
+      added to the database.  Each item in this list is associated with the element with the same index in
+      the "new attribute elements to add" list.
+      \sa newAttributeElementsToAdd */
+  const QVariantList& newAttributesToAdd() const;
+
+  /*! Returns a list of the elements associated with all the attribute values encountered in the document.
+      Since loading every known attribute value from the database is more expensive than letting the
+      database ignore the ones it already knows about, these are NOT filtered against the database.
+      \sa attributeValueKeysToAdd
+      \sa attributeValuesToAdd */
+  const QVariantList& attributeValueElementsToAdd() const;
+
+  /*! Returns a list of the attribute names associated with all the attribute values encountered in the document.
+      Each item in this list is associated with the element with the same index in the "attribute value
+      elements to add" list.
+      \sa attributeValueElementsToAdd
+      \sa attributeValuesToAdd */
+  const QVariantList& attributeValueKeysToAdd() const;
+
+  /*! Returns a list of all the (unique) attribute values encountered in the document.  Each item in this list is
+      a value assigned to the attribute and element with the same index in the "attribute value keys to add"
+      and "attribute value elements to add" lists respectively.
+      \sa attributeValueElementsToAdd
+      \sa attributeValueKeysToAdd */
+  const QVariantList& attributeValuesToAdd() const;
+
+  /*! Returns the number of times each attribute value occurred in the document(s).  Each item in this
+      list is the count of the value with the same index in the "attribute values to add" list.
+      \sa attributeValuesToAdd */
+  const QVariantList& attributeValueCountsToAdd() const;
+
+  /*! Returns a list of the elements of all the attributes for which values were encountered.
+      \sa policyAttributesToAdd */
+  const QVariantList& policyElementsToAdd() const;
+
+  /*! Returns a list of all the attributes for which values were encountered.  Each item in this list is
+      associated with the element with the same index in the "policy elements to add" list.
+      \sa policyFlagsToAdd */
+  const QVariantList& policyAttributesToAdd() const;
+
+  /*! Returns the type flags inferred from the values of each attribute in the "policy attributes
+      to add" list (see GCAttributePolicy).
+      \sa policyMinimumsToAdd */
+  const QVariantList& policyFlagsToAdd() const;
+
+  /*! Returns the smallest value of each attribute in the "policy attributes to add" list (null if
+      the attribute has no range, see GCAttributePolicy).
+      \sa policyMaximumsToAdd */
+  const QVariantList& policyMinimumsToAdd() const;
+
+  /*! Returns the largest value of each attribute in the "policy attributes to add" list (null if
+      the attribute has no range, see GCAttributePolicy).
+      \sa policyMinimumsToAdd */
+  const QVariantList& policyMaximumsToAdd() const;
+
+  /*! Returns a list of all the contexts encountered in the document(s) (empty unless a context depth
+      was provided).  Like attribute values, contexts are not filtered against the database. */
+  const QVariantList& contextsToAdd() const;
+
+  /*! Returns a list of the contexts of all the context/first level child relationships encountered.
+      \sa contextChildrenToAdd */
+  const QVariantList& contextChildContextsToAdd() const;
+
+  /*! Returns a list of the first level children of all the context/first level child relationships
+      encountered.  Each item in this list is a first level child of the element in the context with
+      the same index in the "context child contexts to add" list.
+      \sa contextChildContextsToAdd */
+  const QVariantList& contextChildrenToAdd() const;
+
+  /*! Returns a list of the contexts associated with all the attribute values encountered.
+      \sa contextValueAttributesToAdd */
+  const QVariantList& contextValueContextsToAdd() const;
+
+  /*! Returns a list of the attribute names associated with all the attribute values encountered.
+      Each item in this list is associated with the context with the same index in the "context
+      value contexts to add" list.
+      \sa contextValuesToAdd */
+  const QVariantList& contextValueAttributesToAdd() const;
+
+  /*! Returns a list of all the (unique per context) attribute values encountered.  Each item in this
+      list is a value assigned to the attribute and context with the same index in the "context value
+      attributes to add" and "context value contexts to add" lists respectively.
+      \sa contextValueContextsToAdd */
+  const QVariantList& contextValuesToAdd() const;
 
 private:
   /*! Processes an element by extracting information related to its first level children, associated
       attributes and the values of these attributes. This function is called recursively in order to traverse
-      the DOM hierarchy.  */
-  void processElement( const QDomElement& parentElement );
+      the DOM hierarchy.  "parentContext" is the context of "parentElement" (empty if contexts aren't recorded).  */
+  void processElement( const QDomElement& parentElement, const QString& parentContext );
 
-  /*! Creates an "ElementRecord" from "element".  Called from within processElement, this function
-      creates the records and adds them to the record map without checking for duplicates.
-      \sa sortRecords */
-  void createRecord( const QDomElement& element );
+  /*! Consolidates the first level children, attributes and attribute values of "element" with whatever
+      is already known about elements of the same name (and, if "context" isn't empty, with whatever is
+      known about the same context).  Called from within processElement.
+      \sa processElement */
+  void createRecord( const QDomElement& element, const QString& context );
 
-  /*! Sorts all the element records in the unsorted record map and consolidates values where duplicates
-      are encountered.
-      \sa createRecord */
-  void sortRecords();
+  /*! Represents a single element's associated first level children,
+      attributes and known attribute values (with the number of times each value occurred). */
+  struct ElementRecord
+  {
+    QSet< QString > children;
+    QMap< QString/*name*/, QHash< QString/*value*/, int/*count*/ > > attributes;
 
-  /*! Creates the lists of QVariants representing elements, attributes and values. */
-  void createVariantLists();
+    ElementRecord()
+    : children  (),
+      attributes() {}
+  };
 
-  QString m_stringListSeparator;
+  /*! Everything extracted from one or more documents. */
+  struct Extraction
+  {
+    QStringList rootElements;
+    QHash< QString/*element*/, ElementRecord > records;
+    QHash< QString/*context*/, ElementRecord > contexts;
+    QStringList errors;
+    bool canceled;
+
+    Extraction()
+    : rootElements(),
+      records     (),
+      contexts    (),
+      errors      (),
+      canceled    ( false ) {}
+  };
 
-  QStringList m_knownElements;
-  QStringList m_knownAttributeKeys;
+  /*! Binds the context depth to "extractFile" for the file list constructor (QtConcurrent needs a
+      function object for that). */
+  struct FileExtractor
+  {
+    typedef Extraction result_type;
 
-  QVariantList m_newElementsToAdd;
-  QVariantList m_newElementChildrenToAdd;
-  QVariantList m_newElementAttributesToAdd;
+    explicit FileExtractor( int depth )
+    : contextDepth( depth ) {}
 
-  QVariantList m_elementsToUpdate;
-  QVariantList m_elementChildrenToUpdate;
-  QVariantList m_elementAttributesToUpdate;
+    Extraction operator()( const QString& fileName ) const
+    {
+      return extractFile( fileName, contextDepth );
+    }
 
-  QVariantList m_newAttributeKeysToAdd;
-  QVariantList m_newAssociatedElementsToAdd;
-  QVariantList m_newAttributeValuesToAdd;
+    int contextDepth;
+  };
 
-  QVariantList m_attributeKeysToUpdate;
-  QVariantList m_associatedElementsToUpdate;
-  QVariantList m_attributeValuesToUpdate;
+  /*! Recursively checks "element" and its descendants against "profile" (see "isCompatible"). */
+  static bool isCompatible( const QDomElement& element, const QString& parent, const GCProfileCache& profile, QStringList* differences );
 
-  /*! Represents a single element's associated first level children,
-      attributes and known attribute values. */
-  struct ElementRecord
-  {
-    QStringList children;
-    QMap< QString/*name*/, QStringList /*values*/ > attributes;
+  /*! Returns "true" if "element", its relationship with "parent" (if not empty) and its "attributes" are
+      known to "profile".  If "differences" is provided, all unknowns are appended to it, otherwise the
+      function returns at the first one. */
+  static bool isKnown( const GCProfileCache& profile,
+                       const QString& parent,
+                       const QString& element,
+                       const QStringList& attributes,
+                       QStringList* differences );
 
-    ElementRecord()
-    : children  (),
-      attributes() {}
-  };
+  /*! Reads "reader" to the end (or until an error is encountered), consolidating element records
+      into "extraction" as the elements are encountered.  See the stream constructor regarding "progress"
+      and the DOM constructor regarding "contextDepth". */
+  static void processStream( QXmlStreamReader* reader, Extraction& extraction, int contextDepth = 0, GCBatchProgress* progress = 0 );
+
+  /*! Extracts everything from "fileName" (called concurrently from the file list constructor). */
+  static Extraction extractFile( const QString& fileName, int contextDepth );
+
+  /*! Merges "extraction" into "result" (the reduction step of the file list constructor). */
+  static void mergeExtraction( Extraction& result, const Extraction& extraction );
+
+  /*! Merges "records" into "result" (called from within mergeExtraction). */
+  static void mergeRecords( QHash< QString, ElementRecord >& result, const QHash< QString, ElementRecord >& records );
+
+  /*! Creates the lists of QVariants representing elements, attributes and values. */
+  void createVariantLists();
+
+  Extraction m_extraction;
+  int m_contextDepth;
+
+  QSet< QString > m_knownElements;
+  GCRelationshipKeySet m_knownChildKeys;
+  GCRelationshipKeySet m_knownAttributeKeys;
+
+  QVariantList m_newElementsToAdd;
 
-  QMultiHash< QString/*element*/, ElementRecord > m_unsorted;
-  QMap< QString/*element*/, ElementRecord > m_records;
+  QVariantList m_newChildParentsToAdd;
+  QVariantList m_newChildElementsToAdd;
+
+  QVariantList m_newAttributeElementsToAdd;
+  QVariantList m_newAttributesToAdd;
+
+  QVariantList m_attributeValueElementsToAdd;
+  QVariantList m_attributeValueKeysToAdd;
+  QVariantList m_attributeValuesToAdd;
+  QVariantList m_attributeValueCountsToAdd;
+
+  QVariantList m_policyElementsToAdd;
+  QVariantList m_policyAttributesToAdd;
+  QVariantList m_policyFlagsToAdd;
+  QVariantList m_policyMinimumsToAdd;
+  QVariantList m_policyMaximumsToAdd;
+
+  QVariantList m_contextsToAdd;
+  QVariantList m_contextChildContextsToAdd;
+  QVariantList m_contextChildrenToAdd;
+  QVariantList m_contextValueContextsToAdd;
+  QVariantList m_contextValueAttributesToAdd;
+  QVariantList m_contextValuesToAdd;
 };
 
 #endif // GCBATCHPROCESSORHELPER_H
\ No newline at end of file
@@ -28,12 +28,19 @@
 
 #include "gcdatabaseinterface.h"
 #include "gcbatchprocessorhelper.h"
+#include "gcdatabaseworker.h"
+#include "gcattributepolicy.h"
+#include "utils/gcglobalspace.h"
 
 #include <QDomDocument>
 #include <QStringList>
 #include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
 #include <QTextStream>
 #include <QApplication>
+#include <QXmlStreamReader>
+#include <QThread>
 #include <QtSql/QSqlDatabase>
 #include <QtSql/QSqlError>
 #include <QtSql/QSqlRecord>
@@ -43,36 +50,201 @@
 
 /* Have a look at "createTables" to see how the DB is set up. */
 static const QLatin1String INSERT_ELEMENT(
-  "INSERT INTO xmlelements( element, children, attributes ) VALUES( ?, ?, ? )" );
+  "INSERT OR IGNORE INTO xmlelements( element ) VALUES( ? )" );
 
-static const QLatin1String INSERT_ATTRIBUTEVALUES(
-  "INSERT INTO xmlattributes( attribute, associatedElement, attributeValues ) VALUES( ?, ?, ? )" );
+static const QLatin1String INSERT_CHILD(
+  "INSERT OR IGNORE INTO elementchildren( element, child ) VALUES( ?, ? )" );
 
-static const QLatin1String UPDATE_CHILDREN(
-  "UPDATE xmlelements SET children = ? WHERE element = ?" );
+static const QLatin1String INSERT_ATTRIBUTE(
+  "INSERT OR IGNORE INTO elementattributes( element, attribute ) VALUES( ?, ? )" );
 
-static const QLatin1String UPDATE_ATTRIBUTES(
-  "UPDATE xmlelements SET attributes = ? WHERE element = ?" );
+static const QLatin1String INSERT_ROOTELEMENT(
+  "INSERT OR IGNORE INTO rootelements( root ) VALUES( ? )" );
 
-static const QLatin1String UPDATE_ATTRIBUTEVALUES(
-  "UPDATE xmlattributes SET attributeValues = ? WHERE attribute = ? AND associatedElement = ?" );
+static const QLatin1String INSERT_ATTRIBUTEVALUE(
+  "INSERT OR IGNORE INTO attributevalues( element, attribute, value ) VALUES( ?, ?, ? )" );
+
+static const QLatin1String UPDATE_ATTRIBUTEVALUEFREQUENCY(
+  "UPDATE attributevalues SET frequency = frequency + ? WHERE element = ? AND attribute = ? AND value = ?" );
+
+static const QLatin1String UPDATE_ATTRIBUTEVALUELASTUSED(
+  "UPDATE attributevalues SET lastused = ? WHERE element = ? AND attribute = ? AND value = ?" );
+
+static const QLatin1String INSERT_ATTRIBUTEPOLICY(
+  "INSERT OR IGNORE INTO attributepolicies( element, attribute ) VALUES( ?, ? )" );
+
+/* Policies are merged by combining their flags and extending the range (NULL means no range). */
+static const QLatin1String UPDATE_ATTRIBUTEPOLICY(
+  "UPDATE attributepolicies SET flags = flags | ?, "
+  "minimum = COALESCE( MIN( minimum, ? ), minimum, ? ), "
+  "maximum = COALESCE( MAX( maximum, ? ), maximum, ? ) "
+  "WHERE element = ? AND attribute = ?" );
+
+static const QLatin1String DELETE_CHILDREN(
+  "DELETE FROM elementchildren WHERE element = ?" );
+
+static const QLatin1String DELETE_CHILD(
+  "DELETE FROM elementchildren WHERE element = ? AND child = ?" );
+
+static const QLatin1String DELETE_ATTRIBUTES(
+  "DELETE FROM elementattributes WHERE element = ?" );
+
+static const QLatin1String DELETE_ATTRIBUTE(
+  "DELETE FROM elementattributes WHERE element = ? AND attribute = ?" );
+
+static const QLatin1String DELETE_ATTRIBUTEVALUES(
+  "DELETE FROM attributevalues WHERE element = ? AND attribute = ?" );
+
+static const QLatin1String DELETE_ATTRIBUTEVALUE(
+  "DELETE FROM attributevalues WHERE element = ? AND attribute = ? AND value = ?" );
+
+static const QLatin1String DELETE_ELEMENT(
+  "DELETE FROM xmlelements WHERE element = ?" );
+
+static const QLatin1String DELETE_ELEMENTVALUES(
+  "DELETE FROM attributevalues WHERE element = ?" );
+
+static const QLatin1String DELETE_PARENTREFERENCES(
+  "DELETE FROM elementchildren WHERE child = ?" );
+
+static const QLatin1String DELETE_ROOTELEMENT(
+  "DELETE FROM rootelements WHERE root = ?" );
+
+static const QLatin1String DELETE_ATTRIBUTEPOLICY(
+  "DELETE FROM attributepolicies WHERE element = ? AND attribute = ?" );
+
+static const QLatin1String DELETE_ELEMENTPOLICIES(
+  "DELETE FROM attributepolicies WHERE element = ?" );
+
+static const QLatin1String INSERT_CONTEXT(
+  "INSERT OR IGNORE INTO contexts( path, leaf ) VALUES( ?, ? )" );
+
+static const QLatin1String INSERT_CONTEXTELEMENT(
+  "INSERT OR IGNORE INTO contextelements( element, context ) SELECT ?, context FROM contexts WHERE path = ?" );
+
+/* Every context value is also an attribute value of the context's last element, so context values
+  are bounded by removing those whose attribute values were evicted (see "writeAttributePolicies"). */
+static const QLatin1String EVICT_CONTEXTVALUES(
+  "DELETE FROM contextvalues WHERE attribute = ? AND context IN ( SELECT context FROM contexts WHERE leaf = ? ) "
+  "AND value NOT IN ( SELECT value FROM attributevalues WHERE element = ? AND attribute = ? )" );
+
+static const QLatin1String INSERT_CONTEXTCHILD(
+  "INSERT OR IGNORE INTO contextchildren( context, child ) SELECT context, ? FROM contexts WHERE path = ?" );
+
+static const QLatin1String INSERT_CONTEXTVALUE(
+  "INSERT OR IGNORE INTO contextvalues( context, attribute, value ) SELECT context, ?, ? FROM contexts WHERE path = ?" );
+
+/* Context paths are slash separated element names, the following statements remove every context
+  that contains an element anywhere in its path (looked up via the "contextelements" index, which
+  has to go last)... */
+static const QLatin1String DELETE_ELEMENTCONTEXTCHILDREN(
+  "DELETE FROM contextchildren WHERE context IN "
+  "( SELECT context FROM contextelements WHERE element = ? )" );
+
+static const QLatin1String DELETE_ELEMENTCONTEXTVALUES(
+  "DELETE FROM contextvalues WHERE context IN "
+  "( SELECT context FROM contextelements WHERE element = ? )" );
+
+static const QLatin1String DELETE_ELEMENTCONTEXTS(
+  "DELETE FROM contexts WHERE context IN "
+  "( SELECT context FROM contextelements WHERE element = ? )" );
+
+static const QLatin1String DELETE_ELEMENTCONTEXTELEMENTS(
+  "DELETE FROM contextelements WHERE context IN "
+  "( SELECT context FROM contextelements WHERE element = ? )" );
+
+static const QLatin1String DELETE_CONTEXTPARENTREFERENCES(
+  "DELETE FROM contextchildren WHERE child = ?" );
+
+/* ...whereas these only affect the contexts whose path ends in an element. */
+static const QLatin1String DELETE_CONTEXTCHILD(
+  "DELETE FROM contextchildren WHERE child = ? AND context IN "
+  "( SELECT context FROM contexts WHERE leaf = ? )" );
+
+static const QLatin1String DELETE_CONTEXTATTRIBUTEVALUES(
+  "DELETE FROM contextvalues WHERE attribute = ? AND context IN "
+  "( SELECT context FROM contexts WHERE leaf = ? )" );
+
+static const QLatin1String DELETE_CONTEXTATTRIBUTEVALUE(
+  "DELETE FROM contextvalues WHERE attribute = ? AND value = ? AND context IN "
+  "( SELECT context FROM contexts WHERE leaf = ? )" );
+
+/* The following statements merge the profile attached as "other" (see "attachProfile") into the
+  active profile.  The frequencies of the values known to both profiles are added up before the
+  remaining values are inserted (along with their own frequencies). */
+static const QLatin1String MERGE_ELEMENTS(
+  "INSERT OR IGNORE INTO main.xmlelements( element ) SELECT element FROM other.xmlelements" );
+
+static const QLatin1String MERGE_CHILDREN(
+  "INSERT OR IGNORE INTO main.elementchildren( element, child ) SELECT element, child FROM other.elementchildren" );
+
+static const QLatin1String MERGE_ATTRIBUTES(
+  "INSERT OR IGNORE INTO main.elementattributes( element, attribute ) "
+  "SELECT element, attribute FROM other.elementattributes ORDER BY rowid" );
+
+static const QLatin1String MERGE_ROOTELEMENTS(
+  "INSERT OR IGNORE INTO main.rootelements( root ) SELECT root FROM other.rootelements" );
+
+/* The later of the two usage times is kept (either may be NULL, which SQLite's "max" doesn't skip). */
+static const QLatin1String MERGE_ATTRIBUTEVALUEFREQUENCIES(
+  "UPDATE main.attributevalues SET frequency = frequency + "
+  "( SELECT o.frequency FROM other.attributevalues o WHERE o.element = attributevalues.element "
+  "AND o.attribute = attributevalues.attribute AND o.value = attributevalues.value ), "
+  "lastused = nullif( max( coalesce( lastused, 0 ), coalesce( "
+  "( SELECT o.lastused FROM other.attributevalues o WHERE o.element = attributevalues.element "
+  "AND o.attribute = attributevalues.attribute AND o.value = attributevalues.value ), 0 ) ), 0 ) "
+  "WHERE EXISTS ( SELECT 1 FROM other.attributevalues o WHERE o.element = attributevalues.element "
+  "AND o.attribute = attributevalues.attribute AND o.value = attributevalues.value )" );
+
+static const QLatin1String MERGE_ATTRIBUTEVALUES(
+  "INSERT OR IGNORE INTO main.attributevalues( element, attribute, value, frequency, lastused ) "
+  "SELECT element, attribute, value, frequency, lastused FROM other.attributevalues" );
+
+static const QLatin1String MERGE_CONTEXTS(
+  "INSERT OR IGNORE INTO main.contexts( path, leaf ) SELECT path, leaf FROM other.contexts" );
+
+/* Context ids are local to each database, so context relationships are matched up via their paths. */
+static const QLatin1String MERGE_CONTEXTELEMENTS(
+  "INSERT OR IGNORE INTO main.contextelements( element, context ) "
+  "SELECT oe.element, c.context FROM other.contextelements oe "
+  "JOIN other.contexts o ON o.context = oe.context JOIN main.contexts c ON c.path = o.path" );
+
+static const QLatin1String MERGE_CONTEXTCHILDREN(
+  "INSERT OR IGNORE INTO main.contextchildren( context, child ) "
+  "SELECT c.context, oc.child FROM other.contextchildren oc "
+  "JOIN other.contexts o ON o.context = oc.context JOIN main.contexts c ON c.path = o.path" );
+
+static const QLatin1String MERGE_CONTEXTVALUES(
+  "INSERT OR IGNORE INTO main.contextvalues( context, attribute, value ) "
+  "SELECT c.context, ov.attribute, ov.value FROM other.contextvalues ov "
+  "JOIN other.contexts o ON o.context = ov.context JOIN main.contexts c ON c.path = o.path" );
 
 /*--------------------------------------------------------------------------------------*/
 
 /* Flat file containing list of databases. */
 static const QString DB_FILE( "dblist.txt" );
 
+/* Flat file containing the root elements known to each database, one database per line
+  (the connection name followed by its root elements, all separated by tabs). */
+static const QString ROOT_CATALOG_FILE( "rootcatalog.txt" );
+
+/* Appended to a database's file name to get the name of its profile snapshot file. */
+static const QString SNAPSHOT_SUFFIX( ".snapshot" );
+
 /* Regular expression string to split "\" (Windows) or "/" (Unix) from file path. */
 static const QString REGEXP_SLASHES( "(\\\\|\\/)" );
 
-/* The database tables have fields containing strings of strings. For example, the
-  "xmlelements" table maps a unique element against a list of all associated attribute
-  values.  Since these values have to be entered into a single record, the easiest way
-  is to insert a single (possibly massive) string containing all the associated attributes.
-  To ensure that we can later extract the individual attributes again, we separate them with
-  a sequence that should (theoretically) never be encountered.  This is that sequence. */
+/* Older versions of the database tables had fields containing strings of strings. For example,
+  the "xmlelements" table mapped a unique element against a single (possibly massive) string
+  containing all its associated attributes, separated by a sequence that should (theoretically)
+  never be encountered.  This is that sequence (only required to migrate old databases to the
+  current layout, see "migrateTables"). */
 static const QString SEPARATOR( "~!@" );
 
+/* Stored in SQLite's "user_version" pragma.  Databases without a version (i.e. zero) use the
+  old "strings of strings" layout and are migrated when opened. */
+static const int SCHEMA_VERSION( 2 );
+
 /*--------------------------- NON-MEMBER UTILITY FUNCTIONS ----------------------------*/
 
 void cleanList( QStringList& list )
@@ -83,12 +255,109 @@ void cleanList( QStringList& list )
 
 /*--------------------------------------------------------------------------------------*/
 
-QString cleanAndJoinListElements( QStringList list )
+/* Returns the statement that keeps (at most) the number of values allowed by an attribute's policy,
+  evicting the least frequently used values first (ties are broken the same way as in
+  GCProfileCache::rankedAttributeValues).  Values that were assigned by the user since the bound
+  protection cutoff are always kept (see GCAttributePolicy::PROTECTION_PERIOD).  The limits live in
+  GCAttributePolicy, which is why this isn't a constant like the other statements. */
+QString evictAttributeValuesStatement()
+{
+  return QString( "DELETE FROM attributevalues WHERE element = ? AND attribute = ? "
+                  "AND ( lastused IS NULL OR lastused < ? ) AND value NOT IN "
+                  "( SELECT value FROM attributevalues WHERE element = ? AND attribute = ? ORDER BY frequency DESC, value "
+                  "LIMIT ( SELECT CASE WHEN ( flags & %1 ) = %1 THEN %2 ELSE %3 END "
+                  "FROM attributepolicies WHERE element = ? AND attribute = ? ) )" )
+    .arg( int( GCAttributePolicy::NotCompact ) )
+    .arg( GCAttributePolicy::TEXT_VALUES )
+    .arg( GCAttributePolicy::COMPACT_VALUES );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QVariantList toVariantList( const QStringList& list )
+{
+  QVariantList variants;
+
+  foreach( QString str, list )
+  {
+    variants << str;
+  }
+
+  return variants;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QVariantList repeatedValue( const QVariant& value, int count )
+{
+  QVariantList variants;
+
+  for( int i = 0; i < count; ++i )
+  {
+    variants << value;
+  }
+
+  return variants;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+/* Returns "first" followed by those entries in "second" that "first" doesn't contain, cut off after
+  "limit" entries (unless "limit" is zero). */
+QStringList mergedList( const QStringList& first, const QStringList& second, int limit = 0 )
+{
+  QSet< QString > known = first.toSet();
+  QStringList merged( first );
+
+  foreach( QString entry, second )
+  {
+    if( limit > 0 && merged.size() >= limit )
+    {
+      break;
+    }
+
+    if( !known.contains( entry ) )
+    {
+      merged << entry;
+    }
+  }
+
+  return ( limit > 0 ) ? merged.mid( 0, limit ) : merged;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+/* Returns the last element in each of the context paths in "contexts". */
+QVariantList contextLeaves( const QVariantList& contexts )
+{
+  QVariantList leaves;
+
+  foreach( QVariant context, contexts )
+  {
+    leaves << context.toString().section( '/', -1 );
+  }
+
+  return leaves;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+/* Appends every element in each of the context paths in "contexts" to "elements" and the
+  path it was found in to "paths" (the bind lists for INSERT_CONTEXTELEMENT). */
+void splitContexts( const QVariantList& contexts, QVariantList& elements, QVariantList& paths )
 {
-  cleanList( list );
-  return list.join( SEPARATOR );
+  foreach( QVariant context, contexts )
+  {
+    foreach( QString element, context.toString().split( '/' ) )
+    {
+      elements << element;
+      paths << context;
+    }
+  }
 }
 
+/*--------------------------------------------------------------------------------------*/
+
 /*--------------------------------- MEMBER FUNCTIONS ----------------------------------*/
 
 GCDataBaseInterface* GCDataBaseInterface::m_instance = NULL;
@@ -106,12 +375,38 @@ GCDataBaseInterface* GCDataBaseInterface::instance()
 /*--------------------------------------------------------------------------------------*/
 
 GCDataBaseInterface::GCDataBaseInterface()
-: m_sessionDB       (),
-  m_lastErrorMsg    ( "" ),
-  m_hasActiveSession( false ),
-  m_initialised     ( false ),
-  m_dbMap           ()
+: m_sessionDB         (),
+  m_preparedQueries   (),
+  m_lastErrorMsg      ( "" ),
+  m_hasActiveSession  ( false ),
+  m_initialised       ( false ),
+  m_inTransaction     ( false ),
+  m_cache             (),
+  m_snapshotDirty     ( false ),
+  m_contextDepth      ( GCGlobalSpace::usePathAwareProfiles() ? GCGlobalSpace::PROFILE_CONTEXT_DEPTH : 0 ),
+  m_lastSkippedFiles  (),
+  m_workerThread      ( new QThread( this ) ),
+  m_worker            ( new GCDataBaseWorker ),
+  m_pendingImports    (),
+  m_dbMap             (),
+  m_catalogRoots      (),
+  m_catalogProfiles   ()
 {
+  /* Required to pass these between threads. */
+  qRegisterMetaType< QFutureInterface< bool > >( "QFutureInterface<bool>" );
+  qRegisterMetaType< QSharedPointer< GCBatchProcessorHelper > >( "QSharedPointer<GCBatchProcessorHelper>" );
+  qRegisterMetaType< QSet< QString > >( "QSet<QString>" );
+  qRegisterMetaType< GCRelationshipKeySet >( "GCRelationshipKeySet" );
+  qRegisterMetaType< GCProfileCache >( "GCProfileCache" );
+
+  /* The worker is deleted in its own thread when the thread's event loop exits. */
+  m_worker->moveToThread( m_workerThread );
+  connect( m_workerThread, SIGNAL( finished() ), m_worker, SLOT( deleteLater() ) );
+  connect( m_worker, SIGNAL( importFinished( QFutureInterface<bool>,QSharedPointer<GCBatchProcessorHelper>,bool,QString ) ),
+           this, SLOT( workerImportFinished( QFutureInterface<bool>,QSharedPointer<GCBatchProcessorHelper>,bool,QString ) ) );
+  connect( qApp, SIGNAL( aboutToQuit() ), this, SLOT( stopWorker() ) );
+  m_workerThread->start();
+
   QFile flatFile( DB_FILE );
 
   /* ReadWrite mode is required to create the file if it doesn't exist. */
@@ -126,15 +421,27 @@ GCDataBaseInterface::GCDataBaseInterface()
 
     /* Split the input into separate lines (path/to/file lines). */
     QStringList list = fileContent.split( "\n", QString::SkipEmptyParts );
+    bool listChanged = false;
 
+    /* Known databases are only registered here, nothing is opened (or even checked) until a
+      database is set as active. */
     foreach( QString str, list )
     {
-      if( !addDatabase( str ) )
+      str = str.trimmed();
+
+      if( str.isEmpty() || !registerDatabase( str ) )
       {
-        m_lastErrorMsg = QString( "Failed to load existing connection: \n %1" ).arg( str );
-        m_initialised = false;
+        /* Duplicate (or blank) entries are dropped from the list. */
+        listChanged = true;
       }
     }
+
+    if( listChanged )
+    {
+      saveDatabaseFile();
+    }
+
+    loadRootCatalog();
   }
   else
   {
@@ -154,423 +461,547 @@ bool GCDataBaseInterface::isInitialised() const
 
 bool GCDataBaseInterface::batchProcessDomDocument( const QDomDocument* domDoc ) const
 {
+  /* The helper removes all duplicates and known relationships in memory so that we only
+    write the records that the document actually adds to the profile. */
   GCBatchProcessorHelper helper( domDoc,
-                                 SEPARATOR,
-                                 knownElements(),
-                                 knownAttributeKeys() );
+                                 m_cache.elementSet(),
+                                 knownChildKeys(),
+                                 knownAttributeKeys(),
+                                 m_contextDepth );
 
   qApp->processEvents( QEventLoop::ExcludeUserInputEvents );
+  return batchProcess( helper );
+}
 
-  if( !addRootElement( domDoc->documentElement().tagName() ) )
-  {
-    /* Last error message is set in "addRootElement". */
-    return false;
-  }
+/*--------------------------------------------------------------------------------------*/
 
-  QSqlQuery query( m_sessionDB );
+bool GCDataBaseInterface::batchProcessXmlFile( const QString& fileName ) const
+{
+  QFile file( fileName );
 
-  /* Batch insert all the new elements. */
-  if( !query.prepare( INSERT_ELEMENT ) )
+  /* Not opened in text mode, the stream reader takes care of the encoding. */
+  if( !file.open( QIODevice::ReadOnly ) )
   {
-    m_lastErrorMsg = QString( "Prepare batch INSERT elements failed: [%1]" )
-      .arg( query.lastError().text() );
+    m_lastErrorMsg = QString( "Failed to open file \"%1\": [%2]" )
+      .arg( fileName )
+      .arg( file.errorString() );
     return false;
   }
 
-  query.addBindValue( helper.newElementsToAdd() );
-  query.addBindValue( helper.newElementChildrenToAdd() );
-  query.addBindValue( helper.newElementAttributesToAdd() );
+  QXmlStreamReader reader( &file );
+  GCBatchProcessorHelper helper( &reader,
+                                 m_cache.elementSet(),
+                                 knownChildKeys(),
+                                 knownAttributeKeys(),
+                                 m_contextDepth );
+  file.close();
 
-  if( !query.execBatch() )
+  /* Don't import anything from a broken document. */
+  if( reader.hasError() )
   {
-    m_lastErrorMsg = QString( "Batch INSERT elements failed: [%1]" )
-      .arg( query.lastError().text() );
+    m_lastErrorMsg = QString( "XML is broken - Error [%1], line [%2], column [%3]" )
+      .arg( reader.errorString() )
+      .arg( reader.lineNumber() )
+      .arg( reader.columnNumber() );
     return false;
   }
 
   qApp->processEvents( QEventLoop::ExcludeUserInputEvents );
+  return batchProcess( helper );
+}
 
-  /* Batch update all the existing elements by concatenating the new values to the
-    existing values. The second '?' represents our string SEPARATOR. */
-  if( !query.prepare( "UPDATE xmlelements "
-                      "SET children = ( IFNULL( ?, \"\" ) || IFNULL( ?, \"\" ) || IFNULL( children, \"\" ) ) "
-                      "WHERE element = ?" ) )
-  {
-    m_lastErrorMsg = QString( "Prepare batch UPDATE element children failed: [%1]" )
-      .arg( query.lastError().text() );
-    return false;
-  }
+/*--------------------------------------------------------------------------------------*/
 
-  /* Since we're doing batch updates we need to ensure that all the variant lists we provide
-    have exactly the same size.  We furthermore require that the concatenation of new and old values
-    are done in a way that includes our SEPARATOR string (which is why the separator list below). */
-  QVariantList separatorList;
+bool GCDataBaseInterface::batchProcessXmlFiles( const QStringList& fileNames, QStringList* skippedFiles ) const
+{
+  GCBatchProcessorHelper helper( fileNames,
+                                 m_cache.elementSet(),
+                                 knownChildKeys(),
+                                 knownAttributeKeys(),
+                                 m_contextDepth );
 
-  for( int i = 0; i < helper.elementsToUpdate().size(); ++i )
+  if( skippedFiles )
   {
-    separatorList << SEPARATOR;
+    *skippedFiles = helper.errors();
   }
 
-  query.addBindValue( helper.elementChildrenToUpdate() );
-  query.addBindValue( separatorList );
-  query.addBindValue( helper.elementsToUpdate() );
+  qApp->processEvents( QEventLoop::ExcludeUserInputEvents );
+  return batchProcess( helper );
+}
 
-  if( !query.execBatch() )
-  {
-    m_lastErrorMsg = QString( "Batch UPDATE element children failed: [%1]" )
-      .arg( query.lastError().text() );
-    return false;
-  }
+/*--------------------------------------------------------------------------------------*/
 
-  qApp->processEvents( QEventLoop::ExcludeUserInputEvents );
+QFuture< bool > GCDataBaseInterface::batchProcessXmlFilesAsync( const QStringList& fileNames ) const
+{
+  return startWorker( "importFiles", Q_ARG( QStringList, fileNames ) );
+}
 
-  if( !query.prepare( "UPDATE xmlelements "
-                      "SET attributes = ( IFNULL( ?, \"\" ) || IFNULL( ?, \"\" ) || IFNULL( attributes, \"\" )  ) "
-                      "WHERE element = ?" ) )
-  {
-    m_lastErrorMsg = QString( "Prepare batch UPDATE element attributes failed: [%1]" )
-      .arg( query.lastError().text() );
-    return false;
-  }
+/*--------------------------------------------------------------------------------------*/
 
-  query.addBindValue( helper.elementAttributesToUpdate() );
-  query.addBindValue( separatorList );
-  query.addBindValue( helper.elementsToUpdate() );
+QFuture< bool > GCDataBaseInterface::batchProcessXmlFileAsync( const QString& fileName ) const
+{
+  return startWorker( "importFile", Q_ARG( QString, fileName ) );
+}
 
-  if( !query.execBatch() )
-  {
-    m_lastErrorMsg = QString( "Batch UPDATE element attributes failed: [%1]" )
-      .arg( query.lastError().text() );
-    return false;
-  }
+/*--------------------------------------------------------------------------------------*/
 
-  qApp->processEvents( QEventLoop::ExcludeUserInputEvents );
+QFuture< bool > GCDataBaseInterface::batchProcessXmlAsync( const QString& xml ) const
+{
+  return startWorker( "importXml", Q_ARG( QString, xml ) );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+const QStringList& GCDataBaseInterface::lastSkippedFiles() const
+{
+  return m_lastSkippedFiles;
+}
 
-  /* Batch insert all the new attribute values. */
-  if( !query.prepare( INSERT_ATTRIBUTEVALUES ) )
+/*--------------------------------------------------------------------------------------*/
+
+QFuture< bool > GCDataBaseInterface::startWorker( const char* method, QGenericArgument argument ) const
+{
+  QFutureInterface< bool > future;
+  future.reportStarted();
+
+  /* The worker writes through its own connection, so our queries won't see the changes. */
+  invalidateProfileSnapshot();
+  m_pendingImports.enqueue( m_sessionDB.connectionName() );
+
+  /* The known lists are (implicitly shared) copies, so the worker is unaffected by anything that
+    happens to the cache while it is busy. */
+  QMetaObject::invokeMethod( m_worker,
+                             method,
+                             Qt::QueuedConnection,
+                             Q_ARG( QFutureInterface<bool>, future ),
+                             argument,
+                             Q_ARG( QSet<QString>, m_cache.elementSet() ),
+                             Q_ARG( GCRelationshipKeySet, knownChildKeys() ),
+                             Q_ARG( GCRelationshipKeySet, knownAttributeKeys() ),
+                             Q_ARG( int, m_contextDepth ) );
+
+  return future.future();
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCDataBaseInterface::workerImportFinished( QFutureInterface< bool > future,
+                                                QSharedPointer< GCBatchProcessorHelper > helper,
+                                                bool success,
+                                                const QString& errorMsg )
+{
+  /* Everything that could switch or reload the active profile (or write to it) is refused while
+    imports are pending (see "refuseWhileImporting"), so the cache still belongs to the import's
+    profile. */
+  m_pendingImports.dequeue();
+
+  if( success )
   {
-    m_lastErrorMsg = QString( "Prepare batch INSERT attribute values failed: [%1]" )
-      .arg( query.lastError().text() );
-    return false;
+    updateProfileCache( *helper );
   }
 
-  query.addBindValue( helper.newAttributeKeysToAdd() );
-  query.addBindValue( helper.newAssociatedElementsToAdd() );
-  query.addBindValue( helper.newAttributeValuesToAdd() );
+  m_lastErrorMsg = errorMsg;
+  m_lastSkippedFiles = helper.isNull() ? QStringList() : helper->errors();
 
-  if( !query.execBatch() )
+  /* Cancelled futures ignore results, so there's no need to check. */
+  future.reportResult( success );
+  future.reportFinished();
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCDataBaseInterface::stopWorker()
+{
+  saveProfileSnapshot();
+  m_workerThread->quit();
+  m_workerThread->wait();
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseInterface::batchProcess( const GCBatchProcessorHelper& helper ) const
+{
+  if( refuseWhileImporting() )
   {
-    m_lastErrorMsg = QString( "Batch INSERT attribute values failed: [%1]" )
-      .arg( query.lastError().text() );
     return false;
   }
 
-  qApp->processEvents( QEventLoop::ExcludeUserInputEvents );
-
-  /* Batch update all the existing attribute values. */
-  if( !query.prepare( "UPDATE xmlattributes "
-                      "SET attributeValues = ( IFNULL( ?, \"\" ) || IFNULL( ?, \"\" ) || IFNULL( attributeValues, \"\" ) ) "
-                      "WHERE attribute = ? "
-                      "AND associatedElement = ?" ) )
+  /* Everything is written in a single transaction, which means that (1) SQLite only has to
+    sync to disk once per import and (2) a failed import doesn't leave a partial profile behind. */
+  if( !beginTransaction() )
   {
-    m_lastErrorMsg = QString( "Prepare batch UPDATE attribute values failed: [%1]" )
-      .arg( query.lastError().text() );
     return false;
   }
 
-  separatorList.clear();
+  /* "writeBatch" doesn't go through our own query functions. */
+  invalidateProfileSnapshot();
 
-  for( int i = 0; i < helper.attributeKeysToUpdate().size(); ++i )
+  if( !writeBatch( m_sessionDB, helper, m_lastErrorMsg ) )
   {
-    separatorList << SEPARATOR;
+    rollbackTransaction();
+    return false;
   }
 
-  query.addBindValue( helper.attributeValuesToUpdate() );
-  query.addBindValue( separatorList );
-  query.addBindValue( helper.attributeKeysToUpdate() );
-  query.addBindValue( helper.associatedElementsToUpdate() );
+  qApp->processEvents( QEventLoop::ExcludeUserInputEvents );
 
-  if( !query.execBatch() )
+  if( !commitTransaction() )
   {
-    m_lastErrorMsg = QString( "Batch UPDATE attribute values failed: [%1]" )
-      .arg( query.lastError().text() );
     return false;
   }
 
-  return removeDuplicatesFromFields();
+  updateProfileCache( helper );
+  m_lastErrorMsg = "";
+  return true;
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-bool GCDataBaseInterface::addElement( const QString& element, const QStringList& children, const QStringList& attributes ) const
+bool GCDataBaseInterface::writeBatch( QSqlDatabase db, const GCBatchProcessorHelper& helper, QString& errorMsg, GCBatchProgress* progress )
 {
-  if( element.isEmpty() )
-  {
-    m_lastErrorMsg = QString( "Trying to add an empty element name." );
-    return false;
-  }
-
-  QSqlQuery query = selectElement( element );
-
-  /* If we don't have an existing record, add it. */
-  if( !query.first() )
-  {
-    if( !query.prepare( INSERT_ELEMENT ) )
+  QStringList statements;
+  statements << INSERT_ROOTELEMENT
+             << INSERT_ELEMENT
+             << INSERT_CHILD
+             << INSERT_ATTRIBUTE
+             << INSERT_ATTRIBUTEVALUE
+             << UPDATE_ATTRIBUTEVALUEFREQUENCY
+             << INSERT_CONTEXT
+             << INSERT_CONTEXTELEMENT
+             << INSERT_CONTEXTCHILD
+             << INSERT_CONTEXTVALUE;
+
+  QVariantList contextElements;
+  QVariantList contextElementPaths;
+  splitContexts( helper.contextsToAdd(), contextElements, contextElementPaths );
+
+  QList< QList< QVariantList > > bindLists;
+  bindLists << ( QList< QVariantList >() << toVariantList( helper.rootElements() ) )
+            << ( QList< QVariantList >() << helper.newElementsToAdd() )
+            << ( QList< QVariantList >() << helper.newChildParentsToAdd()
+                                         << helper.newChildElementsToAdd() )
+            << ( QList< QVariantList >() << helper.newAttributeElementsToAdd()
+                                         << helper.newAttributesToAdd() )
+            << ( QList< QVariantList >() << helper.attributeValueElementsToAdd()
+                                         << helper.attributeValueKeysToAdd()
+                                         << helper.attributeValuesToAdd() )
+            << ( QList< QVariantList >() << helper.attributeValueCountsToAdd()
+                                         << helper.attributeValueElementsToAdd()
+                                         << helper.attributeValueKeysToAdd()
+                                         << helper.attributeValuesToAdd() )
+            << ( QList< QVariantList >() << helper.contextsToAdd()
+                                         << contextLeaves( helper.contextsToAdd() ) )
+            << ( QList< QVariantList >() << contextElements
+                                         << contextElementPaths )
+            << ( QList< QVariantList >() << helper.contextChildrenToAdd()
+                                         << helper.contextChildContextsToAdd() )
+            << ( QList< QVariantList >() << helper.contextValueAttributesToAdd()
+                                         << helper.contextValuesToAdd()
+                                         << helper.contextValueContextsToAdd() );
+
+  QStringList descriptions;
+  descriptions << "Batch INSERT root elements"
+               << "Batch INSERT elements"
+               << "Batch INSERT element children"
+               << "Batch INSERT element attributes"
+               << "Batch INSERT attribute values"
+               << "Batch UPDATE attribute value frequencies"
+               << "Batch INSERT contexts"
+               << "Batch INSERT context elements"
+               << "Batch INSERT context children"
+               << "Batch INSERT context attribute values";
+
+  /* Known root elements are simply ignored (roots are the primary key of their table), as are known
+    attribute values (whose frequencies are then updated along with those of the new ones) and known
+    contexts (the context relationships look up the context ids, so the contexts have to go first). */
+  for( int i = 0; i < statements.size(); ++i )
+  {
+    if( progress && progress->isCanceled() )
     {
-      m_lastErrorMsg = QString( "Prepare INSERT element failed for element \"%1\": [%2]" )
-        .arg( element )
-        .arg( query.lastError().text() );
+      errorMsg = QString( "Import cancelled." );
       return false;
     }
 
-    query.addBindValue( element );
-    query.addBindValue( cleanAndJoinListElements( children ) );
-    query.addBindValue( cleanAndJoinListElements( attributes ) );
-
-    if( !query.exec() )
+    if( !execBatchQuery( db, statements.at( i ), bindLists.at( i ), descriptions.at( i ), errorMsg ) )
     {
-      m_lastErrorMsg = QString( "INSERT element failed for element \"%1\": [%2]" )
-        .arg( element )
-        .arg( query.lastError().text() );
       return false;
     }
   }
 
-  m_lastErrorMsg = "";
-  return true;
+  /* Only once the values (and their frequencies) are known can the excess be evicted. */
+  return writeAttributePolicies( db,
+                                 helper.policyElementsToAdd(),
+                                 helper.policyAttributesToAdd(),
+                                 helper.policyFlagsToAdd(),
+                                 helper.policyMinimumsToAdd(),
+                                 helper.policyMaximumsToAdd(),
+                                 errorMsg );
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-bool GCDataBaseInterface::addRootElement( const QString& root ) const
+bool GCDataBaseInterface::writeAttributePolicies( QSqlDatabase db,
+                                                  const QVariantList& elements,
+                                                  const QVariantList& attributes,
+                                                  const QVariantList& flags,
+                                                  const QVariantList& minimums,
+                                                  const QVariantList& maximums,
+                                                  QString& errorMsg,
+                                                  QHash< QString, QSqlQuery >* preparedQueries,
+                                                  bool evict )
 {
-  if( root.isEmpty() )
+  if( !execBatchQuery( db,
+                       INSERT_ATTRIBUTEPOLICY,
+                       QList< QVariantList >() << elements << attributes,
+                       "Batch INSERT attribute policies",
+                       errorMsg,
+                       preparedQueries ) ||
+      !execBatchQuery( db,
+                       UPDATE_ATTRIBUTEPOLICY,
+                       QList< QVariantList >() << flags << minimums << minimums << maximums << maximums << elements << attributes,
+                       "Batch UPDATE attribute policies",
+                       errorMsg,
+                       preparedQueries ) )
   {
-    m_lastErrorMsg = QString( "Trying to add an empty root element name." );
     return false;
   }
 
-  QSqlQuery query( m_sessionDB );
-
-  if( !query.prepare( "SELECT * FROM rootelements WHERE root = ? " ) )
+  if( !evict )
   {
-    m_lastErrorMsg = QString( "Prepare SELECT root element failed for root \"%1\": [%2]" )
-      .arg( root )
-      .arg( query.lastError().text() );
-    return false;
+    return true;
   }
 
-  query.addBindValue( root );
+  QVariantList cutoffs = repeatedValue( GCAttributePolicy::protectionCutoff(), elements.size() );
+
+  return execBatchQuery( db,
+                         evictAttributeValuesStatement(),
+                         QList< QVariantList >() << elements << attributes << cutoffs << elements << attributes << elements << attributes,
+                         "Batch DELETE evicted attribute values",
+                         errorMsg,
+                         preparedQueries ) &&
+         execBatchQuery( db,
+                         EVICT_CONTEXTVALUES,
+                         QList< QVariantList >() << attributes << elements << elements << attributes,
+                         "Batch DELETE evicted context attribute values",
+                         errorMsg,
+                         preparedQueries );
+}
+
+/*--------------------------------------------------------------------------------------*/
 
-  if( !query.exec() )
+bool GCDataBaseInterface::updateAttributePolicy( const QString& element, const QString& attribute, const QStringList& values ) const
+{
+  GCAttributePolicy policy;
+
+  foreach( QString value, values )
   {
-    m_lastErrorMsg = QString( "SELECT root element failed for root \"%1\": [%2]" )
-      .arg( root )
-      .arg( query.lastError().text() );
-    return false;
+    policy.addValue( value );
   }
 
-  /* Make sure we aren't trying to insert a known root element. */
-  if( !query.first() )
-  {
-    if( !query.prepare( "INSERT INTO rootelements ( root ) VALUES( ? )" ) )
-    {
-      m_lastErrorMsg = QString( "Prepare INSERT root element failed for root \"%1\": [%2]" )
-        .arg( root )
-        .arg( query.lastError().text() );
-      return false;
-    }
+  return writeAttributePolicies( m_sessionDB,
+                                 QVariantList() << element,
+                                 QVariantList() << attribute,
+                                 QVariantList() << policy.flags(),
+                                 QVariantList() << policy.minimum(),
+                                 QVariantList() << policy.maximum(),
+                                 m_lastErrorMsg,
+                                 &m_preparedQueries );
+}
 
-    query.addBindValue( root );
+/*--------------------------------------------------------------------------------------*/
 
-    if( !query.exec() )
-    {
-      m_lastErrorMsg = QString( "INSERT root element failed for element \"%1\": [%2]" )
-        .arg( root )
-        .arg( query.lastError().text() );
-      return false;
-    }
+void GCDataBaseInterface::cacheAttributePolicy( const QString& element, const QString& attribute, const QStringList& values ) const
+{
+  GCAttributePolicy policy;
+
+  foreach( QString value, values )
+  {
+    policy.addValue( value );
   }
 
-  m_lastErrorMsg = "";
-  return true;
+  m_cache.mergeAttributePolicy( element, attribute, policy );
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-bool GCDataBaseInterface::updateElementChildren( const QString& element, const QStringList& children, bool replace ) const
+bool GCDataBaseInterface::inferAttributePolicies() const
 {
-  if( element.isEmpty() )
+  QSqlQuery query( m_sessionDB );
+
+  if( !query.exec( "SELECT element, attribute, value FROM attributevalues" ) )
   {
-    m_lastErrorMsg = QString( "Invalid element name provided." );
+    m_lastErrorMsg = QString( "SELECT attribute values failed for \"%1\": [%2]" )
+      .arg( m_sessionDB.connectionName() )
+      .arg( query.lastError().text() );
     return false;
   }
 
-  QSqlQuery query = selectElement( element );
+  QHash< GCRelationshipKey, GCAttributePolicy > policies;
 
-  /* Update the existing record (if we have one). */
-  if( query.first() )
+  while( query.next() )
   {
-    QStringList allChildren( children );
-
-    if( !replace )
-    {
-      allChildren.append( query.record().field( "children" ).value().toString().split( SEPARATOR ) );
-    }
+    policies[ GCRelationshipKey( query.value( 0 ).toString(), query.value( 1 ).toString() ) ].addValue( query.value( 2 ).toString() );
+  }
 
-    if( !query.prepare( UPDATE_CHILDREN ) )
-    {
-      m_lastErrorMsg = QString( "Prepare UPDATE element children failed for element \"%1\": [%2]" )
-        .arg( element )
-        .arg( query.lastError().text() );
-      return false;
-    }
+  query.finish();
 
-    query.addBindValue( cleanAndJoinListElements( allChildren ) );
-    query.addBindValue( element );
+  QVariantList elements;
+  QVariantList attributes;
+  QVariantList flags;
+  QVariantList minimums;
+  QVariantList maximums;
 
-    if( !query.exec() )
-    {
-      m_lastErrorMsg = QString( "UPDATE children failed for element \"%1\": [%2]" )
-        .arg( element )
-        .arg( query.lastError().text() );
-      return false;
-    }
-  }
-  else
+  for( QHash< GCRelationshipKey, GCAttributePolicy >::const_iterator iter = policies.constBegin(); iter != policies.constEnd(); ++iter )
   {
-    m_lastErrorMsg = QString( "No knowledge of element \"%1\", add it first." )
-      .arg( element );
-    return false;
+    elements << iter.key().first;
+    attributes << iter.key().second;
+    flags << iter.value().flags();
+    minimums << iter.value().minimum();
+    maximums << iter.value().maximum();
   }
 
-  m_lastErrorMsg = "";
-  return true;
+  /* Nothing is evicted here: a schema upgrade mustn't lose data, so the values that exceed the
+    policies only go once their attributes are written to again. */
+  return writeAttributePolicies( m_sessionDB, elements, attributes, flags, minimums, maximums, m_lastErrorMsg, &m_preparedQueries, false );
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-bool GCDataBaseInterface::updateElementAttributes( const QString& element, const QStringList& attributes, bool replace ) const
+void GCDataBaseInterface::updateProfileCache( const GCBatchProcessorHelper& helper ) const
 {
-  if( element.isEmpty() )
+  foreach( QString root, helper.rootElements() )
   {
-    m_lastErrorMsg = QString( "Invalid element name provided." );
-    return false;
+    m_cache.addRootElement( root );
   }
 
-  QSqlQuery query = selectElement( element );
+  updateRootCatalog();
 
-  /* Update the existing record (if we have one). */
-  if( query.first() )
+  foreach( QVariant element, helper.newElementsToAdd() )
   {
-    QStringList allAttributes;
+    m_cache.addElement( element.toString() );
+  }
 
-    if( !replace )
-    {
-      allAttributes.append( query.record().field( "attributes" ).value().toString().split( SEPARATOR ) );
-    }
+  /* The cache keeps its lists sorted, so everything destined for the same list is gathered first
+    and merged in one go (adding values one at a time makes large imports quadratic). */
+  QHash< QString, QStringList > children;
 
-    /* Add it here so that we append the new attributes to the end of the list. */
-    allAttributes.append( attributes );
+  for( int i = 0; i < helper.newChildElementsToAdd().size(); ++i )
+  {
+    children[ helper.newChildParentsToAdd().at( i ).toString() ].append( helper.newChildElementsToAdd().at( i ).toString() );
+  }
 
-    if( !query.prepare( UPDATE_ATTRIBUTES ) )
-    {
-      m_lastErrorMsg = QString( "Prepare UPDATE element attribute failed for element \"%1\": [%2]" )
-        .arg( element )
-        .arg( query.lastError().text() );
-      return false;
-    }
+  m_cache.addChildren( children );
 
-    query.addBindValue( cleanAndJoinListElements( allAttributes ) );
-    query.addBindValue( element );
+  for( int i = 0; i < helper.newAttributesToAdd().size(); ++i )
+  {
+    m_cache.addAttributes( helper.newAttributeElementsToAdd().at( i ).toString(),
+                           QStringList( helper.newAttributesToAdd().at( i ).toString() ) );
+  }
 
-    if( !query.exec() )
-    {
-      m_lastErrorMsg = QString( "UPDATE attribute failed for element \"%1\": [%2]" )
-        .arg( element )
-        .arg( query.lastError().text() );
-      return false;
-    }
+  QHash< QString, QHash< QString, QStringList > > values;
+
+  for( int i = 0; i < helper.attributeValuesToAdd().size(); ++i )
+  {
+    QString element = helper.attributeValueElementsToAdd().at( i ).toString();
+    QString attribute = helper.attributeValueKeysToAdd().at( i ).toString();
+    QString value = helper.attributeValuesToAdd().at( i ).toString();
+
+    values[ element ][ attribute ].append( value );
+    m_cache.addAttributeValueFrequency( element, attribute, value, helper.attributeValueCountsToAdd().at( i ).toInt() );
   }
-  else
+
+  m_cache.addAttributeValues( values );
+
+  foreach( QVariant context, helper.contextsToAdd() )
   {
-    m_lastErrorMsg = QString( "No element \"%1\" exists." )
-      .arg( element );
-    return false;
+    m_cache.addContext( context.toString() );
   }
 
-  m_lastErrorMsg = "";
-  return true;
+  QHash< QString, QStringList > contextChildren;
+
+  for( int i = 0; i < helper.contextChildrenToAdd().size(); ++i )
+  {
+    contextChildren[ helper.contextChildContextsToAdd().at( i ).toString() ].append( helper.contextChildrenToAdd().at( i ).toString() );
+  }
+
+  m_cache.addContextChildren( contextChildren );
+
+  QHash< QString, QHash< QString, QStringList > > contextValues;
+
+  for( int i = 0; i < helper.contextValuesToAdd().size(); ++i )
+  {
+    contextValues[ helper.contextValueContextsToAdd().at( i ).toString() ]
+      [ helper.contextValueAttributesToAdd().at( i ).toString() ].append( helper.contextValuesToAdd().at( i ).toString() );
+  }
+
+  m_cache.addContextAttributeValues( contextValues );
+
+  /* Evicts the same values as "writeAttributePolicies" did. */
+  for( int i = 0; i < helper.policyElementsToAdd().size(); ++i )
+  {
+    m_cache.mergeAttributePolicy( helper.policyElementsToAdd().at( i ).toString(),
+                                  helper.policyAttributesToAdd().at( i ).toString(),
+                                  GCAttributePolicy( helper.policyFlagsToAdd().at( i ).toInt(),
+                                                     helper.policyMinimumsToAdd().at( i ),
+                                                     helper.policyMaximumsToAdd().at( i ) ) );
+  }
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-bool GCDataBaseInterface::updateAttributeValues( const QString& element, const QString& attribute, const QStringList& attributeValues, bool replace ) const
+bool GCDataBaseInterface::addElement( const QString& element, const QStringList& children, const QStringList& attributes ) const
 {
-  if( element.isEmpty() || attribute.isEmpty() )
+  if( refuseWhileImporting() )
   {
-    m_lastErrorMsg = QString( "Invalid element or attribute values provided." );
     return false;
   }
 
-  QSqlQuery query = selectAttribute( attribute, element );
+  if( element.isEmpty() )
+  {
+    m_lastErrorMsg = QString( "Trying to add an empty element name." );
+    return false;
+  }
 
-  /* If we don't have an existing record, add it, otherwise update the existing one. */
-  if( !query.first() )
+  /* If we don't have an existing record, add it. */
+  if( !m_cache.containsElement( element ) )
   {
-    if( !query.prepare( INSERT_ATTRIBUTEVALUES ) )
-    {
-      m_lastErrorMsg = QString( "Prepare INSERT attribute value failed for element \"%1\": [%2]" )
-        .arg( element )
-        .arg( query.lastError().text() );
-      return false;
-    }
+    QStringList elementChildren( children );
+    cleanList( elementChildren );
 
-    query.addBindValue( attribute );
-    query.addBindValue( element );
-    query.addBindValue( cleanAndJoinListElements( attributeValues ) );
+    QStringList elementAttributes( attributes );
+    cleanList( elementAttributes );
 
-    if( !query.exec() )
+    if( !beginTransaction() )
     {
-      m_lastErrorMsg = QString( "INSERT attribute failed for element \"%1\": [%2]" )
-        .arg( element )
-        .arg( query.lastError().text() );
       return false;
     }
-  }
-  else
-  {
-    QStringList existingValues( attributeValues );
-
-    if( !replace )
-    {
-      existingValues.append( query.record().field( "attributeValues" ).value().toString().split( SEPARATOR ) );
-    }
 
-    /* The reason for not using concatenating values here is that we don't simply want to add
-      all the supposed new values, we want to make sure they are all unique by removing all duplicates
-      before sticking it all back into the DB. */
-    if( !query.prepare( UPDATE_ATTRIBUTEVALUES ) )
+    QSqlQuery query( m_sessionDB );
+
+    if( !execQuery( query,
+                    INSERT_ELEMENT,
+                    QVariantList() << element,
+                    QString( "INSERT element for element \"%1\"" ).arg( element ) ) ||
+        !execBatchQuery( INSERT_CHILD,
+                         QList< QVariantList >() << repeatedValue( element, elementChildren.size() )
+                                                 << toVariantList( elementChildren ),
+                         QString( "INSERT children for element \"%1\"" ).arg( element ) ) ||
+        !execBatchQuery( INSERT_ATTRIBUTE,
+                         QList< QVariantList >() << repeatedValue( element, elementAttributes.size() )
+                                                 << toVariantList( elementAttributes ),
+                         QString( "INSERT attributes for element \"%1\"" ).arg( element ) ) )
     {
-      m_lastErrorMsg = QString( "Prepare UPDATE attribute values failed for element \"%1\" and attribute \"%2\": [%3]" )
-        .arg( element )
-        .arg( attribute )
-        .arg( query.lastError().text() );
+      rollbackTransaction();
       return false;
     }
 
-    query.addBindValue( cleanAndJoinListElements( existingValues ) );
-    query.addBindValue( attribute );
-    query.addBindValue( element );
-
-    if( !query.exec() )
+    if( !commitTransaction() )
     {
-      m_lastErrorMsg = QString( "UPDATE attribute values failed for element \"%1\" and attribute [%2]: [%3]" )
-        .arg( element )
-        .arg( attribute )
-        .arg( query.lastError().text() );
       return false;
     }
+
+    m_cache.addElement( element );
+    m_cache.addChildren( element, elementChildren );
+    m_cache.addAttributes( element, elementAttributes );
   }
 
   m_lastErrorMsg = "";
@@ -579,30 +1010,29 @@ bool GCDataBaseInterface::updateAttributeValues( const QString& element, const Q
 
 /*--------------------------------------------------------------------------------------*/
 
-bool GCDataBaseInterface::removeElement( const QString& element ) const
+bool GCDataBaseInterface::addRootElement( const QString& root ) const
 {
-  QSqlQuery query = selectElement( element );
-
-  /* Only continue if we have an existing record. */
-  if( query.first() )
+  if( root.isEmpty() )
   {
-    if( !query.prepare( "DELETE FROM xmlelements WHERE element = ?" ) )
-    {
-      m_lastErrorMsg = QString( "Prepare DELETE element failed for element \"%1\": [%3]" )
-        .arg( element )
-        .arg( query.lastError().text() );
-      return false;
-    }
+    m_lastErrorMsg = QString( "Trying to add an empty root element name." );
+    return false;
+  }
 
-    query.addBindValue( element );
+  /* Make sure we aren't trying to insert a known root element. */
+  if( !m_cache.rootElements().contains( root ) )
+  {
+    QSqlQuery query( m_sessionDB );
 
-    if( !query.exec() )
+    if( !execQuery( query,
+                    INSERT_ROOTELEMENT,
+                    QVariantList() << root,
+                    QString( "INSERT root element for root \"%1\"" ).arg( root ) ) )
     {
-      m_lastErrorMsg = QString( "DELETE element failed for element \"%1\": [%3]" )
-        .arg( element )
-        .arg( query.lastError().text() );
       return false;
     }
+
+    m_cache.addRootElement( root );
+    updateRootCatalog();
   }
 
   m_lastErrorMsg = "";
@@ -611,59 +1041,71 @@ bool GCDataBaseInterface::removeElement( const QString& element ) const
 
 /*--------------------------------------------------------------------------------------*/
 
-bool GCDataBaseInterface::removeChildElement( const QString& element, const QString& child ) const
+bool GCDataBaseInterface::updateElementChildren( const QString& element, const QStringList& children, bool replace ) const
 {
-  QSqlQuery query = selectElement( element );
+  if( refuseWhileImporting() )
+  {
+    return false;
+  }
 
-  /* Update the existing record (if we have one). */
-  if( query.first() )
+  if( element.isEmpty() )
   {
-    QStringList allChildren( query.record().field( "children" ).value().toString().split( SEPARATOR ) );
-    allChildren.removeAll( child );
-    updateElementChildren( element, allChildren, true );
+    m_lastErrorMsg = QString( "Invalid element name provided." );
+    return false;
   }
 
-  m_lastErrorMsg = "";
-  return true;
-}
+  /* Update the existing record (if we have one). */
+  if( !m_cache.containsElement( element ) )
+  {
+    m_lastErrorMsg = QString( "No knowledge of element \"%1\", add it first." )
+      .arg( element );
+    return false;
+  }
 
-/*--------------------------------------------------------------------------------------*/
+  QStringList newChildren( children );
+  cleanList( newChildren );
 
-bool GCDataBaseInterface::removeAttribute( const QString& element, const QString& attribute ) const
-{
-  QSqlQuery query = selectAttribute( attribute, element );
+  if( !beginTransaction() )
+  {
+    return false;
+  }
 
-  /* Only continue if we have an existing record. */
-  if( query.first() )
+  /* When appending, existing children are left alone (the unique index on the
+    relationship ensures that duplicates are ignored). */
+  if( replace )
   {
-    if( !query.prepare( "DELETE FROM xmlattributes "
-                        "WHERE attribute = ? "
-                        "AND associatedElement = ?" ) )
+    QSqlQuery query( m_sessionDB );
+
+    if( !execQuery( query,
+                    DELETE_CHILDREN,
+                    QVariantList() << element,
+                    QString( "DELETE children for element \"%1\"" ).arg( element ) ) )
     {
-      m_lastErrorMsg = QString( "Prepare DELETE attribute failed for element \"%1\" and attribute \"%2\": [%3]" )
-        .arg( element )
-        .arg( attribute )
-        .arg( query.lastError().text() );
+      rollbackTransaction();
       return false;
     }
+  }
 
-    query.addBindValue( attribute );
-    query.addBindValue( element );
+  if( !execBatchQuery( INSERT_CHILD,
+                       QList< QVariantList >() << repeatedValue( element, newChildren.size() )
+                                               << toVariantList( newChildren ),
+                       QString( "UPDATE children for element \"%1\"" ).arg( element ) ) )
+  {
+    rollbackTransaction();
+    return false;
+  }
 
-    if( !query.exec() )
-    {
-      m_lastErrorMsg = QString( "DELETE attribute failed for element \"%1\" and attribute [%2]: [%3]" )
-        .arg( element )
-        .arg( attribute )
-        .arg( query.lastError().text() );
-      return false;
-    }
+  if( !commitTransaction() )
+  {
+    return false;
+  }
+
+  if( replace )
+  {
+    m_cache.removeChildren( element );
   }
 
-  query = selectElement( element );
-  QStringList allAttributes = attributes( element );
-  allAttributes.removeAll( attribute );
-  updateElementAttributes( element, allAttributes, true );
+  m_cache.addChildren( element, newChildren );
 
   m_lastErrorMsg = "";
   return true;
@@ -671,731 +1113,2243 @@ bool GCDataBaseInterface::removeAttribute( const QString& element, const QString
 
 /*--------------------------------------------------------------------------------------*/
 
-bool GCDataBaseInterface::removeRootElement( const QString& element ) const
+bool GCDataBaseInterface::updateElementAttributes( const QString& element, const QStringList& attributes, bool replace ) const
 {
-  QSqlQuery query( m_sessionDB );
-
-  if( !query.prepare( "DELETE FROM rootelements WHERE root = ?" ) )
+  if( refuseWhileImporting() )
   {
-    m_lastErrorMsg = QString( "Prepare DELETE failed for root \"%1\": [%2]" )
-      .arg( element )
-      .arg( query.lastError().text() );
     return false;
   }
 
-  query.addBindValue( element );
-
-  if( !query.exec() )
+  if( element.isEmpty() )
   {
-    m_lastErrorMsg = QString( "DELETE root element failed for root \"%1\": [%2]" )
-      .arg( element )
-      .arg( query.lastError().text() );
+    m_lastErrorMsg = QString( "Invalid element name provided." );
     return false;
   }
 
-  m_lastErrorMsg = "";
-  return true;
-}
-
-/*--------------------------------------------------------------------------------------*/
-
-bool GCDataBaseInterface::hasActiveSession() const
-{
-  return m_hasActiveSession;
-}
+  /* Update the existing record (if we have one). */
+  if( !m_cache.containsElement( element ) )
+  {
+    m_lastErrorMsg = QString( "No element \"%1\" exists." )
+      .arg( element );
+    return false;
+  }
 
-/*--------------------------------------------------------------------------------------*/
+  QStringList newAttributes( attributes );
+  cleanList( newAttributes );
 
-QString GCDataBaseInterface::activeSessionName() const
-{
-  if( m_hasActiveSession )
+  if( !beginTransaction() )
   {
-    return m_sessionDB.connectionName();
+    return false;
   }
 
-  return QString();
-}
-
-/*--------------------------------------------------------------------------------------*/
+  if( replace )
+  {
+    QSqlQuery query( m_sessionDB );
 
-bool GCDataBaseInterface::isProfileEmpty() const
-{
-  return knownRootElements().isEmpty();
-}
+    if( !execQuery( query,
+                    DELETE_ATTRIBUTES,
+                    QVariantList() << element,
+                    QString( "DELETE attributes for element \"%1\"" ).arg( element ) ) )
+    {
+      rollbackTransaction();
+      return false;
+    }
+  }
 
-/*--------------------------------------------------------------------------------------*/
+  /* New attributes end up at the end of the list since "attributes" orders by insertion. */
+  if( !execBatchQuery( INSERT_ATTRIBUTE,
+                       QList< QVariantList >() << repeatedValue( element, newAttributes.size() )
+                                               << toVariantList( newAttributes ),
+                       QString( "UPDATE attributes for element \"%1\"" ).arg( element ) ) )
+  {
+    rollbackTransaction();
+    return false;
+  }
 
-bool GCDataBaseInterface::isUniqueChildElement( const QString& parentElement, const QString& element ) const
-{
-  QSqlQuery query = selectAllElements();
+  if( !commitTransaction() )
+  {
+    return false;
+  }
 
-  while( query.next() )
+  if( replace )
   {
-    if( query.record().field( "element" ).value().toString() != parentElement &&
-        query.record().value( "children" ).toString().split( SEPARATOR ).contains( element ) )
-    {
-      return false;
-    }
+    m_cache.removeAttributes( element );
   }
 
+  m_cache.addAttributes( element, newAttributes );
+
+  m_lastErrorMsg = "";
   return true;
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-bool GCDataBaseInterface::isDocumentCompatible( const QDomDocument* doc ) const
+bool GCDataBaseInterface::updateAttributeValues( const QString& element, const QString& attribute, const QStringList& attributeValues, bool replace ) const
 {
-  GCBatchProcessorHelper helper( doc,
-                                 SEPARATOR,
-                                 knownElements(),
-                                 knownAttributeKeys() );
-
-  qApp->processEvents( QEventLoop::ExcludeUserInputEvents );
+  if( refuseWhileImporting() )
+  {
+    return false;
+  }
 
-  /* If there are any new elements or attributes to add, the document is incompatible (not checking
-    for new attribute values since new values don't affect XML relationships, i.e. it isn't important
-    enough to import entire documents each time an unknown value is encountered) */
-  if( !helper.newAssociatedElementsToAdd().isEmpty() ||
-      !helper.newAttributeKeysToAdd().isEmpty() ||
-      !helper.newElementAttributesToAdd().isEmpty() ||
-      !helper.newElementChildrenToAdd().isEmpty() ||
-      !helper.newElementsToAdd().isEmpty() )
+  if( element.isEmpty() || attribute.isEmpty() )
   {
+    m_lastErrorMsg = QString( "Invalid element or attribute values provided." );
     return false;
   }
 
-  /* If there are no new items, we may still have previously unknown relationships which we
-    need to check.  This is slightly more involved than simply checking for empty lists.
-    Also remember that the lists returned by GCBatchProcessorHelper are all synchronised
-    with regards to their indices (which is the only reason why we can loop through the
-    lists like this). */
-  for( int i = 0; i < helper.elementsToUpdate().size(); ++i )
+  QStringList newValues( attributeValues );
+  cleanList( newValues );
+
+  if( !beginTransaction() )
   {
-    /* If any new element children were added, we have an incompatible document. */
-    QStringList knownChildren = children( helper.elementsToUpdate().at( i ).toString() );
-    QStringList allChildren = QStringList() << knownChildren << helper.elementChildrenToUpdate().at( i ).toString().split( SEPARATOR );
-    cleanList( allChildren );
+    return false;
+  }
+
+  /* Only the values that are actually replaced are deleted so that the ones we keep
+    also keep their frequencies. */
+  QStringList removedValues;
 
-    /* Check for larger since we only care about added items. */
-    if( allChildren.size() > knownChildren.size() )
+  if( replace )
+  {
+    foreach( QString value, m_cache.attributeValues( element, attribute ) )
     {
-      return false;
+      if( !newValues.contains( value ) )
+      {
+        removedValues << value;
+      }
     }
 
-    /* If any new attributes were added, we also have an incompatible document. */
-    QStringList knownAttributes = attributes( helper.elementsToUpdate().at( i ).toString() );
-    QStringList allAttributes = QStringList() << knownAttributes << helper.elementAttributesToUpdate().at( i ).toString().split( SEPARATOR );
-    cleanList( allAttributes );
-
-    if( allAttributes.size() > knownAttributes.size() )
+    if( !execBatchQuery( DELETE_ATTRIBUTEVALUE,
+                         QList< QVariantList >() << repeatedValue( element, removedValues.size() )
+                                                 << repeatedValue( attribute, removedValues.size() )
+                                                 << toVariantList( removedValues ),
+                         QString( "DELETE attribute values for element \"%1\" and attribute \"%2\"" ).arg( element ).arg( attribute ) ) ||
+        !execBatchQuery( DELETE_CONTEXTATTRIBUTEVALUE,
+                         QList< QVariantList >() << repeatedValue( attribute, removedValues.size() )
+                                                 << toVariantList( removedValues )
+                                                 << repeatedValue( element, removedValues.size() ),
+                         QString( "DELETE context attribute values for element \"%1\" and attribute \"%2\"" ).arg( element ).arg( attribute ) ) )
     {
+      rollbackTransaction();
       return false;
     }
   }
 
-  return true;
-}
-
-/*--------------------------------------------------------------------------------------*/
+  /* Each value is a record of its own, so adding a value never requires the existing
+    values to be read (duplicates are ignored by the unique index). */
+  if( !execBatchQuery( INSERT_ATTRIBUTEVALUE,
+                       QList< QVariantList >() << repeatedValue( element, newValues.size() )
+                                               << repeatedValue( attribute, newValues.size() )
+                                               << toVariantList( newValues ),
+                       QString( "UPDATE attribute values for element \"%1\" and attribute \"%2\"" ).arg( element ).arg( attribute ) ) ||
+      ( !newValues.isEmpty() && !updateAttributePolicy( element, attribute, newValues ) ) )
+  {
+    rollbackTransaction();
+    return false;
+  }
 
-QStringList GCDataBaseInterface::knownElements() const
-{
-  QSqlQuery query = selectAllElements();
+  if( !commitTransaction() )
+  {
+    return false;
+  }
 
-  m_lastErrorMsg = "";
+  foreach( QString value, removedValues )
+  {
+    m_cache.removeAttributeValue( element, attribute, value );
+    m_cache.removeContextAttributeValue( element, attribute, value );
+  }
 
-  QStringList elementNames;
+  m_cache.addAttributeValues( element, attribute, newValues );
 
-  while( query.next() )
+  if( !newValues.isEmpty() )
   {
-    elementNames.append( query.record().field( "element" ).value().toString() );
+    cacheAttributePolicy( element, attribute, newValues );
   }
 
-  cleanList( elementNames );
-  elementNames.sort();
-  return elementNames;
+  m_lastErrorMsg = "";
+  return true;
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-QStringList GCDataBaseInterface::children( const QString& element ) const
+bool GCDataBaseInterface::recordAttributeValue( const QString& element, const QString& attribute, const QString& value ) const
 {
-  QSqlQuery query = selectElement( element );
-
-  /* There should be only one record corresponding to this element. */
-  if( !query.first() )
+  if( refuseWhileImporting() )
   {
-    m_lastErrorMsg = QString( "Failed to obtain the list of children for element \"%1\"" )
-      .arg( element );
-    return QStringList();
+    return false;
   }
 
-  m_lastErrorMsg = "";
+  if( element.isEmpty() || attribute.isEmpty() || value.isEmpty() )
+  {
+    m_lastErrorMsg = QString( "Invalid element, attribute or attribute value provided." );
+    return false;
+  }
 
-  QStringList children = query.record().value( "children" ).toString().split( SEPARATOR );
-  cleanList( children );
-  children.sort();
-  return children;
-}
+  if( !beginTransaction() )
+  {
+    return false;
+  }
 
-/*--------------------------------------------------------------------------------------*/
+  QSqlQuery query( m_sessionDB );
 
-QStringList GCDataBaseInterface::attributes( const QString& element ) const
-{
-  QSqlQuery query = selectElement( element );
+  /* The value is protected from eviction for a while, even if it has only been used this once. */
+  uint now = QDateTime::currentDateTimeUtc().toTime_t();
+
+  if( !execQuery( query,
+                  INSERT_ATTRIBUTEVALUE,
+                  QVariantList() << element << attribute << value,
+                  QString( "INSERT attribute value for element \"%1\" and attribute \"%2\"" ).arg( element ).arg( attribute ) ) ||
+      !execQuery( query,
+                  UPDATE_ATTRIBUTEVALUEFREQUENCY,
+                  QVariantList() << 1 << element << attribute << value,
+                  QString( "UPDATE attribute value frequency for element \"%1\" and attribute \"%2\"" ).arg( element ).arg( attribute ) ) ||
+      !execQuery( query,
+                  UPDATE_ATTRIBUTEVALUELASTUSED,
+                  QVariantList() << now << element << attribute << value,
+                  QString( "UPDATE attribute value last used for element \"%1\" and attribute \"%2\"" ).arg( element ).arg( attribute ) ) ||
+      !updateAttributePolicy( element, attribute, QStringList( value ) ) )
+  {
+    rollbackTransaction();
+    return false;
+  }
 
-  /* There should be only one record corresponding to this element. */
-  if( !query.first() )
+  if( !commitTransaction() )
   {
-    m_lastErrorMsg = QString( "Failed to obtain the list of attributes for element \"%1\"" )
-      .arg( element );
-    return QStringList();
+    return false;
   }
 
-  m_lastErrorMsg = "";
+  m_cache.addAttributeValues( element, attribute, QStringList( value ) );
+  m_cache.addAttributeValueFrequency( element, attribute, value, 1 );
+  m_cache.setAttributeValueLastUsed( element, attribute, value, now );
+  cacheAttributePolicy( element, attribute, QStringList( value ) );
 
-  QStringList attributes = query.record().value( "attributes" ).toString().split( SEPARATOR );
-  cleanList( attributes );
-  return attributes;
+  m_lastErrorMsg = "";
+  return true;
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-QStringList GCDataBaseInterface::attributeValues( const QString& element, const QString& attribute ) const
+bool GCDataBaseInterface::removeElement( const QString& element ) const
 {
-  QSqlQuery query = selectAttribute( attribute, element );
-
-  /* There should be only one record corresponding to this element. */
-  if( !query.first() )
+  if( refuseWhileImporting() )
   {
-    m_lastErrorMsg = QString( "Failed to obtain the list of attribute values for attribute \"%1\"" )
-      .arg( attribute );
-    return QStringList();
+    return false;
   }
 
-  m_lastErrorMsg = "";
+  /* Only continue if we have an existing record. */
+  if( m_cache.containsElement( element ) )
+  {
+    if( !beginTransaction() )
+    {
+      return false;
+    }
 
-  QStringList attributeValues = query.record().value( "attributeValues" ).toString().split( SEPARATOR );
-  cleanList( attributeValues );
-  attributeValues.sort();
-  return attributeValues;
-}
+    QSqlQuery query( m_sessionDB );
+
+    /* The element's first level children and attribute relationships go along with it (known
+      attribute values have to be removed explicitly via "removeAttribute"). */
+    if( !execQuery( query,
+                    DELETE_CHILDREN,
+                    QVariantList() << element,
+                    QString( "DELETE children for element \"%1\"" ).arg( element ) ) ||
+        !execQuery( query,
+                    DELETE_ATTRIBUTES,
+                    QVariantList() << element,
+                    QString( "DELETE attributes for element \"%1\"" ).arg( element ) ) ||
+        !execQuery( query,
+                    DELETE_ELEMENT,
+                    QVariantList() << element,
+                    QString( "DELETE element for element \"%1\"" ).arg( element ) ) )
+    {
+      rollbackTransaction();
+      return false;
+    }
 
-/*--------------------------------------------------------------------------------------*/
+    if( !commitTransaction() )
+    {
+      return false;
+    }
+
+    m_cache.removeElement( element );
+  }
+
+  m_lastErrorMsg = "";
+  return true;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseInterface::removeElementTree( const QString& element, QStringList* removedElements ) const
+{
+  if( refuseWhileImporting() )
+  {
+    return false;
+  }
+
+  if( !m_cache.containsElement( element ) )
+  {
+    m_lastErrorMsg = QString( "Element \"%1\" is not known to the active profile." ).arg( element );
+    return false;
+  }
+
+  /* Work out what has to go from the cache first (this only touches the part of the profile that is
+    actually being removed).  The "visited" set guards against elements that are (indirectly) their
+    own children. */
+  QStringList elements( element );
+  QSet< QString > visited;
+  visited.insert( element );
+
+  for( int i = 0; i < elements.size(); ++i )
+  {
+    QString current = elements.at( i );
+
+    foreach( QString child, m_cache.children( current ) )
+    {
+      if( !visited.contains( child ) && isUniqueChildElement( current, child ) )
+      {
+        visited.insert( child );
+        elements.append( child );
+      }
+    }
+  }
+
+  /* Every statement is executed once for the entire list of elements. */
+  QList< QVariantList > bindLists;
+  bindLists << toVariantList( elements );
+
+  if( !beginTransaction() )
+  {
+    return false;
+  }
+
+  if( !execBatchQuery( DELETE_ELEMENTVALUES, bindLists, "Batch DELETE attribute values" ) ||
+      !execBatchQuery( DELETE_ELEMENTPOLICIES, bindLists, "Batch DELETE attribute policies" ) ||
+      !execBatchQuery( DELETE_ATTRIBUTES, bindLists, "Batch DELETE attributes" ) ||
+      !execBatchQuery( DELETE_CHILDREN, bindLists, "Batch DELETE children" ) ||
+      !execBatchQuery( DELETE_PARENTREFERENCES, bindLists, "Batch DELETE parent references" ) ||
+      !execBatchQuery( DELETE_ROOTELEMENT, bindLists, "Batch DELETE root elements" ) ||
+      !execBatchQuery( DELETE_ELEMENTCONTEXTVALUES, bindLists, "Batch DELETE context attribute values" ) ||
+      !execBatchQuery( DELETE_ELEMENTCONTEXTCHILDREN, bindLists, "Batch DELETE context children" ) ||
+      !execBatchQuery( DELETE_CONTEXTPARENTREFERENCES, bindLists, "Batch DELETE context parent references" ) ||
+      !execBatchQuery( DELETE_ELEMENTCONTEXTS, bindLists, "Batch DELETE contexts" ) ||
+      !execBatchQuery( DELETE_ELEMENTCONTEXTELEMENTS, bindLists, "Batch DELETE context elements" ) ||
+      !execBatchQuery( DELETE_ELEMENT, bindLists, "Batch DELETE elements" ) )
+  {
+    rollbackTransaction();
+    return false;
+  }
+
+  if( !commitTransaction() )
+  {
+    return false;
+  }
+
+  /* Keep the cache in synch with the database. */
+  foreach( QString removed, elements )
+  {
+    foreach( QString parent, m_cache.parents( removed ) )
+    {
+      m_cache.removeChild( parent, removed );
+    }
+
+    foreach( QString attribute, m_cache.attributes( removed ) )
+    {
+      m_cache.removeAttribute( removed, attribute );
+    }
+
+    /* The database dropped all of the element's values, not only those of its listed attributes. */
+    m_cache.removeElementValues( removed );
+    m_cache.removeElement( removed );
+    m_cache.removeRootElement( removed );
+    m_cache.removeContexts( removed );
+  }
+
+  updateRootCatalog();
+
+  if( removedElements )
+  {
+    *removedElements = elements;
+  }
+
+  m_lastErrorMsg = "";
+  return true;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseInterface::removeChildElement( const QString& element, const QString& child ) const
+{
+  if( refuseWhileImporting() )
+  {
+    return false;
+  }
+
+  if( !beginTransaction() )
+  {
+    return false;
+  }
+
+  QSqlQuery query( m_sessionDB );
+
+  if( !execQuery( query,
+                  DELETE_CHILD,
+                  QVariantList() << element << child,
+                  QString( "DELETE child \"%1\" for element \"%2\"" ).arg( child ).arg( element ) ) ||
+      !execQuery( query,
+                  DELETE_CONTEXTCHILD,
+                  QVariantList() << child << element,
+                  QString( "DELETE context child \"%1\" for element \"%2\"" ).arg( child ).arg( element ) ) )
+  {
+    rollbackTransaction();
+    return false;
+  }
+
+  if( !commitTransaction() )
+  {
+    return false;
+  }
+
+  m_cache.removeChild( element, child );
+  m_cache.removeContextChild( element, child );
+
+  m_lastErrorMsg = "";
+  return true;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseInterface::removeAttribute( const QString& element, const QString& attribute ) const
+{
+  if( refuseWhileImporting() )
+  {
+    return false;
+  }
+
+  if( !beginTransaction() )
+  {
+    return false;
+  }
+
+  QSqlQuery query( m_sessionDB );
+
+  if( !execQuery( query,
+                  DELETE_ATTRIBUTEVALUES,
+                  QVariantList() << element << attribute,
+                  QString( "DELETE attribute values for element \"%1\" and attribute \"%2\"" ).arg( element ).arg( attribute ) ) ||
+      !execQuery( query,
+                  DELETE_ATTRIBUTEPOLICY,
+                  QVariantList() << element << attribute,
+                  QString( "DELETE attribute policy for element \"%1\" and attribute \"%2\"" ).arg( element ).arg( attribute ) ) ||
+      !execQuery( query,
+                  DELETE_CONTEXTATTRIBUTEVALUES,
+                  QVariantList() << attribute << element,
+                  QString( "DELETE context attribute values for element \"%1\" and attribute \"%2\"" ).arg( element ).arg( attribute ) ) ||
+      !execQuery( query,
+                  DELETE_ATTRIBUTE,
+                  QVariantList() << element << attribute,
+                  QString( "DELETE attribute for element \"%1\" and attribute \"%2\"" ).arg( element ).arg( attribute ) ) )
+  {
+    rollbackTransaction();
+    return false;
+  }
+
+  if( !commitTransaction() )
+  {
+    return false;
+  }
+
+  m_cache.removeAttribute( element, attribute );
+  m_cache.removeContextAttribute( element, attribute );
+
+  m_lastErrorMsg = "";
+  return true;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseInterface::removeRootElement( const QString& element ) const
+{
+  QSqlQuery query( m_sessionDB );
+
+  if( !execQuery( query,
+                  DELETE_ROOTELEMENT,
+                  QVariantList() << element,
+                  QString( "DELETE root element for root \"%1\"" ).arg( element ) ) )
+  {
+    return false;
+  }
+
+  m_cache.removeRootElement( element );
+  updateRootCatalog();
+
+  m_lastErrorMsg = "";
+  return true;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseInterface::profileDifferences( const QString& dbName, GCProfileDifferences* added, GCProfileDifferences* removed ) const
+{
+  if( !attachProfile( dbName ) )
+  {
+    return false;
+  }
+
+  bool success = ( ( !added || selectDifferences( "other", "main", added ) ) &&
+                   ( !removed || selectDifferences( "main", "other", removed ) ) );
+
+  detachProfile();
+
+  if( success )
+  {
+    m_lastErrorMsg = "";
+  }
+
+  return success;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseInterface::mergeProfile( const QString& dbName ) const
+{
+  if( refuseWhileImporting() )
+  {
+    return false;
+  }
+
+  if( !attachProfile( dbName ) )
+  {
+    return false;
+  }
+
+  bool success = mergeAttachedProfile();
+  detachProfile();
+
+  /* Reloading the cache is a lot quicker than working out what changed (this also updates the
+    root element catalog). */
+  if( !success || !loadProfileCache() )
+  {
+    return false;
+  }
+
+  m_lastErrorMsg = "";
+  return true;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseInterface::hasActiveSession() const
+{
+  return m_hasActiveSession;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QString GCDataBaseInterface::activeSessionName() const
+{
+  if( m_hasActiveSession )
+  {
+    return m_sessionDB.connectionName();
+  }
+
+  return QString();
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseInterface::isProfileEmpty() const
+{
+  return knownRootElements().isEmpty();
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseInterface::isUniqueChildElement( const QString& parentElement, const QString& element ) const
+{
+  /* The cache keeps a reverse (child to parents) index, so there's no need to look at any child lists. */
+  QSet< QString > parents = m_cache.parents( element );
+  return ( parents.isEmpty() ||
+           ( parents.size() == 1 && parents.contains( parentElement ) ) );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseInterface::isDocumentCompatible( const QDomDocument* doc, QStringList* differences ) const
+{
+  /* Not checking for new attribute values since new values don't affect XML relationships, i.e. it
+    isn't important enough to import entire documents each time an unknown value is encountered. */
+  return GCBatchProcessorHelper::isCompatible( doc, m_cache, differences );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QFuture< bool > GCDataBaseInterface::isDocumentCompatibleAsync( const QString& xml ) const
+{
+  QFutureInterface< bool > future;
+  future.reportStarted();
+
+  /* The worker gets its own (implicitly shared) copy of the cache, which is all it needs. */
+  QMetaObject::invokeMethod( m_worker,
+                             "checkCompatibility",
+                             Qt::QueuedConnection,
+                             Q_ARG( QFutureInterface<bool>, future ),
+                             Q_ARG( QString, xml ),
+                             Q_ARG( GCProfileCache, m_cache ) );
+
+  return future.future();
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QStringList GCDataBaseInterface::knownElements() const
+{
+  m_lastErrorMsg = "";
+  return m_cache.elements();
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QStringList GCDataBaseInterface::children( const QString& element ) const
+{
+  m_lastErrorMsg = "";
+  return m_cache.children( element );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QStringList GCDataBaseInterface::attributes( const QString& element ) const
+{
+  m_lastErrorMsg = "";
+  return m_cache.attributes( element );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QStringList GCDataBaseInterface::attributeValues( const QString& element, const QString& attribute ) const
+{
+  m_lastErrorMsg = "";
+  return m_cache.attributeValues( element, attribute );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QStringList GCDataBaseInterface::rankedAttributeValues( const QString& element, const QString& attribute, int limit ) const
+{
+  m_lastErrorMsg = "";
+  return m_cache.rankedAttributeValues( element, attribute, limit );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+int GCDataBaseInterface::contextDepth() const
+{
+  return m_contextDepth;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCDataBaseInterface::setPathAwareProfiles( bool use )
+{
+  GCGlobalSpace::setUsePathAwareProfiles( use );
+  m_contextDepth = use ? GCGlobalSpace::PROFILE_CONTEXT_DEPTH : 0;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QStringList GCDataBaseInterface::contextChildren( const QStringList& path ) const
+{
+  m_lastErrorMsg = "";
+
+  if( path.isEmpty() )
+  {
+    return QStringList();
+  }
+
+  /* Contexts are only recorded by path-aware imports, so whatever was added since (by hand or by
+    imports made while path-aware profiles were switched off) is only known to the element itself.
+    The children encountered in the context come first. */
+  if( m_contextDepth > 0 )
+  {
+    return mergedList( m_cache.contextChildren( GCProfileCache::contextPath( path, m_contextDepth ) ),
+                       m_cache.children( path.last() ) );
+  }
+
+  return m_cache.children( path.last() );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QStringList GCDataBaseInterface::contextAttributeValues( const QStringList& path, const QString& attribute ) const
+{
+  m_lastErrorMsg = "";
+
+  if( path.isEmpty() )
+  {
+    return QStringList();
+  }
+
+  /* As in "contextChildren", the element's other values follow those known to the context. */
+  if( m_contextDepth > 0 )
+  {
+    return mergedList( m_cache.contextAttributeValues( GCProfileCache::contextPath( path, m_contextDepth ), attribute ),
+                       m_cache.attributeValues( path.last(), attribute ) );
+  }
+
+  return m_cache.attributeValues( path.last(), attribute );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QStringList GCDataBaseInterface::rankedContextAttributeValues( const QStringList& path, const QString& attribute, int limit ) const
+{
+  m_lastErrorMsg = "";
+
+  if( path.isEmpty() )
+  {
+    return QStringList();
+  }
+
+  if( m_contextDepth > 0 )
+  {
+    QStringList values = m_cache.rankedContextAttributeValues( GCProfileCache::contextPath( path, m_contextDepth ), attribute, limit );
+
+    /* Enough of the element's values to fill up the list even if the context's values are among them. */
+    return mergedList( values,
+                       m_cache.rankedAttributeValues( path.last(), attribute, ( limit > 0 ) ? limit + values.size() : 0 ),
+                       limit );
+  }
+
+  return m_cache.rankedAttributeValues( path.last(), attribute, limit );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+GCAttributePolicy GCDataBaseInterface::attributePolicy( const QString& element, const QString& attribute ) const
+{
+  m_lastErrorMsg = "";
+  return m_cache.attributePolicy( element, attribute );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QList< GCValueMatch > GCDataBaseInterface::findAttributeValues( const QString& text, GCValueIndex::MatchMode mode, int limit ) const
+{
+  m_lastErrorMsg = "";
+  return m_cache.findAttributeValues( text, mode, limit );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QStringList GCDataBaseInterface::knownRootElements() const
+{
+  m_lastErrorMsg = "";
+  return m_cache.rootElements();
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QStringList GCDataBaseInterface::knownRootElements( QSqlDatabase db ) const
+{
+  QSqlQuery query( db );
+
+  if( !query.exec( "SELECT * FROM rootelements" ) )
+  {
+    m_lastErrorMsg = QString( "SELECT all root elements failed: [%1]" )
+      .arg( query.lastError().text() );
+    return QStringList();
+  }
+
+  m_lastErrorMsg = "";
+
+  QStringList rootElements;
+
+  while( query.next() )
+  {
+    rootElements.append( query.record().field( "root" ).value().toString() );
+  }
+
+  cleanList( rootElements );
+  return rootElements;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseInterface::containsKnownRootElement( const QString& dbName, const QString& root ) const
+{
+  QString dbConName = connectionName( dbName );
+
+  /* No error messages are logged for this specific query since we aren't necessarily concerned with
+    the session we're querying (it may not be the active session). */
+  if( m_dbMap.contains( dbConName ) )
+  {
+    if( !m_catalogRoots.contains( dbConName ) &&
+        !catalogueDatabase( dbConName ) )
+    {
+      return false;
+    }
+
+    return m_catalogProfiles.value( root ).contains( dbConName );
+  }
+
+  return false;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QStringList GCDataBaseInterface::profilesForRootElement( const QString& root ) const
+{
+  /* Databases are only ever opened here the first time the catalog is consulted after
+    they were added to the list of known databases (outside of this interface). */
+  foreach( QString dbConName, m_dbMap.keys() )
+  {
+    if( !m_catalogRoots.contains( dbConName ) )
+    {
+      catalogueDatabase( dbConName );
+    }
+  }
+
+  QStringList profiles = m_catalogProfiles.value( root ).toList();
+  profiles.sort();
+  return profiles;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QStringList GCDataBaseInterface::connectionList() const
+{
+  return m_dbMap.keys();
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+const QString& GCDataBaseInterface::lastError() const
+{
+  return m_lastErrorMsg;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseInterface::addDatabase( const QString& dbName )
+{
+  if( !dbName.isEmpty() )
+  {
+    if( registerDatabase( dbName ) )
+    {
+      saveDatabaseFile();
+
+      m_lastErrorMsg = "";
+      return true;
+    }
+
+    m_lastErrorMsg = QString( "Connection \"%1\" already exists." ).arg( connectionName( dbName ) );
+    return false;
+  }
+
+  m_lastErrorMsg = QString( "Database name is empty." );
+  return false;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseInterface::registerDatabase( const QString& dbName )
+{
+  QString dbConName = connectionName( dbName );
+
+  if( m_dbMap.contains( dbConName ) )
+  {
+    return false;
+  }
+
+  m_dbMap.insert( dbConName, dbName );
+  return true;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QString GCDataBaseInterface::connectionName( const QString& dbName )
+{
+  /* In case the db name passed in consists of a path/to/file string. */
+  return dbName.split( QRegExp( REGEXP_SLASHES ), QString::SkipEmptyParts ).last();
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QSqlDatabase GCDataBaseInterface::connection( const QString& dbConName ) const
+{
+  /* Connections are only created the first time they are needed. */
+  if( !QSqlDatabase::contains( dbConName ) )
+  {
+    QSqlDatabase db = QSqlDatabase::addDatabase( "QSQLITE", dbConName );
+    db.setDatabaseName( m_dbMap.value( dbConName ) );
+    return db;
+  }
+
+  return QSqlDatabase::database( dbConName, false );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseInterface::removeDatabase( const QString& dbName )
+{
+  if( refuseWhileImporting() )
+  {
+    return false;
+  }
+
+  if( !dbName.isEmpty() )
+  {
+    QString dbConName = connectionName( dbName );
+
+    if( m_sessionDB.connectionName() == dbConName )
+    {
+      /* The worker's connection must be closed before the file can be removed. */
+      QMetaObject::invokeMethod( m_worker, "closeConnection", Qt::BlockingQueuedConnection );
+
+      m_preparedQueries.clear();
+      m_sessionDB.close();
+      m_hasActiveSession = false;
+      m_snapshotDirty = false;
+      m_cache.clear();
+    }
+
+    QFile file( m_dbMap.value( dbConName ) );
+
+    if( !file.remove() )
+    {
+      m_lastErrorMsg = QString( "Failed to remove database file: [%1]" )
+        .arg( dbName );
+      return false;
+    }
+
+    /* If the DB connection being removed was also the active one, "removeDatabase" will output
+      a warning (to the Qt IDE's "Application Output" window).  This is purely because we have a
+      DB member variable and isn't cause for concern as there seems to be no way around it with
+      the current QtSQL modules. */
+    if( QSqlDatabase::contains( dbConName ) )
+    {
+      QSqlDatabase::removeDatabase( dbConName );
+    }
+
+    QFile::remove( snapshotFileName( dbConName ) );
+    m_dbMap.remove( dbConName );
+    saveDatabaseFile();
+
+    if( m_catalogRoots.contains( dbConName ) )
+    {
+      foreach( QString root, m_catalogRoots.take( dbConName ) )
+      {
+        m_catalogProfiles[ root ].remove( dbConName );
+
+        if( m_catalogProfiles.value( root ).isEmpty() )
+        {
+          m_catalogProfiles.remove( root );
+        }
+      }
+
+      saveRootCatalog();
+    }
+
+    m_lastErrorMsg = "";
+    return true;
+  }
+
+  m_lastErrorMsg = QString( "Database name is empty." );
+  return false;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseInterface::setActiveDatabase( const QString& dbName )
+{
+  /* The session (if any) remains active. */
+  if( refuseWhileImporting() )
+  {
+    return false;
+  }
+
+  QString dbConName = connectionName( dbName );
+
+  /* SQLite can't change the journal mode of a database while another connection has it open (the
+    worker re-opens its connection once the session is established). */
+  QMetaObject::invokeMethod( m_worker, "closeConnection", Qt::BlockingQueuedConnection );
+
+  if( m_dbMap.contains( dbConName ) )
+  {
+    if( openConnection( dbConName ) && loadActiveProfile() )
+    {
+      QMetaObject::invokeMethod( m_worker, "openConnection", Qt::QueuedConnection, Q_ARG( QString, m_dbMap.value( dbConName ) ) );
+      m_hasActiveSession = true;
+      return true;
+    }
+  }
+  else
+  {
+    /* If we set a DB for the session that doesn't exist (new, unknown),
+      then we'll automatically try to add it and set it as active. */
+    if( addDatabase( dbName ) )
+    {
+      if( openConnection( dbConName ) && loadActiveProfile() )
+      {
+        QMetaObject::invokeMethod( m_worker, "openConnection", Qt::QueuedConnection, Q_ARG( QString, m_dbMap.value( dbConName ) ) );
+        m_hasActiveSession = true;
+        return true;
+      }
+    }
+
+    m_hasActiveSession = false;
+    return false;
+  }
+
+  m_hasActiveSession = false;
+  return false;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseInterface::refuseWhileImporting() const
+{
+  if( !m_pendingImports.isEmpty() )
+  {
+    m_lastErrorMsg = QString( "An import into \"%1\" is still busy, please wait for it to finish." )
+      .arg( m_pendingImports.head() );
+    return true;
+  }
+
+  return false;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+GCRelationshipKeySet GCDataBaseInterface::knownChildKeys() const
+{
+  GCRelationshipKeySet childKeys;
+
+  foreach( QString element, m_cache.elementSet() )
+  {
+    foreach( QString child, m_cache.children( element ) )
+    {
+      childKeys.insert( GCRelationshipKey( element, child ) );
+    }
+  }
+
+  return childKeys;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+GCRelationshipKeySet GCDataBaseInterface::knownAttributeKeys() const
+{
+  GCRelationshipKeySet attributeKeys;
+
+  foreach( QString element, m_cache.elementSet() )
+  {
+    foreach( QString attribute, m_cache.attributes( element ) )
+    {
+      attributeKeys.insert( GCRelationshipKey( element, attribute ) );
+    }
+  }
+
+  return attributeKeys;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseInterface::execQuery( QSqlQuery& query, const QString& statement, const QVariantList& bindValues, const QString& description ) const
+{
+  if( !statement.startsWith( "SELECT", Qt::CaseInsensitive ) )
+  {
+    invalidateProfileSnapshot();
+  }
+
+  if( !prepareQuery( m_sessionDB, query, statement, description, m_lastErrorMsg, &m_preparedQueries ) )
+  {
+    return false;
+  }
+
+  foreach( QVariant value, bindValues )
+  {
+    query.addBindValue( value );
+  }
+
+  if( !query.exec() )
+  {
+    m_lastErrorMsg = QString( "%1 failed: [%2]" )
+      .arg( description )
+      .arg( query.lastError().text() );
+    return false;
+  }
+
+  return true;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseInterface::execBatchQuery( const QString& statement, const QList< QVariantList >& bindLists, const QString& description ) const
+{
+  invalidateProfileSnapshot();
+  return execBatchQuery( m_sessionDB, statement, bindLists, description, m_lastErrorMsg, &m_preparedQueries );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseInterface::execBatchQuery( QSqlDatabase db,
+                                          const QString& statement,
+                                          const QList< QVariantList >& bindLists,
+                                          const QString& description,
+                                          QString& errorMsg,
+                                          QHash< QString, QSqlQuery >* preparedQueries )
+{
+  /* Nothing to do (it also saves us a prepare). */
+  if( bindLists.isEmpty() || bindLists.first().isEmpty() )
+  {
+    return true;
+  }
+
+  QSqlQuery query;
+
+  if( !prepareQuery( db, query, statement, description, errorMsg, preparedQueries ) )
+  {
+    return false;
+  }
+
+  foreach( QVariantList bindList, bindLists )
+  {
+    query.addBindValue( bindList );
+  }
+
+  if( !query.execBatch() )
+  {
+    errorMsg = QString( "%1 failed: [%2]" )
+      .arg( description )
+      .arg( query.lastError().text() );
+    return false;
+  }
+
+  return true;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseInterface::prepareQuery( QSqlDatabase db,
+                                        QSqlQuery& query,
+                                        const QString& statement,
+                                        const QString& description,
+                                        QString& errorMsg,
+                                        QHash< QString, QSqlQuery >* preparedQueries )
+{
+  if( preparedQueries )
+  {
+    QHash< QString, QSqlQuery >::const_iterator iter = preparedQueries->constFind( statement );
+
+    if( iter != preparedQueries->constEnd() )
+    {
+      query = iter.value();
+      return true;
+    }
+  }
+
+  query = QSqlQuery( db );
+
+  if( !query.prepare( statement ) )
+  {
+    errorMsg = QString( "Prepare %1 failed: [%2]" )
+      .arg( description )
+      .arg( query.lastError().text() );
+    return false;
+  }
+
+  if( preparedQueries )
+  {
+    preparedQueries->insert( statement, query );
+  }
+
+  return true;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseInterface::execAttachedQuery( QSqlQuery& query, const QString& statement, const QString& description ) const
+{
+  if( !query.exec( statement ) )
+  {
+    m_lastErrorMsg = QString( "%1 failed: [%2]" )
+      .arg( description )
+      .arg( query.lastError().text() );
+    return false;
+  }
+
+  return true;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseInterface::beginTransaction() const
+{
+  /* QSqlDatabase objects are (shallow) handles to the same connection. */
+  QSqlDatabase db( m_sessionDB );
+
+  /* Transactions don't nest (none of the functions using them call each other). */
+  if( m_inTransaction )
+  {
+    m_lastErrorMsg = QString( "A transaction is already in progress on \"%1\"." )
+      .arg( db.connectionName() );
+    return false;
+  }
+
+  if( !db.transaction() )
+  {
+    m_lastErrorMsg = QString( "Failed to start transaction on \"%1\": [%2]" )
+      .arg( db.connectionName() )
+      .arg( db.lastError().text() );
+    return false;
+  }
+
+  m_inTransaction = true;
+  return true;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseInterface::commitTransaction() const
+{
+  m_inTransaction = false;
+  QSqlDatabase db( m_sessionDB );
+
+  if( !db.commit() )
+  {
+    m_lastErrorMsg = QString( "Failed to commit transaction on \"%1\": [%2]" )
+      .arg( db.connectionName() )
+      .arg( db.lastError().text() );
+    db.rollback();
+    rollbackProfileCache();
+    return false;
+  }
+
+  return true;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCDataBaseInterface::rollbackTransaction() const
+{
+  m_inTransaction = false;
+  QSqlDatabase db( m_sessionDB );
+  db.rollback();
+  rollbackProfileCache();
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseInterface::loadProfileCache() const
+{
+  m_cache.clear();
+
+  /* The results are ordered so that the sorted cache lists are (mostly) appended to. */
+  QSqlQuery query( m_sessionDB );
+
+  if( !execQuery( query, "SELECT element FROM xmlelements", QVariantList(), "SELECT all elements" ) )
+  {
+    return false;
+  }
+
+  while( query.next() )
+  {
+    m_cache.addElement( query.value( 0 ).toString() );
+  }
+
+  if( !execQuery( query, "SELECT element, child FROM elementchildren ORDER BY element, child", QVariantList(), "SELECT all children" ) )
+  {
+    return false;
+  }
+
+  /* The cache keeps its lists sorted, so each list's entries are gathered and merged in one go. */
+  QHash< QString, QStringList > children;
+
+  while( query.next() )
+  {
+    children[ query.value( 0 ).toString() ].append( query.value( 1 ).toString() );
+  }
+
+  m_cache.addChildren( children );
+
+  /* Attributes are kept in the order in which they were added. */
+  if( !execQuery( query, "SELECT element, attribute FROM elementattributes ORDER BY rowid", QVariantList(), "SELECT all attributes" ) )
+  {
+    return false;
+  }
+
+  while( query.next() )
+  {
+    m_cache.addAttributes( query.value( 0 ).toString(), QStringList( query.value( 1 ).toString() ) );
+  }
+
+  if( !execQuery( query,
+                  "SELECT element, attribute, value, frequency, lastused FROM attributevalues ORDER BY element, attribute, value",
+                  QVariantList(),
+                  "SELECT all attribute values" ) )
+  {
+    return false;
+  }
+
+  QHash< QString, QHash< QString, QStringList > > values;
+
+  while( query.next() )
+  {
+    values[ query.value( 0 ).toString() ][ query.value( 1 ).toString() ].append( query.value( 2 ).toString() );
+    m_cache.addAttributeValueFrequency( query.value( 0 ).toString(), query.value( 1 ).toString(), query.value( 2 ).toString(), query.value( 3 ).toInt() );
+
+    if( !query.value( 4 ).isNull() )
+    {
+      m_cache.setAttributeValueLastUsed( query.value( 0 ).toString(), query.value( 1 ).toString(), query.value( 2 ).toString(), query.value( 4 ).toUInt() );
+    }
+  }
+
+  m_cache.addAttributeValues( values );
+
+  if( !execQuery( query, "SELECT element, attribute, flags, minimum, maximum FROM attributepolicies", QVariantList(), "SELECT all attribute policies" ) )
+  {
+    return false;
+  }
+
+  /* The database holds exactly the values it is meant to hold (including the excess of migrated
+    databases, see "inferAttributePolicies"), so nothing is evicted here. */
+  while( query.next() )
+  {
+    m_cache.mergeAttributePolicy( query.value( 0 ).toString(),
+                                  query.value( 1 ).toString(),
+                                  GCAttributePolicy( query.value( 2 ).toInt(), query.value( 3 ), query.value( 4 ) ),
+                                  false );
+  }
+
+  /* Contexts without children or values are still known contexts. */
+  if( !execQuery( query, "SELECT path FROM contexts", QVariantList(), "SELECT all contexts" ) )
+  {
+    return false;
+  }
+
+  while( query.next() )
+  {
+    m_cache.addContext( query.value( 0 ).toString() );
+  }
+
+  if( !execQuery( query,
+                  "SELECT path, child FROM contextchildren JOIN contexts USING( context ) ORDER BY path, child",
+                  QVariantList(),
+                  "SELECT all context children" ) )
+  {
+    return false;
+  }
+
+  QHash< QString, QStringList > contextChildren;
+
+  while( query.next() )
+  {
+    contextChildren[ query.value( 0 ).toString() ].append( query.value( 1 ).toString() );
+  }
+
+  m_cache.addContextChildren( contextChildren );
+
+  if( !execQuery( query,
+                  "SELECT path, attribute, value FROM contextvalues JOIN contexts USING( context ) ORDER BY path, attribute, value",
+                  QVariantList(),
+                  "SELECT all context attribute values" ) )
+  {
+    return false;
+  }
+
+  QHash< QString, QHash< QString, QStringList > > contextValues;
+
+  while( query.next() )
+  {
+    contextValues[ query.value( 0 ).toString() ][ query.value( 1 ).toString() ].append( query.value( 2 ).toString() );
+  }
+
+  m_cache.addContextAttributeValues( contextValues );
+
+  if( !execQuery( query, "SELECT root FROM rootelements", QVariantList(), "SELECT all root elements" ) )
+  {
+    return false;
+  }
+
+  while( query.next() )
+  {
+    m_cache.addRootElement( query.value( 0 ).toString() );
+  }
+
+  /* This is also where the catalog picks up root elements that were added to the database
+    outside of this interface. */
+  updateRootCatalog();
+  m_cache.buildValueIndex();
+  return true;
+}
+
+/*--------------------------------------------------------------------------------------*/
 
-QStringList GCDataBaseInterface::knownRootElements() const
+void GCDataBaseInterface::rollbackProfileCache() const
 {
-  return knownRootElements( m_sessionDB );
+  /* The cache may have been updated with changes that were never committed, so we simply
+    start over (this only happens when something went wrong, so it's not worth the
+    trouble of tracking individual changes).  The error message explaining why the transaction
+    was rolled back is more important than anything that may go wrong here. */
+  QString errorMsg = m_lastErrorMsg;
+  loadProfileCache();
+  m_lastErrorMsg = errorMsg;
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-QStringList GCDataBaseInterface::knownRootElements( QSqlDatabase db ) const
+QStringList GCDataBaseInterface::tuningPragmas()
+{
+  GCGlobalSpace::DatabaseTuning tuning = GCGlobalSpace::databaseTuning();
+
+  /* A negative cache size is in KiB rather than pages (i.e. independent of the page size). */
+  QStringList pragmas;
+  pragmas << QString( "PRAGMA journal_mode = %1" ).arg( GCGlobalSpace::databaseJournalMode( tuning ) )
+          << QString( "PRAGMA synchronous = %1" ).arg( GCGlobalSpace::databaseSynchronous( tuning ) )
+          << QString( "PRAGMA mmap_size = %1" ).arg( GCGlobalSpace::databaseMmapSize( tuning ) )
+          << QString( "PRAGMA cache_size = -%1" ).arg( GCGlobalSpace::databaseCacheSize( tuning ) )
+          << QString( "PRAGMA temp_store = %1" ).arg( GCGlobalSpace::databaseTempStoreInMemory( tuning ) ? "MEMORY" : "DEFAULT" );
+  return pragmas;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseInterface::applyTuning( QSqlDatabase db, QString& errorMsg )
 {
   QSqlQuery query( db );
 
-  if( !query.exec( "SELECT * FROM rootelements" ) )
+  foreach( QString pragma, tuningPragmas() )
   {
-    m_lastErrorMsg = QString( "SELECT all root elements failed: [%1]" )
-      .arg( query.lastError().text() );
-    return QStringList();
+    /* Some of these return the new setting, which we aren't interested in. */
+    if( !query.exec( pragma ) )
+    {
+      errorMsg = QString( "\"%1\" failed on \"%2\": [%3]" )
+        .arg( pragma )
+        .arg( db.databaseName() )
+        .arg( query.lastError().text() );
+      return false;
+    }
+
+    query.finish();
   }
 
-  m_lastErrorMsg = "";
+  /* SQLite quietly ignores journal mode and synchronous changes that it can't make (e.g. while another
+    connection holds the database in a different journal mode or a transaction is active), so we ask
+    for the settings that are actually in effect.  The synchronous level is reported as a number. */
+  GCGlobalSpace::DatabaseTuning tuning = GCGlobalSpace::databaseTuning();
+  QStringList synchronousLevels;
+  synchronousLevels << "OFF" << "NORMAL" << "FULL" << "EXTRA";
 
-  QStringList rootElements;
+  QString journalMode;
+  QString synchronous;
 
-  while( query.next() )
+  if( query.exec( "PRAGMA journal_mode" ) && query.first() )
   {
-    rootElements.append( query.record().field( "root" ).value().toString() );
+    journalMode = query.value( 0 ).toString().toUpper();
   }
 
-  cleanList( rootElements );
-  return rootElements;
+  query.finish();
+
+  if( query.exec( "PRAGMA synchronous" ) && query.first() )
+  {
+    synchronous = synchronousLevels.value( query.value( 0 ).toInt() );
+  }
+
+  query.finish();
+
+  if( journalMode != GCGlobalSpace::databaseJournalMode( tuning ) )
+  {
+    errorMsg = QString( "Journal mode of \"%1\" is \"%2\" instead of \"%3\"." )
+      .arg( db.databaseName() )
+      .arg( journalMode )
+      .arg( GCGlobalSpace::databaseJournalMode( tuning ) );
+    return false;
+  }
+
+  if( synchronous != GCGlobalSpace::databaseSynchronous( tuning ) )
+  {
+    errorMsg = QString( "Synchronous level of \"%1\" is \"%2\" instead of \"%3\"." )
+      .arg( db.databaseName() )
+      .arg( synchronous )
+      .arg( GCGlobalSpace::databaseSynchronous( tuning ) );
+    return false;
+  }
+
+  return true;
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-bool GCDataBaseInterface::containsKnownRootElement( const QString& dbName, const QString& root ) const
+bool GCDataBaseInterface::openConnection( const QString& dbConName )
 {
-  /* In case the db name passed in consists of a path/to/file string. */
-  QString dbConName = dbName.split( QRegExp( REGEXP_SLASHES ), QString::SkipEmptyParts ).last();
+  /* Prepared queries belong to the connection they were prepared on. */
+  m_preparedQueries.clear();
 
-  /* No error messages are logged for this specific query since we aren't necessarily concerned with
-    the session we're querying (it may not be the active session). */
-  if( QSqlDatabase::contains( dbConName ) )
+  /* Bring the outgoing profile's snapshot up to date while we still have its cache. */
+  saveProfileSnapshot();
+  m_snapshotDirty = false;
+
+  /* If we have a previous connection open, close it. */
+  if( m_sessionDB.isValid() && m_sessionDB.isOpen() )
+  {
+    m_sessionDB.close();
+  }
+
+  /* Open the new connection. */
+  m_sessionDB = connection( dbConName );
+  m_inTransaction = false;
+
+  if( m_sessionDB.isValid() )
   {
-    QSqlDatabase db = QSqlDatabase::database( dbConName );
+    if( !m_sessionDB.open() )
+    {
+      m_lastErrorMsg = QString( "Failed to open database \"%1\": [%2]." )
+        .arg( m_dbMap.value( dbConName ) )
+        .arg( m_sessionDB.lastError().text() );
+      return false;
+    }
 
-    if( db.isValid() && db.open() )
+    if( !applyTuning( m_sessionDB, m_lastErrorMsg ) )
     {
-      if( knownRootElements( db ).contains( root ) )
-      {
-        return true;
-      }
-      else
-      {
-        return false;
-      }
+      m_sessionDB.close();
+      return false;
+    }
+
+    /* If the DB has not yet been initialised. */
+    QStringList tables = m_sessionDB.tables();
+
+    if( !tables.contains( "xmlelements", Qt::CaseInsensitive ) )
+    {
+      /* In case a snapshot was left behind by an earlier database of the same name. */
+      QFile::remove( snapshotFileName( dbConName ) );
+      return createTables();
+    }
+
+    /* If the DB was created with an older version of the layout. */
+    QSqlQuery query( m_sessionDB );
+
+    if( !query.exec( "PRAGMA user_version" ) || !query.first() )
+    {
+      m_lastErrorMsg = QString( "Failed to obtain schema version for \"%1\": [%2]" )
+        .arg( dbConName )
+        .arg( query.lastError().text() );
+      return false;
     }
+
+    int version = query.value( 0 ).toInt();
+
+    if( version < SCHEMA_VERSION )
+    {
+      query.finish();
+      QFile::remove( snapshotFileName( dbConName ) );
+      return migrateTables();
+    }
+  }
+  else
+  {
+    m_lastErrorMsg = QString( "Failed to open a valid session connection \"%1\": [%2]" )
+      .arg( dbConName )
+      .arg( m_sessionDB.lastError().text() );
+    return false;
   }
 
-  return false;
+  m_lastErrorMsg = "";
+  return true;
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-QStringList GCDataBaseInterface::connectionList() const
+bool GCDataBaseInterface::createTables() const
 {
-  return m_dbMap.keys();
+  /* DB connection will be open from openConnection() above so no need to do any checks here. */
+  QSqlQuery query( m_sessionDB );
+
+  if( !query.exec( "CREATE TABLE IF NOT EXISTS xmlelements( element TEXT PRIMARY KEY )" ) )
+  {
+    m_lastErrorMsg = QString( "Failed to create elements table for \"%1\": [%2]." )
+      .arg( m_sessionDB.connectionName() )
+      .arg( query.lastError().text() );
+    return false;
+  }
+
+  /* The unique constraint doubles as the index used to look up an element's children, the second index
+    allows us to look up all the parents of a specific child. */
+  if( !query.exec( "CREATE TABLE IF NOT EXISTS elementchildren( element TEXT, child TEXT, "
+                   "UNIQUE( element, child ) )" ) ||
+      !query.exec( "CREATE INDEX IF NOT EXISTS childIndex ON elementchildren( child )" ) )
+  {
+    m_lastErrorMsg = QString( "Failed to create element children table for \"%1\": [%2]." )
+      .arg( m_sessionDB.connectionName() )
+      .arg( query.lastError().text() );
+    return false;
+  }
+
+  if( !query.exec( "CREATE TABLE IF NOT EXISTS elementattributes( element TEXT, attribute TEXT, "
+                   "UNIQUE( element, attribute ) )" ) )
+  {
+    m_lastErrorMsg = QString( "Failed to create element attributes table for \"%1\": [%2]." )
+      .arg( m_sessionDB.connectionName() )
+      .arg( query.lastError().text() );
+    return false;
+  }
+
+  if( !query.exec( "CREATE TABLE IF NOT EXISTS attributevalues( element TEXT, attribute TEXT, value TEXT, "
+                   "frequency INTEGER NOT NULL DEFAULT 0, lastused INTEGER, UNIQUE( element, attribute, value ) )" ) )
+  {
+    m_lastErrorMsg = QString( "Failed to create attribute values table for \"%1\": [%2]" )
+      .arg( m_sessionDB.connectionName() )
+      .arg( query.lastError().text() );
+    return false;
+  }
+
+  if( !query.exec( "CREATE TABLE IF NOT EXISTS attributepolicies( element TEXT, attribute TEXT, "
+                   "flags INTEGER NOT NULL DEFAULT 0, minimum REAL, maximum REAL, UNIQUE( element, attribute ) )" ) )
+  {
+    m_lastErrorMsg = QString( "Failed to create attribute policies table for \"%1\": [%2]" )
+      .arg( m_sessionDB.connectionName() )
+      .arg( query.lastError().text() );
+    return false;
+  }
+
+  /* Context paths are stored once, the context relationships refer to them by id.  Contexts are
+    indexed by their last element and (in "contextelements") by every element in their paths so
+    that removing an element never has to scan the paths themselves. */
+  if( !query.exec( "CREATE TABLE IF NOT EXISTS contexts( context INTEGER PRIMARY KEY, path TEXT UNIQUE, leaf TEXT )" ) ||
+      !query.exec( "CREATE INDEX IF NOT EXISTS contextLeafIndex ON contexts( leaf )" ) ||
+      !query.exec( "CREATE TABLE IF NOT EXISTS contextelements( element TEXT, context INTEGER, "
+                   "UNIQUE( element, context ) )" ) ||
+      !query.exec( "CREATE INDEX IF NOT EXISTS contextElementIndex ON contextelements( context )" ) ||
+      !query.exec( "CREATE TABLE IF NOT EXISTS contextchildren( context INTEGER, child TEXT, "
+                   "UNIQUE( context, child ) )" ) ||
+      !query.exec( "CREATE INDEX IF NOT EXISTS contextChildIndex ON contextchildren( child )" ) ||
+      !query.exec( "CREATE TABLE IF NOT EXISTS contextvalues( context INTEGER, attribute TEXT, value TEXT, "
+                   "UNIQUE( context, attribute, value ) )" ) )
+  {
+    m_lastErrorMsg = QString( "Failed to create context tables for \"%1\": [%2]" )
+      .arg( m_sessionDB.connectionName() )
+      .arg( query.lastError().text() );
+    return false;
+  }
+
+  if( !query.exec( "CREATE TABLE IF NOT EXISTS rootelements( root QString primary key )" ) )
+  {
+    m_lastErrorMsg = QString( "Failed to create root elements table for \"%1\": [%2]" )
+      .arg( m_sessionDB.connectionName() )
+      .arg( query.lastError().text() );
+    return false;
+  }
+
+  if( !query.exec( QString( "PRAGMA user_version = %1" ).arg( SCHEMA_VERSION ) ) )
+  {
+    m_lastErrorMsg = QString( "Failed to set schema version for \"%1\": [%2]" )
+      .arg( m_sessionDB.connectionName() )
+      .arg( query.lastError().text() );
+    return false;
+  }
+
+  m_lastErrorMsg = "";
+  return true;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseInterface::migrateTables() const
+{
+  if( !beginTransaction() )
+  {
+    return false;
+  }
+
+  QSqlQuery query( m_sessionDB );
+
+  /* The legacy migration creates the current tables from scratch. */
+  if( !migrateLegacyTables() )
+  {
+    rollbackTransaction();
+    return false;
+  }
+
+  /* Values that predate frequency tracking are counted as having been encountered once. */
+  if( !query.exec( "UPDATE attributevalues SET frequency = 1 WHERE frequency = 0" ) )
+  {
+    m_lastErrorMsg = QString( "Failed to initialise attribute value frequencies for \"%1\": [%2]" )
+      .arg( m_sessionDB.connectionName() )
+      .arg( query.lastError().text() );
+    rollbackTransaction();
+    return false;
+  }
+
+  /* Existing profiles keep all their values until their attributes are written to. */
+  if( !inferAttributePolicies() )
+  {
+    rollbackTransaction();
+    return false;
+  }
+
+  if( !commitTransaction() )
+  {
+    return false;
+  }
+
+  m_lastErrorMsg = "";
+  return true;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseInterface::migrateLegacyTables() const
+{
+  QSqlQuery query( m_sessionDB );
+
+  /* Move the old tables out of the way so that the new ones can be created in their place. */
+  if( !query.exec( "ALTER TABLE xmlelements RENAME TO legacyelements" ) ||
+      !query.exec( "ALTER TABLE xmlattributes RENAME TO legacyattributes" ) )
+  {
+    m_lastErrorMsg = QString( "Failed to rename old tables for \"%1\": [%2]" )
+      .arg( m_sessionDB.connectionName() )
+      .arg( query.lastError().text() );
+    return false;
+  }
+
+  if( !createTables() )
+  {
+    return false;
+  }
+
+  /* Split the strings of strings into individual relationships. */
+  QVariantList elements;
+  QVariantList childParents;
+  QVariantList children;
+  QVariantList attributeElements;
+  QVariantList attributes;
+
+  if( !query.exec( "SELECT * FROM legacyelements" ) )
+  {
+    m_lastErrorMsg = QString( "SELECT old elements failed for \"%1\": [%2]" )
+      .arg( m_sessionDB.connectionName() )
+      .arg( query.lastError().text() );
+    return false;
+  }
+
+  while( query.next() )
+  {
+    QString element = query.record().field( "element" ).value().toString();
+    elements << element;
+
+    QStringList elementChildren = query.record().field( "children" ).value().toString().split( SEPARATOR );
+    cleanList( elementChildren );
+
+    foreach( QString child, elementChildren )
+    {
+      childParents << element;
+      children << child;
+    }
+
+    QStringList elementAttributes = query.record().field( "attributes" ).value().toString().split( SEPARATOR );
+    cleanList( elementAttributes );
+
+    foreach( QString attribute, elementAttributes )
+    {
+      attributeElements << element;
+      attributes << attribute;
+    }
+  }
+
+  QVariantList valueElements;
+  QVariantList valueAttributes;
+  QVariantList values;
+
+  if( !query.exec( "SELECT * FROM legacyattributes" ) )
+  {
+    m_lastErrorMsg = QString( "SELECT old attribute values failed for \"%1\": [%2]" )
+      .arg( m_sessionDB.connectionName() )
+      .arg( query.lastError().text() );
+    return false;
+  }
+
+  while( query.next() )
+  {
+    QString attribute = query.record().field( "attribute" ).value().toString();
+    QString associatedElement = query.record().field( "associatedElement" ).value().toString();
+
+    QStringList attributeValues = query.record().field( "attributeValues" ).value().toString().split( SEPARATOR );
+    cleanList( attributeValues );
+
+    foreach( QString value, attributeValues )
+    {
+      valueElements << associatedElement;
+      valueAttributes << attribute;
+      values << value;
+    }
+  }
+
+  /* The old tables can't be dropped while we're still reading from them. */
+  query.finish();
+
+  if( !execBatchQuery( INSERT_ELEMENT,
+                       QList< QVariantList >() << elements,
+                       "INSERT migrated elements" ) ||
+      !execBatchQuery( INSERT_CHILD,
+                       QList< QVariantList >() << childParents << children,
+                       "INSERT migrated element children" ) ||
+      !execBatchQuery( INSERT_ATTRIBUTE,
+                       QList< QVariantList >() << attributeElements << attributes,
+                       "INSERT migrated element attributes" ) ||
+      !execBatchQuery( INSERT_ATTRIBUTEVALUE,
+                       QList< QVariantList >() << valueElements << valueAttributes << values,
+                       "INSERT migrated attribute values" ) )
+  {
+    return false;
+  }
+
+  if( !query.exec( "DROP TABLE legacyattributes" ) ||
+      !query.exec( "DROP TABLE legacyelements" ) )
+  {
+    m_lastErrorMsg = QString( "Failed to drop old tables for \"%1\": [%2]" )
+      .arg( m_sessionDB.connectionName() )
+      .arg( query.lastError().text() );
+    return false;
+  }
+
+  return true;
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-const QString& GCDataBaseInterface::lastError() const
-{
-  return m_lastErrorMsg;
+void GCDataBaseInterface::saveDatabaseFile() const
+{
+  QFile flatFile( DB_FILE );
+
+  if( flatFile.open( QIODevice::ReadWrite | QIODevice::Text | QIODevice::Truncate ) )
+  {
+    QTextStream outStream( &flatFile );
+
+    foreach( QString str, m_dbMap.values() )
+    {
+      outStream << str << "\n";
+    }
+
+    flatFile.close();
+  }
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-bool GCDataBaseInterface::addDatabase( const QString& dbName )
+void GCDataBaseInterface::loadRootCatalog()
 {
-  if( !dbName.isEmpty() )
+  QFile flatFile( ROOT_CATALOG_FILE );
+
+  /* The catalog is rebuilt as databases are activated, so a missing file is not an error. */
+  if( flatFile.open( QIODevice::ReadOnly | QIODevice::Text ) )
   {
-    /* In case the db name passed in consists of a path/to/file string. */
-    QString dbConName = dbName.split( QRegExp( REGEXP_SLASHES ), QString::SkipEmptyParts ).last();
+    QTextStream inStream( &flatFile );
+    QStringList list = inStream.readAll().split( "\n", QString::SkipEmptyParts );
+    flatFile.close();
+
+    bool catalogChanged = false;
 
-    if( !m_dbMap.contains( dbConName ) )
+    foreach( QString str, list )
     {
-      QSqlDatabase db = QSqlDatabase::addDatabase( "QSQLITE", dbConName );
+      QStringList fields = str.trimmed().split( "\t", QString::SkipEmptyParts );
 
-      if( db.isValid() )
+      if( fields.isEmpty() ||
+          !m_dbMap.contains( fields.first() ) ||
+          m_catalogRoots.contains( fields.first() ) )
       {
-        db.setDatabaseName( dbName );
-        m_dbMap.insert( dbConName, dbName );
-        saveDatabaseFile();
-
-        m_lastErrorMsg = "";
-        return true;
+        catalogChanged = true;
+        continue;
       }
 
-      m_lastErrorMsg = QString( "Failed to add database \"%1\": [%2]." ).arg( dbConName ).arg( db.lastError().text() );
-      return false;
+      QString dbConName = fields.takeFirst();
+      m_catalogRoots.insert( dbConName, fields );
+
+      foreach( QString root, fields )
+      {
+        m_catalogProfiles[ root ].insert( dbConName );
+      }
     }
-    else
+
+    if( catalogChanged )
     {
-      m_lastErrorMsg = QString( "Connection \"%1\" already exists." ).arg( dbConName );
-      return false;
+      saveRootCatalog();
     }
   }
-
-  m_lastErrorMsg = QString( "Database name is empty." );
-  return false;
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-bool GCDataBaseInterface::removeDatabase( const QString& dbName )
+void GCDataBaseInterface::saveRootCatalog() const
 {
-  if( !dbName.isEmpty() )
-  {
-    /* In case the db name passed in consists of a path/to/file string. */
-    QString dbConName = dbName.split( QRegExp( REGEXP_SLASHES ), QString::SkipEmptyParts ).last();
-
-    if( m_sessionDB.connectionName() == dbConName )
-    {
-      m_sessionDB.close();
-      m_hasActiveSession = false;
-    }
+  QFile flatFile( ROOT_CATALOG_FILE );
 
-    QFile file( m_dbMap.value( dbConName ) );
+  if( flatFile.open( QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate ) )
+  {
+    QTextStream outStream( &flatFile );
 
-    if( !file.remove() )
+    foreach( QString dbConName, m_catalogRoots.keys() )
     {
-      m_lastErrorMsg = QString( "Failed to remove database file: [%1]" )
-        .arg( dbName );
-      return false;
+      outStream << ( QStringList( dbConName ) + m_catalogRoots.value( dbConName ) ).join( "\t" ) << "\n";
     }
 
-    /* If the DB connection being removed was also the active one, "removeDatabase" will output
-      a warning (to the Qt IDE's "Application Output" window).  This is purely because we have a
-      DB member variable and isn't cause for concern as there seems to be no way around it with
-      the current QtSQL modules. */
-    QSqlDatabase::removeDatabase( dbConName );
-    m_dbMap.remove( dbConName );
-    saveDatabaseFile();
-
-    m_lastErrorMsg = "";
-    return true;
+    flatFile.close();
   }
-
-  m_lastErrorMsg = QString( "Database name is empty." );
-  return false;
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-bool GCDataBaseInterface::setActiveDatabase( const QString& dbName )
+void GCDataBaseInterface::catalogueRootElements( const QString& dbConName, const QStringList& roots ) const
 {
-  /* In case the db name passed in consists of a path/to/file string. */
-  QString dbConName = dbName.split( QRegExp( REGEXP_SLASHES ), QString::SkipEmptyParts ).last();
+  QStringList sortedRoots( roots );
+  sortedRoots.sort();
 
-  if( QSqlDatabase::contains( dbConName ) )
+  if( m_catalogRoots.contains( dbConName ) &&
+      m_catalogRoots.value( dbConName ) == sortedRoots )
   {
-    if( openConnection( dbConName ) )
-    {
-      m_hasActiveSession = true;
-      return true;
-    }
+    return;
   }
-  else
+
+  foreach( QString root, m_catalogRoots.value( dbConName ) )
   {
-    /* If we set a DB for the session that doesn't exist (new, unknown),
-      then we'll automatically try to add it and set it as active. */
-    if( addDatabase( dbName ) )
+    m_catalogProfiles[ root ].remove( dbConName );
+
+    if( m_catalogProfiles.value( root ).isEmpty() )
     {
-      if( openConnection( dbConName ) )
-      {
-        m_hasActiveSession = true;
-        return true;
-      }
+      m_catalogProfiles.remove( root );
     }
+  }
 
-    m_hasActiveSession = false;
-    return false;
+  foreach( QString root, sortedRoots )
+  {
+    m_catalogProfiles[ root ].insert( dbConName );
   }
 
-  m_hasActiveSession = false;
-  return false;
+  m_catalogRoots.insert( dbConName, sortedRoots );
+  saveRootCatalog();
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-QStringList GCDataBaseInterface::knownAttributeKeys() const
+bool GCDataBaseInterface::catalogueDatabase( const QString& dbConName ) const
 {
-  QSqlQuery query = selectAllAttributes();
+  QSqlDatabase db = connection( dbConName );
 
-  m_lastErrorMsg = "";
+  if( db.isValid() && db.open() )
+  {
+    QStringList roots = knownRootElements( db );
 
-  QStringList attributeNames;
+    /* The active session shares the connection, so we mustn't close it from under it. */
+    if( m_sessionDB.connectionName() != dbConName )
+    {
+      db.close();
+    }
 
-  while( query.next() )
-  {
-    /* Concatenate the attribute name and associated element into a single string
-      so that it is easier to determine whether a record already exists for that
-      particular combination (this is used in GCBatchProcessorHelper). */
-    attributeNames.append( query.record().field( "attribute" ).value().toString() +
-                           "!" +
-                           query.record().field( "associatedElement" ).value().toString() );
+    catalogueRootElements( dbConName, roots );
+    return true;
   }
 
-  return attributeNames;
+  return false;
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-QSqlQuery GCDataBaseInterface::selectElement( const QString& element ) const
+void GCDataBaseInterface::updateRootCatalog() const
 {
-  /* See if we already have this element in the DB. */
-  QSqlQuery query( m_sessionDB );
-
-  if( !query.prepare( "SELECT * FROM xmlelements WHERE element = ?" ) )
+  if( m_dbMap.contains( m_sessionDB.connectionName() ) )
   {
-    m_lastErrorMsg = QString( "Prepare SELECT failed for element \"%1\": [%2]" )
-      .arg( element )
-      .arg( query.lastError().text() );
+    catalogueRootElements( m_sessionDB.connectionName(), m_cache.rootElements() );
   }
+}
 
-  query.addBindValue( element );
-
-  if( !query.exec() )
-  {
-    m_lastErrorMsg = QString( "SELECT element failed for element \"%1\": [%2]" )
-      .arg( element )
-      .arg( query.lastError().text() );
-  }
+/*--------------------------------------------------------------------------------------*/
 
-  return query;
+QString GCDataBaseInterface::snapshotFileName( const QString& dbConName ) const
+{
+  return m_dbMap.value( dbConName ) + SNAPSHOT_SUFFIX;
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-QSqlQuery GCDataBaseInterface::selectAllElements() const
+bool GCDataBaseInterface::attachProfile( const QString& dbName ) const
 {
-  QSqlQuery query( m_sessionDB );
+  QString dbConName = connectionName( dbName );
 
-  if( !query.exec( "SELECT * FROM xmlelements" ) )
+  if( !m_hasActiveSession )
   {
-    m_lastErrorMsg = QString( "SELECT all root elements failed: [%1]" )
-      .arg( query.lastError().text() );
+    m_lastErrorMsg = QString( "No active profile to compare \"%1\" with." ).arg( dbConName );
+    return false;
   }
 
-  return query;
-}
+  if( !m_dbMap.contains( dbConName ) || dbConName == m_sessionDB.connectionName() )
+  {
+    m_lastErrorMsg = QString( "\"%1\" is not a known profile other than the active one." ).arg( dbConName );
+    return false;
+  }
 
-/*--------------------------------------------------------------------------------------*/
+  if( m_inTransaction )
+  {
+    m_lastErrorMsg = QString( "Can't attach \"%1\" while a transaction is in progress." ).arg( dbConName );
+    return false;
+  }
 
-QSqlQuery GCDataBaseInterface::selectAttribute( const QString& attribute, const QString& associatedElement ) const
-{
   QSqlQuery query( m_sessionDB );
+  query.prepare( "ATTACH DATABASE ? AS other" );
+  query.addBindValue( m_dbMap.value( dbConName ) );
 
-  if( !query.prepare( "SELECT * FROM xmlattributes "
-                      "WHERE attribute = ? "
-                      "AND associatedElement = ?" ) )
+  if( !query.exec() )
   {
-    m_lastErrorMsg = QString( "Prepare SELECT attribute failed for attribute \"%1\" and element \"%2\": [%3]" )
-      .arg( attribute )
-      .arg( associatedElement )
+    m_lastErrorMsg = QString( "Failed to attach \"%1\": [%2]" )
+      .arg( dbConName )
       .arg( query.lastError().text() );
+    return false;
   }
 
-  query.addBindValue( attribute );
-  query.addBindValue( associatedElement );
-
-  if( !query.exec() )
+  /* Older databases are only migrated when they are opened, we won't do that behind the user's back. */
+  if( !query.exec( "PRAGMA other.user_version" ) || !query.next() || query.value( 0 ).toInt() != SCHEMA_VERSION )
   {
-    m_lastErrorMsg = QString( "SELECT attribute failed for attribute \"%1\" and element \"%2\": [%3]" )
-      .arg( attribute )
-      .arg( associatedElement )
-      .arg( query.lastError().text() );
+    m_lastErrorMsg = QString( "\"%1\" has to be set as the active profile once (to bring it up to date) before it can be compared or merged." )
+      .arg( dbConName );
+    query.finish();
+    detachProfile();
+    return false;
   }
 
-  return query;
+  query.finish();
+  return true;
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-QSqlQuery GCDataBaseInterface::selectAllAttributes() const
+void GCDataBaseInterface::detachProfile() const
 {
   QSqlQuery query( m_sessionDB );
-
-  if( !query.exec( "SELECT * FROM xmlattributes" ) )
-  {
-    m_lastErrorMsg = QString( "SELECT all attribute values failed: [%1]" )
-      .arg( query.lastError().text() );
-  }
-
-  return query;
+  query.exec( "DETACH DATABASE other" );
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-bool GCDataBaseInterface::removeDuplicatesFromFields() const
+bool GCDataBaseInterface::selectDifferences( const QString& from, const QString& to, GCProfileDifferences* differences ) const
 {
-  /* Remove duplicates and update the element records. */
-  QStringList elementNames = knownElements();
-  QString element( "" );
+  /* EXCEPT leaves it to SQLite to match up the (indexed) keys of both tables. */
+  QSqlQuery query( m_sessionDB );
 
-  for( int i = 0; i < elementNames.size(); ++i )
+  if( !execAttachedQuery( query,
+                          QString( "SELECT element FROM %1.xmlelements EXCEPT SELECT element FROM %2.xmlelements" ).arg( from ).arg( to ),
+                          "SELECT element differences" ) )
   {
-    element = elementNames.at( i );
-    QSqlQuery query = selectElement( element );
-
-    /* Not checking for query validity since the table may still be empty when
-      this funciton gets called (i.e. there is a potentially valid reason for cases
-      where no valid records exist). */
-    if( query.first() )
-    {
-      QStringList allChildren  ( query.record().field( "children" ).value().toString().split( SEPARATOR ) );
-      QStringList allAttributes( query.record().field( "attributes" ).value().toString().split( SEPARATOR ) );
-
-      if( !query.prepare( UPDATE_CHILDREN ) )
-      {
-        m_lastErrorMsg = QString( "Prepare UPDATE element children failed for element \"%1\": [%2]" )
-          .arg( element )
-          .arg( query.lastError().text() );
-        return false;
-      }
-
-      query.addBindValue( cleanAndJoinListElements( allChildren ) );
-      query.addBindValue( element );
-
-      if( !query.exec() )
-      {
-        m_lastErrorMsg = QString( "UPDATE children failed for element \"%1\": [%2]" )
-          .arg( element )
-          .arg( query.lastError().text() );
-        return false;
-      }
-
-      if( !query.prepare( UPDATE_ATTRIBUTES ) )
-      {
-        m_lastErrorMsg = QString( "Prepare UPDATE element attributes failed for element \"%1\": [%2]" )
-          .arg( element )
-          .arg( query.lastError().text() );
-        return false;
-      }
-
-      query.addBindValue( cleanAndJoinListElements( allAttributes ) );
-      query.addBindValue( element );
-
-      if( !query.exec() )
-      {
-        m_lastErrorMsg = QString( "UPDATE attributes failed for element \"%1\": [%2]" )
-          .arg( element )
-          .arg( query.lastError().text() );
-        return false;
-      }
-
-      qApp->processEvents( QEventLoop::ExcludeUserInputEvents );
-    }
+    return false;
   }
 
-  /* Remove duplicates and update the attribute values records. */
-  QStringList attributeKeys = knownAttributeKeys();
+  while( query.next() )
+  {
+    differences->elements.append( query.value( 0 ).toString() );
+  }
 
-  /* Not checking for query validity since the table may still be empty when
-    this funciton gets called (i.e. there is a potentially valid reason for cases
-    where no valid records exist). */
-  for( int i = 0; i < attributeKeys.size(); ++i )
+  if( !execAttachedQuery( query,
+                          QString( "SELECT element, child FROM %1.elementchildren EXCEPT SELECT element, child FROM %2.elementchildren" ).arg( from ).arg( to ),
+                          "SELECT child differences" ) )
   {
-    QString attribute = attributeKeys.at( i ).split( "!" ).at( 0 );
-    QString associatedElement = attributeKeys.at( i ).split( "!" ).at( 1 );
-    QSqlQuery query = selectAttribute( attribute, associatedElement );
+    return false;
+  }
 
-    /* Does a record for this attribute exist? */
-    if( query.first() )
-    {
-      QStringList allValues( query.record().field( "attributeValues" ).value().toString().split( SEPARATOR ) );
+  while( query.next() )
+  {
+    differences->children.append( GCRelationshipKey( query.value( 0 ).toString(), query.value( 1 ).toString() ) );
+  }
 
-      if( !query.prepare( UPDATE_ATTRIBUTEVALUES ) )
-      {
-        m_lastErrorMsg = QString( "Prepare UPDATE attribute values failed for element \"%1\" and attribute \"%2\": [%3]" )
-          .arg( associatedElement )
-          .arg( attribute )
-          .arg( query.lastError().text() );
-        return false;
-      }
+  if( !execAttachedQuery( query,
+                          QString( "SELECT element, attribute FROM %1.elementattributes EXCEPT SELECT element, attribute FROM %2.elementattributes" ).arg( from ).arg( to ),
+                          "SELECT attribute differences" ) )
+  {
+    return false;
+  }
 
-      query.addBindValue( cleanAndJoinListElements( allValues ) );
-      query.addBindValue( attribute );
-      query.addBindValue( associatedElement );
+  while( query.next() )
+  {
+    differences->attributes.append( GCRelationshipKey( query.value( 0 ).toString(), query.value( 1 ).toString() ) );
+  }
 
-      if( !query.exec() )
-      {
-        m_lastErrorMsg = QString( "UPDATE attribute values failed for element \"%1\" and attribute \"%2\": [%3]" )
-          .arg( associatedElement )
-          .arg( attribute )
-          .arg( query.lastError().text() );
-        return false;
-      }
+  if( !execAttachedQuery( query,
+                          QString( "SELECT element, attribute, value FROM %1.attributevalues "
+                                   "EXCEPT SELECT element, attribute, value FROM %2.attributevalues" ).arg( from ).arg( to ),
+                          "SELECT attribute value differences" ) )
+  {
+    return false;
+  }
 
-      qApp->processEvents( QEventLoop::ExcludeUserInputEvents );
-    }
+  while( query.next() )
+  {
+    GCValueMatch match;
+    match.element = query.value( 0 ).toString();
+    match.attribute = query.value( 1 ).toString();
+    match.value = query.value( 2 ).toString();
+    differences->values.append( match );
   }
 
-  m_lastErrorMsg = "";
   return true;
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-bool GCDataBaseInterface::openConnection( const QString& dbConName )
+bool GCDataBaseInterface::mergeAttachedProfile() const
 {
-  /* If we have a previous connection open, close it. */
-  if( m_sessionDB.isValid() && m_sessionDB.isOpen() )
+  /* The merge statements don't go through our own query functions. */
+  invalidateProfileSnapshot();
+
+  if( !beginTransaction() )
   {
-    m_sessionDB.close();
+    return false;
   }
 
-  /* Open the new connection. */
-  m_sessionDB = QSqlDatabase::database( dbConName );
+  QStringList statements;
+  statements << MERGE_ROOTELEMENTS
+             << MERGE_ELEMENTS
+             << MERGE_CHILDREN
+             << MERGE_ATTRIBUTES
+             << MERGE_ATTRIBUTEVALUEFREQUENCIES
+             << MERGE_ATTRIBUTEVALUES
+             << MERGE_CONTEXTS
+             << MERGE_CONTEXTELEMENTS
+             << MERGE_CONTEXTCHILDREN
+             << MERGE_CONTEXTVALUES;
+
+  QStringList descriptions;
+  descriptions << "Merge root elements"
+               << "Merge elements"
+               << "Merge element children"
+               << "Merge element attributes"
+               << "Merge attribute value frequencies"
+               << "Merge attribute values"
+               << "Merge contexts"
+               << "Merge context elements"
+               << "Merge context children"
+               << "Merge context attribute values";
 
-  if( m_sessionDB.isValid() )
+  QSqlQuery query( m_sessionDB );
+
+  for( int i = 0; i < statements.size(); ++i )
   {
-    if( !m_sessionDB.open() )
+    if( !execAttachedQuery( query, statements.at( i ), descriptions.at( i ) ) )
     {
-      m_lastErrorMsg = QString( "Failed to open database \"%1\": [%2]." )
-        .arg( m_dbMap.value( dbConName ) )
-        .arg( m_sessionDB.lastError().text() );
+      rollbackTransaction();
       return false;
     }
+  }
 
-    /* If the DB has not yet been initialised. */
-    QStringList tables = m_sessionDB.tables();
+  if( !execAttachedQuery( query,
+                          "SELECT element, attribute, flags, minimum, maximum FROM other.attributepolicies",
+                          "SELECT attribute policies to merge" ) )
+  {
+    rollbackTransaction();
+    return false;
+  }
 
-    if( !tables.contains( "xmlelements", Qt::CaseInsensitive ) )
-    {
-      return createTables();
-    }
+  QVariantList elements;
+  QVariantList attributes;
+  QVariantList flags;
+  QVariantList minimums;
+  QVariantList maximums;
+
+  while( query.next() )
+  {
+    elements << query.value( 0 );
+    attributes << query.value( 1 );
+    flags << query.value( 2 );
+    minimums << query.value( 3 );
+    maximums << query.value( 4 );
   }
-  else
+
+  query.finish();
+
+  /* Only once the values (and their frequencies) are merged can the excess be evicted. */
+  if( !writeAttributePolicies( m_sessionDB, elements, attributes, flags, minimums, maximums, m_lastErrorMsg, &m_preparedQueries ) )
   {
-    m_lastErrorMsg = QString( "Failed to open a valid session connection \"%1\": [%2]" )
-      .arg( dbConName )
-      .arg( m_sessionDB.lastError().text() );
+    rollbackTransaction();
     return false;
   }
 
-  m_lastErrorMsg = "";
-  return true;
+  return commitTransaction();
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-bool GCDataBaseInterface::createTables() const
+bool GCDataBaseInterface::loadActiveProfile() const
 {
-  /* DB connection will be open from openConnection() above so no need to do any checks here. */
-  QSqlQuery query( m_sessionDB );
-
-  if( !query.exec( "CREATE TABLE xmlelements( element QString primary key, children QString, attributes QString )" ) )
-  {
-    m_lastErrorMsg = QString( "Failed to create elements table for \"%1\": [%2]." )
-      .arg( m_sessionDB.connectionName() )
-      .arg( query.lastError().text() );
-    return false;
-  }
+  QFileInfo database = checkpointedDatabaseFile();
 
-  if( !query.exec( "CREATE TABLE xmlattributes( attribute QString, associatedElement QString, attributeValues QString, "
-                   "UNIQUE(attribute, associatedElement), "
-                   "FOREIGN KEY(associatedElement) REFERENCES xmlelements(element) )" ) )
-  {
-    m_lastErrorMsg = QString( "Failed to create attribute values table for \"%1\": [%2]" )
-      .arg( m_sessionDB.connectionName() )
-      .arg( query.lastError().text() );
-    return false;
-  }
-  else
+  if( m_cache.loadSnapshot( snapshotFileName( m_sessionDB.connectionName() ),
+                            database.size(),
+                            database.lastModified().toMSecsSinceEpoch() ) )
   {
-    if( !query.exec( "CREATE UNIQUE INDEX attributeKey ON xmlattributes( attribute, associatedElement)" ) )
-    {
-      m_lastErrorMsg = QString( "Failed to create unique index for \"%1\": [%2]" )
-        .arg( m_sessionDB.connectionName() )
-        .arg( query.lastError().text() );
-      return false;
-    }
+    updateRootCatalog();
+    m_cache.buildValueIndex();
+    m_lastErrorMsg = "";
+    return true;
   }
 
-  if( !query.exec( "CREATE TABLE rootelements( root QString primary key )" ) )
+  if( !loadProfileCache() )
   {
-    m_lastErrorMsg = QString( "Failed to create root elements table for \"%1\": [%2]" )
-      .arg( m_sessionDB.connectionName() )
-      .arg( query.lastError().text() );
     return false;
   }
 
+  /* Not being able to write the snapshot only means that the next switch will be slower. */
+  writeProfileSnapshot();
   m_lastErrorMsg = "";
   return true;
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-void GCDataBaseInterface::saveDatabaseFile() const
+void GCDataBaseInterface::invalidateProfileSnapshot() const
 {
-  QFile flatFile( DB_FILE );
-
-  if( flatFile.open( QIODevice::ReadWrite | QIODevice::Text | QIODevice::Truncate ) )
+  /* The file is removed straight away so that an outdated snapshot can't be loaded, even if the
+    application never gets to rebuild it. */
+  if( !m_snapshotDirty && m_sessionDB.isOpen() )
   {
-    QTextStream outStream( &flatFile );
+    QFile::remove( snapshotFileName( m_sessionDB.connectionName() ) );
+    m_snapshotDirty = true;
+  }
+}
 
-    foreach( QString str, m_dbMap.values() )
+/*--------------------------------------------------------------------------------------*/
+
+void GCDataBaseInterface::saveProfileSnapshot() const
+{
+  if( m_snapshotDirty && m_hasActiveSession )
+  {
+    /* A transaction that is still in progress could be rolled back and the cache doesn't know
+      about unfinished imports yet. */
+    if( !m_inTransaction &&
+        m_pendingImports.isEmpty() &&
+        writeProfileSnapshot() )
     {
-      outStream << str << "\n";
+      m_snapshotDirty = false;
     }
-
-    flatFile.close();
   }
 }
 
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseInterface::writeProfileSnapshot() const
+{
+  QFileInfo database = checkpointedDatabaseFile();
+  return m_cache.saveSnapshot( snapshotFileName( m_sessionDB.connectionName() ),
+                               database.size(),
+                               database.lastModified().toMSecsSinceEpoch() );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QFileInfo GCDataBaseInterface::checkpointedDatabaseFile() const
+{
+  /* In WAL mode, committed changes may still be in the write-ahead log (in which case the database
+    file itself doesn't reflect them yet), or could be moved into the database file by whichever
+    connection happens to close last.  Either way, the file's size and modification time would be
+    meaningless, so the log is emptied first (this does nothing in the other journal modes). */
+  QSqlQuery query( m_sessionDB );
+  query.exec( "PRAGMA wal_checkpoint( TRUNCATE )" );
+  query.finish();
+
+  return QFileInfo( m_sessionDB.databaseName() );
+}
+
 /*--------------------------------------------------------------------------------------*/
\ No newline at end of file
@@ -31,37 +31,98 @@
 
 #include <QObject>
 #include <QMap>
+#include <QHash>
+#include <QSet>
+#include <QPair>
+#include <QQueue>
+#include <QFuture>
+#include <QFutureInterface>
+#include <QSharedPointer>
 #include <QtSql/QSqlQuery>
 
+#include "gcprofilecache.h"
+#include "gcbatchprocessorhelper.h"
+
 class QDomDocument;
+class QFileInfo;
+class QThread;
+class GCDataBaseWorker;
+
+/*! Everything one profile knows about that another profile doesn't (see GCDataBaseInterface::profileDifferences). */
+struct GCProfileDifferences
+{
+  QStringList elements;
+  QList< GCRelationshipKey > children;    // element, child
+  QList< GCRelationshipKey > attributes;  // element, attribute
+  QList< GCValueMatch > values;
+};
 
 /// Provides a Singleton interface to the SQLite databases used to profile XML documents.
 
 /**
   This class is designed to set up and manage embedded SQLite databases used to profile
-  XML documents.  Databases created by this class will consist of three tables:
-
-    * "xmlelements"   - accepts element names as unique primary keys and associates two
-                        fields with each record: "children" represents all the first level
-                        children of the element in question and "attributes" contain all the
-                        attributes known to be associated with the element (these will be ALL
-                        the children and attribute names ever associated with any particular
-                        unique element name in any particular database so it is best not to mix
-                        vastly different XML profiles in the same database).
-
-    * "xmlattributes" - accepts an attribute name as primary key and references the unique element it
-                        is known to be associated with as foreign key.  Only one additional field exists
-                        for each record: "attributevalues" contains all the values ever associated with this
-                        particular attribute when assigned to the specific element it references
-                        as foreign key.  In other words, if element "x" is known to have had attribute
-                        "y" associated with it, then "attributevalues" will contain all the values
-                        ever assigned to "y" when associated with "x" across all XML profiles stored
-                        in a particular database.
-
-    * "rootelements"  - consists of a single field containing all known root elements stored in a
-                        specific database.  If more than one XML profile has been loaded into the
-                        database in question, the database will have all their root elements listed
-                        in this table.
+  XML documents.  Databases created by this class will consist of the following tables:
+
+    * "xmlelements"       - accepts element names as unique primary keys.
+
+    * "elementchildren"   - contains one record per element/first level child relationship.  These
+                            will be ALL the children ever associated with any particular unique element
+                            name in any particular database so it is best not to mix vastly different
+                            XML profiles in the same database.
+
+    * "elementattributes" - contains one record per element/attribute relationship (i.e. all the
+                            attributes known to be associated with the element in question).
+
+    * "attributevalues"   - contains one record per (element, attribute)/value relationship. In other
+                            words, if element "x" is known to have had attribute "y" associated with it,
+                            then there will be a record for every value ever assigned to "y" when
+                            associated with "x" across all XML profiles stored in a particular database.
+                            Each record also counts the number of times the value has been encountered
+                            (in imported documents and interactive edits), which is used to rank values,
+                            and records when the user last assigned the value (if ever).
+
+    * "attributepolicies" - contains one record per (element, attribute) with the type information inferred
+                            from the attribute's values (see GCAttributePolicy).  The policy determines how
+                            many of the attribute's values are kept (the least frequently used values are
+                            evicted first, except for those the user assigned recently), which stops
+                            attributes such as IDs, timestamps and GUIDs from growing the "attributevalues"
+                            table without bounds.
+
+    * "rootelements"      - consists of a single field containing all known root elements stored in a
+                            specific database.  If more than one XML profile has been loaded into the
+                            database in question, the database will have all their root elements listed
+                            in this table.
+
+    * "contexts", "contextchildren" and "contextvalues" - only populated by imports made while path-aware
+                            profiles are switched on (see "setPathAwareProfiles").  The first holds one record
+                            per context path (along with the path's last element), the other two hold the
+                            children and attribute values per context (referring to the context by its id
+                            rather than repeating the path).
+
+    * "contextelements"   - indexes every context by each of the elements in its path, so that the contexts
+                            affected by an element's removal are found without scanning the paths.
+
+  All relationship tables are keyed on unique indices so that adding (or checking for) a single child,
+  attribute or value never requires the entire list of known items to be read or rewritten.
+
+  Databases created by earlier versions of XML Mill stored children, attributes and attribute values as
+  single (possibly massive) strings of strings.  These are migrated to the above layout once, the first
+  time they are opened (the schema version is tracked via SQLite's "user_version" pragma).
+
+  The active profile is loaded into memory when a database is set as active and all the read functions
+  (e.g. "children", "attributes" and "attributeValues") are answered from this cache, which is kept up to
+  date by the functions that write to the database (see GCProfileCache).
+
+  Profiles can also be compared with and merged into one another without the documents they were built
+  from (see "profileDifferences" and "mergeProfile").  Both work on the databases directly (the other
+  profile is attached to the active connection), so neither profile has to fit in memory twice.
+
+  Imports and compatibility checks can take a while for large documents, which is why each of them
+  also has an asynchronous variant.  These are executed by a worker object that lives in its own thread
+  (with its own connection to the active database) and return a QFuture through which the caller can
+  monitor their progress and cancel them (e.g. with a QFutureWatcher).  Asynchronous imports update
+  the cache on the thread that owns this interface before their futures are finished, so the read
+  functions are always safe to call from there.
 */
 class GCDataBaseInterface : public QObject
 {
@@ -77,9 +138,47 @@ public:
 
   /*! Batch process an entire DOM document.  This function processes an entire DOM document by
       adding new (or updating existing) elements with their corresponding first level children
-      and associated attributes and known attribute values to the active database in batches. */
+      and associated attributes and known attribute values to the active database in batches.
+      The import is done in a single transaction, i.e. either all or nothing is written.
+      \sa batchProcessXmlFile */
   bool batchProcessDomDocument( const QDomDocument* domDoc ) const;
 
+  /*! Batch process an entire XML file.  The file is read in a single forward pass without building
+      a DOM document, which makes it possible to import files that are far too large to be opened for
+      editing.  Nothing is imported if the XML is broken.
+      \sa batchProcessDomDocument
+      \sa batchProcessXmlFiles */
+  bool batchProcessXmlFile( const QString& fileName ) const;
+
+  /*! Batch process a list of XML files.  The files are parsed concurrently (see GCBatchProcessorHelper)
+      and the merged result is written to the active database in a single transaction.  Files that can't
+      be opened or that contain broken XML are skipped (and described in "skippedFiles", if provided).
+      \sa batchProcessXmlFile */
+  bool batchProcessXmlFiles( const QStringList& fileNames, QStringList* skippedFiles = 0 ) const;
+
+  /*! Asynchronous variant of "batchProcessXmlFiles".  The returned future reports the number of files
+      processed so far as its progress and its result is "true" if the import succeeded.  A cancelled
+      future has no result, so check "isCanceled" before calling "result".  Files that were skipped
+      are available from "lastSkippedFiles" once the future has finished.
+      \sa batchProcessXmlFileAsync
+      \sa batchProcessXmlAsync */
+  QFuture< bool > batchProcessXmlFilesAsync( const QStringList& fileNames ) const;
+
+  /*! Asynchronous variant of "batchProcessXmlFile".  The returned future reports the (approximate)
+      number of characters read so far as its progress, see "batchProcessXmlFilesAsync" for the rest.
+      \sa batchProcessXmlFilesAsync */
+  QFuture< bool > batchProcessXmlFileAsync( const QString& fileName ) const;
+
+  /*! Batch processes the XML content in "xml" asynchronously (this is the asynchronous equivalent
+      of "batchProcessDomDocument" for documents that are already in memory), see
+      "batchProcessXmlFileAsync" for details.
+      \sa batchProcessXmlFilesAsync */
+  QFuture< bool > batchProcessXmlAsync( const QString& xml ) const;
+
+  /*! Returns the files that were skipped by the last asynchronous import (and why).
+      \sa batchProcessXmlFilesAsync */
+  const QStringList& lastSkippedFiles() const;
+
   /*! Adds a single new element to the active database. This function does nothing if an element with the same name
       already exists.
       @param element - the unique element name
@@ -121,9 +220,22 @@ public:
       the existing list. */
   bool updateAttributeValues( const QString& element, const QString& attribute, const QStringList& attributeValues, bool replace = false ) const;
 
+  /*! Records a single use of "value" for "element" and its corresponding "attribute" (e.g. when the
+      user assigns the value to an attribute), adding the value if it isn't known yet.
+      \sa rankedAttributeValues */
+  bool recordAttributeValue( const QString& element, const QString& attribute, const QString& value ) const;
+
   /*! Removes "element" from the active database. */
   bool removeElement( const QString& element ) const;
 
+  /*! Removes "element" and the entire hierarchy of elements below it from the active database in a
+      single transaction.  Children that are also associated with elements outside of the hierarchy are
+      kept (see "isUniqueChildElement").  Along with the elements themselves, their attributes, known
+      attribute values, root element entries and all references to them in other elements' child lists
+      are removed.  If provided, "removedElements" will contain the names of all the removed elements.
+      \sa removeElement */
+  bool removeElementTree( const QString& element, QStringList* removedElements = 0 ) const;
+
   /*! Removes "element" from the list of known root elements for the active database. */
   bool removeRootElement( const QString& element ) const;
 
@@ -135,6 +247,19 @@ public:
       in the active database. */
   bool removeAttribute( const QString& element, const QString& attribute ) const;
 
+  /*! Compares the active profile with that of "dbName" (a known database other than the active one).
+      Everything "dbName" knows about that the active profile doesn't is returned in "added" and everything
+      the active profile knows about that "dbName" doesn't in "removed" (either may be NULL).  Differences
+      in attribute value frequencies and policies are not reported.
+      \sa mergeProfile */
+  bool profileDifferences( const QString& dbName, GCProfileDifferences* added, GCProfileDifferences* removed = 0 ) const;
+
+  /*! Merges the profile of "dbName" (a known database other than the active one) into the active profile
+      in a single transaction.  The frequencies of the values known to both profiles are added up and the
+      attribute policies are merged as they would be by an import (which may evict values, see GCAttributePolicy).
+      \sa profileDifferences */
+  bool mergeProfile( const QString& dbName ) const;
+
   /*! Returns "true" if an active database session exists, "false" if not.
       \sa activeSessionName() */
   bool hasActiveSession() const;
@@ -142,16 +267,31 @@ public:
   /*! Returns "true" if the active database is empty, "false" if not. */
   bool isProfileEmpty() const;
 
-  /*! Returns "true" if the database named "dbName" knows about "root". */
+  /*! Returns "true" if the database named "dbName" knows about "root".  The check is done against
+      the root element catalog, the database itself is only opened if it hasn't been catalogued yet.
+      \sa profilesForRootElement */
   bool containsKnownRootElement( const QString& dbName, const QString& root ) const;
 
+  /*! Returns the (connection) names of all the known databases that know about "root", or an
+      empty QStringList if none exist.
+      \sa containsKnownRootElement */
+  QStringList profilesForRootElement( const QString& root ) const;
+
   /*! Returns true if "element" is a child of "parentElement" only (i.e. it doesn't exist
       in any other first level child list). */
   bool isUniqueChildElement( const QString& parentElement, const QString& element ) const;
 
   /*! Recursively scans the "doc"'s element hierarchy to ensure that all the document's elements,
-      element relationships and attributes are known to the active profile. */
-  bool isDocumentCompatible( const QDomDocument* doc ) const;
+      element relationships and attributes are known to the active profile.  The check is done against
+      the profile cache and stops at the first difference, unless "differences" is provided, in which case
+      a description of every difference is returned in the list. */
+  bool isDocumentCompatible( const QDomDocument* doc, QStringList* differences = 0 ) const;
+
+  /*! Asynchronous variant of "isDocumentCompatible" for the XML content in "xml" (checked in a single
+      streaming pass against a snapshot of the profile).  The returned future's result is "true" if the
+      document is compatible (broken XML is never compatible).  As with the asynchronous imports, a
+      cancelled future has no result. */
+  QFuture< bool > isDocumentCompatibleAsync( const QString& xml ) const;
 
   /*! Returns a sorted (case sensitive, ascending) list of all the element names known to
       the current database connection (the active session). */
@@ -172,6 +312,43 @@ public:
       unsuccessful/none exist. */
   QStringList attributeValues( const QString& element, const QString& attribute ) const;
 
+  /*! Returns (at most) "limit" of the values associated with "element" and its corresponding "attribute"
+      in the active database, most frequently used values first.  If "limit" is zero, all the values are
+      returned (in order of frequency).
+      \sa attributeValues */
+  QStringList rankedAttributeValues( const QString& element, const QString& attribute, int limit ) const;
+
+  /*! Returns the value policy (inferred type and range) of "element" and its corresponding "attribute"
+      in the active database. */
+  GCAttributePolicy attributePolicy( const QString& element, const QString& attribute ) const;
+
+  /*! Returns (at most) "limit" element, attribute and value combinations in the active database whose
+      values start with (GCValueIndex::PrefixMatch) or contain (GCValueIndex::SubstringMatch) "text",
+      ignoring case.  If "limit" is zero, all the matches are returned. */
+  QList< GCValueMatch > findAttributeValues( const QString& text, GCValueIndex::MatchMode mode, int limit ) const;
+
+  /*! Returns the number of element names that make up a context in path-aware profiles, or zero if
+      path-aware profiles are switched off.
+      \sa setPathAwareProfiles */
+  int contextDepth() const;
+
+  /*! Switches path-aware profiles on or off.  When switched on, imports record the children and attribute
+      values of each element against the element's context as well (see GCProfileCache::contextPath) so
+      that the context functions below can tell e.g. an "item" in an "order" from an "item" in a "menu". */
+  void setPathAwareProfiles( bool use );
+
+  /*! Returns the first level children of the last element in "path" (outermost element first), those
+      encountered in the same context first (sorted), followed by the element's other children (see
+      "children").  Only returns the element's children if path-aware profiles are switched off.
+      \sa contextDepth */
+  QStringList contextChildren( const QStringList& path ) const;
+
+  /*! As "contextChildren", but for the values associated with "attribute" (see "attributeValues"). */
+  QStringList contextAttributeValues( const QStringList& path, const QString& attribute ) const;
+
+  /*! As "contextAttributeValues", but ranked by frequency (see "rankedAttributeValues"). */
+  QStringList rankedContextAttributeValues( const QStringList& path, const QString& attribute, int limit ) const;
+
   /*! Returns a sorted (case sensitive, ascending) list of all the document root elements
       known to the the active database. */
   QStringList knownRootElements() const;
@@ -187,16 +364,32 @@ public:
   QString activeSessionName() const;
 
   public slots:
-  /*! Sets the database connection corresponding to "dbName" as the active database. */
+  /*! Sets the database connection corresponding to "dbName" as the active database.  This fails
+      while an asynchronous import is still busy. */
   bool setActiveDatabase( const QString& dbName );
 
   /*! Adds "dbName" to the list of known database connections. */
   bool addDatabase( const QString& dbName );
 
-  /*! Removes "dbName" from the list of known database connections. */
+  /*! Removes "dbName" from the list of known database connections.  This fails while an
+      asynchronous import is still busy. */
   bool removeDatabase( const QString& dbName );
 
+private slots:
+  /*! Called (in this object's thread) when the worker has completed an import.  Updates the cache
+      if the import succeeded and then finishes "future". */
+  void workerImportFinished( QFutureInterface< bool > future,
+                             QSharedPointer< GCBatchProcessorHelper > helper,
+                             bool success,
+                             const QString& errorMsg );
+
+  /*! Stops the worker thread (waits for the operation in progress, if any, to complete). */
+  void stopWorker();
+
 private:
+  /* The worker writes imports to the database using "writeBatch". */
+  friend class GCDataBaseWorker;
+
   static GCDataBaseInterface* m_instance;
 
   /*! Private constructor. */
@@ -208,47 +401,254 @@ private:
   /*! Closes assignment operator Singleton "loophole" by making it inaccessible. */
   GCDataBaseInterface& operator=( const GCDataBaseInterface& );
 
-  /*! Returns a list of known attributes. */
-  QStringList knownAttributeKeys() const;
+  /*! Writes everything extracted by "helper" to the active database (in a single transaction).
+      \sa batchProcessDomDocument
+      \sa batchProcessXmlFile */
+  bool batchProcess( const GCBatchProcessorHelper& helper ) const;
+
+  /*! Writes everything extracted by "helper" to "db" (the caller is responsible for the transaction).
+      If "progress" is provided, the write is abandoned between statements if it is cancelled.  Any
+      error is described in "errorMsg".  This function is static since it is used by both the
+      interface and its worker (each with its own connection). */
+  static bool writeBatch( QSqlDatabase db, const GCBatchProcessorHelper& helper, QString& errorMsg, GCBatchProgress* progress = 0 );
+
+  /*! Merges the policies described by the (equally sized) lists with the attribute policies in "db" and
+      (unless "evict" is false) evicts the values that exceed the merged policies' limits.  The policies are
+      merged by the database (rather than against the cache) so that this can also be used by the worker.
+      "errorMsg" and "preparedQueries" are as for "execBatchQuery". */
+  static bool writeAttributePolicies( QSqlDatabase db,
+                                      const QVariantList& elements,
+                                      const QVariantList& attributes,
+                                      const QVariantList& flags,
+                                      const QVariantList& minimums,
+                                      const QVariantList& maximums,
+                                      QString& errorMsg,
+                                      QHash< QString, QSqlQuery >* preparedQueries = 0,
+                                      bool evict = true );
+
+  /*! Infers "values"' policy and merges it with that of "element" and its corresponding "attribute" in
+      the active database (the caller is responsible for the transaction).
+      \sa cacheAttributePolicy */
+  bool updateAttributePolicy( const QString& element, const QString& attribute, const QStringList& values ) const;
+
+  /*! Does for the cache what "updateAttributePolicy" does for the database (call this once the transaction
+      has been committed). */
+  void cacheAttributePolicy( const QString& element, const QString& attribute, const QStringList& values ) const;
+
+  /*! Infers the policies of all the attributes in the active database from their known values (used
+      when migrating databases created before attribute policies existed).  Nothing is evicted. */
+  bool inferAttributePolicies() const;
+
+  /*! Adds everything extracted by "helper" to the cache (only call this once the helper's content has
+      been committed to the database). */
+  void updateProfileCache( const GCBatchProcessorHelper& helper ) const;
+
+  /*! Creates a future for an asynchronous operation and starts it by invoking "method" on the worker
+      with "argument" and the known profile lists.  The active profile can't be changed until the
+      import has finished (see "refuseWhileImporting"). */
+  QFuture< bool > startWorker( const char* method, QGenericArgument argument ) const;
+
+  /*! Returns "true" (and sets the last error message) if an asynchronous import is still busy.  Imports are
+      written to the database that was active when they were started, so the active database mustn't
+      change until they are done.  Writes made from the GUI thread are refused as well, they would only
+      wait for the worker's transaction (blocking the GUI) and then fail because the database is locked. */
+  bool refuseWhileImporting() const;
+
+  /*! Returns the set of known element/child relationships. */
+  GCRelationshipKeySet knownChildKeys() const;
+
+  /*! Returns the set of known element/attribute relationships. */
+  GCRelationshipKeySet knownAttributeKeys() const;
+
+  /*! Prepares "statement" (or reuses the cached prepared query, see "prepareQuery"), binds "bindValues"
+      (in order) and executes the query.  The active query is returned in "query" (the function does not
+      care whether or not any records exist).  Since the underlying statement is reused, SELECT results
+      should either be read to the end or released with "query.finish()".  "description" is used to build
+      a meaningful error message if anything goes wrong. */
+  bool execQuery( QSqlQuery& query, const QString& statement, const QVariantList& bindValues, const QString& description ) const;
+
+  /*! Prepares "statement" (or reuses the cached prepared query), binds each of the (equally sized) lists in
+      "bindLists" (in order) and executes the statement in batch mode.  "description" is used to build a
+      meaningful error message if anything goes wrong. */
+  bool execBatchQuery( const QString& statement, const QList< QVariantList >& bindLists, const QString& description ) const;
+
+  /*! Overloaded for use by "writeBatch", which may be called from the worker thread (and therefore only
+      uses "preparedQueries" if it is provided). */
+  static bool execBatchQuery( QSqlDatabase db,
+                              const QString& statement,
+                              const QList< QVariantList >& bindLists,
+                              const QString& description,
+                              QString& errorMsg,
+                              QHash< QString, QSqlQuery >* preparedQueries = 0 );
+
+  /*! Returns a query in "query" that has "statement" prepared on "db".  If "preparedQueries" is provided,
+      "statement" is only prepared the first time it is used and the prepared query is reused from the
+      cache after that (QSqlQuery objects are shallow handles, so copies share the compiled statement).
+      "description" and "errorMsg" are as for "execBatchQuery". */
+  static bool prepareQuery( QSqlDatabase db,
+                            QSqlQuery& query,
+                            const QString& statement,
+                            const QString& description,
+                            QString& errorMsg,
+                            QHash< QString, QSqlQuery >* preparedQueries = 0 );
 
-  /*! Selects "element" from the database.  The active query for the command is returned (the function does not
-      care whether or not the record exists). */
-  QSqlQuery selectElement( const QString& element ) const;
+  /*! Overloaded for private use. */
+  QStringList knownRootElements( QSqlDatabase db ) const;
 
-  /*! Selects all the known elements from the database and returns the active query. */
-  QSqlQuery selectAllElements() const;
+  /*! Starts a transaction on the active database (fails if a transaction is already in progress).
+      \sa commitTransaction
+      \sa rollbackTransaction */
+  bool beginTransaction() const;
 
-  /*! Selects the "attribute" corresponding to "associatedElement" from the database.  The active query for the command
-      is returned (the function does not care whether or not the record exists). */
-  QSqlQuery selectAttribute( const QString& attribute, const QString& associatedElement ) const;
+  /*! Commits the active transaction.
+      \sa beginTransaction
+      \sa rollbackTransaction */
+  bool commitTransaction() const;
 
-  /*! Selects all the known attributes from the database and returns the active query. */
-  QSqlQuery selectAllAttributes() const;
+  /*! Rolls back the active transaction (the last error message is left untouched so that the reason
+      for the rollback is not lost).
+      \sa beginTransaction
+      \sa commitTransaction */
+  void rollbackTransaction() const;
 
-  /*! Overloaded for private use. */
-  QStringList knownRootElements( QSqlDatabase db ) const;
+  /*! Loads the entire active profile into the cache.
+      \sa rollbackProfileCache */
+  bool loadProfileCache() const;
+
+  /*! Reloads the cache after a transaction was rolled back.
+      \sa loadProfileCache */
+  void rollbackProfileCache() const;
 
-  /*! Removes all duplicates that may have been introduced during batch processing.
-      After batch processing a DOM document, we concatenate new values to existing values
-      in the record fields.  This function removes all duplicates that may have been
-      introduced in this way by consolidating the values and updating the records. */
-  bool removeDuplicatesFromFields() const;
+  /*! Returns the PRAGMA statements that tune a connection according to the user's preset
+      (see GCGlobalSpace::databaseTuning).  Used for both the session and the worker connections. */
+  static QStringList tuningPragmas();
+
+  /*! Applies "tuningPragmas" to "db".  Returns "false" and sets "errorMsg" if any of the statements
+      fail or if the journal mode or synchronous level in effect afterwards isn't the one asked for
+      (e.g. because another connection prevents a journal mode change). */
+  static bool applyTuning( QSqlDatabase db, QString& errorMsg );
 
   /*! Opens the database connection corresponding to "dbConName".  This function will also close
       current sessions (if any) before opening the new one. */
   bool openConnection( const QString& dbConName );
 
-  /*! Creates all the relevant database tables. */
+  /*! Creates all the relevant database tables (only those that don't exist yet). */
   bool createTables() const;
 
+  /*! Converts a database created with the old layout (i.e. without a schema version) to the current
+      layout.  This is done once per database, in a single transaction. */
+  bool migrateTables() const;
+
+  /*! Converts a database created with the old "strings of strings" layout to the current
+      (normalised) layout (called from within "migrateTables"). */
+  bool migrateLegacyTables() const;
+
   /*! Saves the list of known databases to a text file. */
   void saveDatabaseFile() const;
 
+  /*! Adds "dbName" to the list of known databases without creating a connection or touching the
+      file (or the list of known databases on disk).  Returns "false" if the database is already known.
+      \sa connection */
+  bool registerDatabase( const QString& dbName );
+
+  /*! Returns the connection name for "dbName" (which may be a path/to/file string). */
+  static QString connectionName( const QString& dbName );
+
+  /*! Returns the (unopened) connection for the known database "dbConName", creating it
+      the first time it is requested. */
+  QSqlDatabase connection( const QString& dbConName ) const;
+
+  /*! Loads the root element catalog (the root elements known to each database) from its
+      text file.  Entries for unknown databases are dropped. */
+  void loadRootCatalog();
+
+  /*! Saves the root element catalog to a text file. */
+  void saveRootCatalog() const;
+
+  /*! Records "roots" as the complete list of root elements known to "dbConName" in the root
+      element catalog (the catalog file is only written if something changed). */
+  void catalogueRootElements( const QString& dbConName, const QStringList& roots ) const;
+
+  /*! Opens the known database "dbConName" to add its root elements to the catalog.  This is only
+      required for databases that haven't been catalogued yet (e.g. those added before the catalog
+      existed). */
+  bool catalogueDatabase( const QString& dbConName ) const;
+
+  /*! Updates the root element catalog entry of the active database from the profile cache. */
+  void updateRootCatalog() const;
+
+  /*! Returns the name of the profile snapshot file belonging to the known database "dbConName". */
+  QString snapshotFileName( const QString& dbConName ) const;
+
+  /*! Attaches the database of "dbName" to the active connection (as "other") for "profileDifferences"
+      and "mergeProfile".  This fails if "dbName" is unknown, is the active database or hasn't been
+      brought up to date yet, or if a transaction is in progress (SQLite can't attach databases
+      within transactions).
+      \sa detachProfile */
+  bool attachProfile( const QString& dbName ) const;
+
+  /*! Detaches the database attached by "attachProfile" (the error message is left untouched). */
+  void detachProfile() const;
+
+  /*! Executes "statement" without preparing it for reuse (statements referring to an attached database
+      mustn't outlive the attachment).  "query" and "description" are as for "execQuery". */
+  bool execAttachedQuery( QSqlQuery& query, const QString& statement, const QString& description ) const;
+
+  /*! Adds everything in the "from" schema that isn't in the "to" schema ("main" or "other") to "differences". */
+  bool selectDifferences( const QString& from, const QString& to, GCProfileDifferences* differences ) const;
+
+  /*! Merges the attached profile into the active profile in a single transaction (see "mergeProfile"). */
+  bool mergeAttachedProfile() const;
+
+  /*! Loads the profile cache of the freshly opened active database, from its snapshot if a valid
+      one that was taken from the database file in its current state exists, or from the database
+      itself if not (in which case the snapshot is created).
+      \sa loadProfileCache */
+  bool loadActiveProfile() const;
+
+  /*! Removes the active database's snapshot since the database is being (or has been) changed.
+      \sa saveProfileSnapshot */
+  void invalidateProfileSnapshot() const;
+
+  /*! Rebuilds the active database's snapshot if it was invalidated by writes. */
+  void saveProfileSnapshot() const;
+
+  /*! Saves the cache to the active database's snapshot, along with the database file's size and
+      modification time (see "checkpointedDatabaseFile").
+      \sa saveProfileSnapshot */
+  bool writeProfileSnapshot() const;
+
+  /*! Returns the file information of the active database once everything that was committed has
+      been written to the database file itself.  The file's size and modification time identify the
+      database state a snapshot belongs to, so that a database that was replaced, restored or changed
+      by another application isn't served from an outdated snapshot. */
+  QFileInfo checkpointedDatabaseFile() const;
+
   QSqlDatabase m_sessionDB;
+
+  /* Prepared queries for the active connection (keyed on statement), rebuilt whenever the
+    active connection changes. */
+  mutable QHash< QString/*statement*/, QSqlQuery > m_preparedQueries;
   mutable QString m_lastErrorMsg;
   bool m_hasActiveSession;
   bool m_initialised;
+  mutable bool m_inTransaction;
+  mutable GCProfileCache m_cache;
+  mutable bool m_snapshotDirty;
+  int m_contextDepth;
+  mutable QStringList m_lastSkippedFiles;
+  QThread* m_workerThread;
+  GCDataBaseWorker* m_worker;
+
+  /* The connection each unfinished import was started on, in the order in which the worker will
+    finish them. */
+  mutable QQueue< QString > m_pendingImports;
   QMap< QString/*connection name*/, QString /*file name*/ > m_dbMap;
+
+  /* The root element catalog in both directions: the catalogued databases with their root elements
+    and, for the actual lookups, each root element with the databases that know about it. */
+  mutable QMap< QString/*connection name*/, QStringList /*roots*/ > m_catalogRoots;
+  mutable QHash< QString/*root*/, QSet< QString > /*connection names*/ > m_catalogProfiles;
 };
 
 #endif // GCDATABASEINTERFACE_H
\ No newline at end of file
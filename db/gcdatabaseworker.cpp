@@ -0,0 +1,284 @@
+/* Copyright (c) 2012 - 2013 by William Hallatt.
+ *
+ * This file forms part of "XML Mill".
+ *
+ * The official website for this project is <http://www.goblincoding.com> and,
+ * although not compulsory, it would be appreciated if all works of whatever
+ * nature using this source code (in whole or in part) include a reference to
+ * this site.
+ *
+ * Should you wish to contact me for whatever reason, please do so via:
+ *
+ *                 <http://www.goblincoding.com/contact>
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program (GNUGPL.txt).  If not, see
+ *
+ *                    <http://www.gnu.org/licenses/>
+ */
+
+#include "gcdatabaseworker.h"
+#include "gcdatabaseinterface.h"
+
+#include <QFile>
+#include <QXmlStreamReader>
+#include <QtSql/QSqlError>
+
+/*--------------------------------------------------------------------------------------*/
+
+/* Name of the worker thread's own connection (distinct from the file-based names used by the interface). */
+static const QString WORKER_CONNECTION( "gcdatabaseworker" );
+
+/*--------------------------------- MEMBER FUNCTIONS ----------------------------------*/
+
+GCDataBaseWorker::GCDataBaseWorker()
+: QObject (),
+  m_db    (),
+  m_future()
+{
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+GCDataBaseWorker::~GCDataBaseWorker()
+{
+  closeConnection();
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCDataBaseWorker::setProgressRange( int minimum, int maximum )
+{
+  m_future.setProgressRange( minimum, maximum );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCDataBaseWorker::setProgressValue( int value )
+{
+  m_future.setProgressValue( value );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseWorker::isCanceled() const
+{
+  return m_future.isCanceled();
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCDataBaseWorker::openConnection( const QString& fileName )
+{
+  closeConnection();
+
+  m_db = QSqlDatabase::addDatabase( "QSQLITE", WORKER_CONNECTION );
+  m_db.setDatabaseName( fileName );
+
+  /* Failures are reported when (and if) the connection is used.  The session connection to the same
+    file has already been tuned successfully, so the worker's connection only picks up the per-connection
+    settings here (the journal mode is a property of the file). */
+  if( m_db.open() )
+  {
+    QString errorMsg;
+    GCDataBaseInterface::applyTuning( m_db, errorMsg );
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCDataBaseWorker::closeConnection()
+{
+  if( m_db.isValid() )
+  {
+    m_db.close();
+
+    /* All handles to the connection must be out of scope before it can be removed. */
+    m_db = QSqlDatabase();
+    QSqlDatabase::removeDatabase( WORKER_CONNECTION );
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCDataBaseWorker::importFiles( QFutureInterface< bool > future,
+                                    const QStringList& fileNames,
+                                    const QSet< QString >& knownElements,
+                                    const GCRelationshipKeySet& knownChildKeys,
+                                    const GCRelationshipKeySet& knownAttributeKeys,
+                                    int contextDepth )
+{
+  m_future = future;
+
+  QSharedPointer< GCBatchProcessorHelper > helper( new GCBatchProcessorHelper( fileNames,
+                                                                               knownElements,
+                                                                               knownChildKeys,
+                                                                               knownAttributeKeys,
+                                                                               contextDepth,
+                                                                               this ) );
+  writeBatch( helper );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCDataBaseWorker::importFile( QFutureInterface< bool > future,
+                                   const QString& fileName,
+                                   const QSet< QString >& knownElements,
+                                   const GCRelationshipKeySet& knownChildKeys,
+                                   const GCRelationshipKeySet& knownAttributeKeys,
+                                   int contextDepth )
+{
+  m_future = future;
+
+  QFile file( fileName );
+
+  /* Not opened in text mode, the stream reader takes care of the encoding. */
+  if( !file.open( QIODevice::ReadOnly ) )
+  {
+    emit importFinished( m_future,
+                         QSharedPointer< GCBatchProcessorHelper >(),
+                         false,
+                         QString( "Failed to open file \"%1\": [%2]" )
+                           .arg( fileName )
+                           .arg( file.errorString() ) );
+    m_future = QFutureInterface< bool >();
+    return;
+  }
+
+  /* The file size is in bytes rather than characters, but it's close enough for a progress bar. */
+  QXmlStreamReader reader( &file );
+  importStream( &reader, file.size(), knownElements, knownChildKeys, knownAttributeKeys, contextDepth );
+  file.close();
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCDataBaseWorker::importXml( QFutureInterface< bool > future,
+                                  const QString& xml,
+                                  const QSet< QString >& knownElements,
+                                  const GCRelationshipKeySet& knownChildKeys,
+                                  const GCRelationshipKeySet& knownAttributeKeys,
+                                  int contextDepth )
+{
+  m_future = future;
+
+  QXmlStreamReader reader( xml );
+  importStream( &reader, xml.size(), knownElements, knownChildKeys, knownAttributeKeys, contextDepth );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCDataBaseWorker::checkCompatibility( QFutureInterface< bool > future,
+                                           const QString& xml,
+                                           const GCProfileCache& profile )
+{
+  m_future = future;
+  m_future.setProgressRange( 0, xml.size() );
+
+  QXmlStreamReader reader( xml );
+  bool compatible = GCBatchProcessorHelper::isCompatible( &reader, profile, 0, this );
+
+  /* Nothing is reported if the check was cancelled (the future won't accept results at that
+    point anyway). */
+  if( !isCanceled() )
+  {
+    m_future.reportResult( compatible );
+  }
+
+  m_future.reportFinished();
+  m_future = QFutureInterface< bool >();
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCDataBaseWorker::importStream( QXmlStreamReader* reader,
+                                     qint64 size,
+                                     const QSet< QString >& knownElements,
+                                     const GCRelationshipKeySet& knownChildKeys,
+                                     const GCRelationshipKeySet& knownAttributeKeys,
+                                     int contextDepth )
+{
+  m_future.setProgressRange( 0, static_cast< int >( size ) );
+
+  QSharedPointer< GCBatchProcessorHelper > helper( new GCBatchProcessorHelper( reader,
+                                                                               knownElements,
+                                                                               knownChildKeys,
+                                                                               knownAttributeKeys,
+                                                                               contextDepth,
+                                                                               this ) );
+
+  /* Don't import anything from a broken document. */
+  if( reader->hasError() )
+  {
+    emit importFinished( m_future,
+                         helper,
+                         false,
+                         QString( "XML is broken - Error [%1], line [%2], column [%3]" )
+                           .arg( reader->errorString() )
+                           .arg( reader->lineNumber() )
+                           .arg( reader->columnNumber() ) );
+    m_future = QFutureInterface< bool >();
+    return;
+  }
+
+  writeBatch( helper );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCDataBaseWorker::writeBatch( QSharedPointer< GCBatchProcessorHelper > helper )
+{
+  QString errorMsg( "" );
+  bool success = false;
+
+  if( helper->wasCanceled() )
+  {
+    errorMsg = QString( "Import cancelled." );
+  }
+  else if( !m_db.isOpen() )
+  {
+    errorMsg = QString( "No open connection to the active database: [%1]" )
+      .arg( m_db.lastError().text() );
+  }
+  else if( !m_db.transaction() )
+  {
+    errorMsg = QString( "Failed to start transaction on \"%1\": [%2]" )
+      .arg( m_db.databaseName() )
+      .arg( m_db.lastError().text() );
+  }
+  else
+  {
+    /* Everything is written in a single transaction, so a cancelled (or failed) import
+      leaves nothing behind. */
+    if( GCDataBaseInterface::writeBatch( m_db, *helper, errorMsg, this ) )
+    {
+      if( m_db.commit() )
+      {
+        success = true;
+      }
+      else
+      {
+        errorMsg = QString( "Failed to commit transaction on \"%1\": [%2]" )
+          .arg( m_db.databaseName() )
+          .arg( m_db.lastError().text() );
+        m_db.rollback();
+      }
+    }
+    else
+    {
+      m_db.rollback();
+    }
+  }
+
+  emit importFinished( m_future, helper, success, errorMsg );
+  m_future = QFutureInterface< bool >();
+}
\ No newline at end of file
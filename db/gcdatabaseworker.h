@@ -0,0 +1,150 @@
+/* Copyright (c) 2012 - 2013 by William Hallatt.
+ *
+ * This file forms part of "XML Mill".
+ *
+ * The official website for this project is <http://www.goblincoding.com> and,
+ * although not compulsory, it would be appreciated if all works of whatever
+ * nature using this source code (in whole or in part) include a reference to
+ * this site.
+ *
+ * Should you wish to contact me for whatever reason, please do so via:
+ *
+ *                 <http://www.goblincoding.com/contact>
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program (GNUGPL.txt).  If not, see
+ *
+ *                    <http://www.gnu.org/licenses/>
+ */
+
+#ifndef GCDATABASEWORKER_H
+#define GCDATABASEWORKER_H
+
+#include <QObject>
+#include <QFutureInterface>
+#include <QSharedPointer>
+#include <QtSql/QSqlDatabase>
+
+#include "gcbatchprocessorhelper.h"
+#include "gcprofilecache.h"
+
+class QXmlStreamReader;
+
+/// Performs long-running profile operations on behalf of GCDataBaseInterface.
+
+/**
+  An instance of this class lives in a dedicated thread owned by GCDataBaseInterface and holds its
+  own connection to the active database (SQLite connections may only be used from the thread in
+  which they were created).  All the slots are meant to be invoked via queued connections and report
+  their progress and results through the QFutureInterface they are handed, which means that imports
+  and compatibility checks never block the UI.
+
+  Imports are written to the database here, but the profile cache belongs to GCDataBaseInterface, so
+  instead of finishing the future itself, the worker hands everything it extracted back to the
+  interface (see "importFinished") which updates the cache before reporting the result.
+
+  This class has been specifically designed to be used in conjunction with GCDataBaseInterface and
+  shouldn't be used on its own.
+*/
+class GCDataBaseWorker : public QObject, public GCBatchProgress
+{
+Q_OBJECT
+
+public:
+  /*! Constructor. */
+  GCDataBaseWorker();
+
+  /*! Destructor.  Closes the worker's database connection (if any). */
+  ~GCDataBaseWorker();
+
+  /*! Forwards "minimum" and "maximum" to the future of the operation in progress. */
+  void setProgressRange( int minimum, int maximum );
+
+  /*! Forwards "value" to the future of the operation in progress. */
+  void setProgressValue( int value );
+
+  /*! Returns "true" if the future of the operation in progress was cancelled. */
+  bool isCanceled() const;
+
+public slots:
+  /*! Opens a connection to the database file "fileName" (closing the current one, if any).  The
+      database is expected to have been created (or migrated) by GCDataBaseInterface already. */
+  void openConnection( const QString& fileName );
+
+  /*! Closes the worker's database connection. */
+  void closeConnection();
+
+  /*! Extracts everything from the list of files and writes it to the database.
+      \sa GCDataBaseInterface::batchProcessXmlFilesAsync */
+  void importFiles( QFutureInterface< bool > future,
+                    const QStringList& fileNames,
+                    const QSet< QString >& knownElements,
+                    const GCRelationshipKeySet& knownChildKeys,
+                    const GCRelationshipKeySet& knownAttributeKeys,
+                    int contextDepth );
+
+  /*! Extracts everything from a single file (in a single pass, without building a DOM document)
+      and writes it to the database.
+      \sa GCDataBaseInterface::batchProcessXmlFileAsync */
+  void importFile( QFutureInterface< bool > future,
+                   const QString& fileName,
+                   const QSet< QString >& knownElements,
+                   const GCRelationshipKeySet& knownChildKeys,
+                   const GCRelationshipKeySet& knownAttributeKeys,
+                   int contextDepth );
+
+  /*! Extracts everything from "xml" and writes it to the database.
+      \sa GCDataBaseInterface::batchProcessXmlAsync */
+  void importXml( QFutureInterface< bool > future,
+                  const QString& xml,
+                  const QSet< QString >& knownElements,
+                  const GCRelationshipKeySet& knownChildKeys,
+                  const GCRelationshipKeySet& knownAttributeKeys,
+                  int contextDepth );
+
+  /*! Reports "true" through "future" if all the elements, element relationships and attributes
+      in "xml" are known to "profile".  This function doesn't touch the database.
+      \sa GCDataBaseInterface::isDocumentCompatibleAsync */
+  void checkCompatibility( QFutureInterface< bool > future,
+                           const QString& xml,
+                           const GCProfileCache& profile );
+
+signals:
+  /*! Emitted when an import is done (whether or not it succeeded).  "future" has not been finished
+      yet, this is left to the receiver. */
+  void importFinished( QFutureInterface< bool > future,
+                       QSharedPointer< GCBatchProcessorHelper > helper,
+                       bool success,
+                       const QString& errorMsg );
+
+private:
+  /*! Extracts everything from "reader" and writes it to the database.  "size" is the (approximate)
+      number of characters to be read and is used as the progress range. */
+  void importStream( QXmlStreamReader* reader,
+                     qint64 size,
+                     const QSet< QString >& knownElements,
+                     const GCRelationshipKeySet& knownChildKeys,
+                     const GCRelationshipKeySet& knownAttributeKeys,
+                     int contextDepth );
+
+  /*! Writes everything extracted by "helper" to the database in a single transaction and
+      emits "importFinished". */
+  void writeBatch( QSharedPointer< GCBatchProcessorHelper > helper );
+
+  QSqlDatabase m_db;
+  QFutureInterface< bool > m_future;
+};
+
+Q_DECLARE_METATYPE( QFutureInterface< bool > )
+Q_DECLARE_METATYPE( QSharedPointer< GCBatchProcessorHelper > )
+
+#endif // GCDATABASEWORKER_H
\ No newline at end of file
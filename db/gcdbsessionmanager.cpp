@@ -267,7 +267,29 @@ void GCDBSessionManager::setDatabaseList()
   }
   else
   {
+    /* Profiles that already know the active document's root element are listed first (and
+      separated from the rest) since those are the ones the user can switch to without having
+      the document reset. */
+    QStringList candidates;
+
+    if( !m_currentRoot.isEmpty() )
+    {
+      candidates = GCDataBaseInterface::instance()->profilesForRootElement( m_currentRoot );
+
+      foreach( QString dbName, candidates )
+      {
+        dbList.removeAll( dbName );
+      }
+    }
+
     ui->okButton->setVisible( true );
+    ui->comboBox->addItems( candidates );
+
+    if( !candidates.isEmpty() && !dbList.isEmpty() )
+    {
+      ui->comboBox->insertSeparator( ui->comboBox->count() );
+    }
+
     ui->comboBox->addItems( dbList );
     ui->showHelpButton->setVisible( false );
   }
@@ -102,7 +102,9 @@ private:
   /*! Adds "dbName" to the list of known databases via GCDatabaseInterface. */
   void addDatabaseConnection( const QString& dbName );
 
-  /*! Sets the list of known database names on the combo box. */
+  /*! Sets the list of known database names on the combo box.  If a document is active, the
+      profiles that know its root element are listed first.
+      \sa GCDataBaseInterface::profilesForRootElement */
   void setDatabaseList();
 
   Ui::GCDBSessionManager* ui;
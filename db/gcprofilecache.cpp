@@ -0,0 +1,1413 @@
+/* Copyright (c) 2012 - 2013 by William Hallatt.
+ *
+ * This file forms part of "XML Mill".
+ *
+ * The official website for this project is <http://www.goblincoding.com> and,
+ * although not compulsory, it would be appreciated if all works of whatever
+ * nature using this source code (in whole or in part) include a reference to
+ * this site.
+ *
+ * Should you wish to contact me for whatever reason, please do so via:
+ *
+ *                 <http://www.goblincoding.com/contact>
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program (GNUGPL.txt).  If not, see
+ *
+ *                    <http://www.gnu.org/licenses/>
+ */
+
+#include "gcprofilecache.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QVector>
+#include <QPair>
+
+#include <algorithm>
+#include <iterator>
+#include <cstring>
+
+/*-------------------------------- SNAPSHOT FILE FORMAT --------------------------------*/
+
+/* Snapshots are local cache files, so all the integers are simply stored as native endian
+  quint32 values (a snapshot with a different byte order fails the magic number check):
+
+    header         : magic, version, payload size (in bytes), payload checksum,
+                     string, character, root, element, child, attribute, value key, value, policy,
+                     context, context child, context value key and context value counts,
+                     source size and source modification time (two words each, low word first)
+    string offsets : (string count + 1) offsets into the character data
+    roots          : string indices
+    elements       : (element count + 1) x { name, first child, first attribute }
+    children       : string indices
+    attributes     : string indices
+    value keys     : (value key count + 1) x { element, attribute, first value }
+    values         : string indices
+    frequencies    : value frequencies (in step with the values)
+    last used      : the last time each value was assigned by the user, in seconds since the epoch
+                     (in step with the values, zero if it never was)
+    policies       : policy count x { element, attribute, flags, has range, minimum, maximum }
+                     (the range values are doubles, i.e. two words each)
+    contexts       : (context count + 1) x { context, first child, unused }
+    context children : string indices
+    context value keys : (context value key count + 1) x { context, attribute, first value }
+    context values : string indices
+    characters     : UTF-16 data of all the strings
+
+  "First" fields are offsets into the corresponding arrays and the last (sentinel) record of
+  each table marks the end of the final range.  The checksum covers everything after the header.
+  The source fields identify the state of the database file the snapshot was taken from. */
+static const quint32 SNAPSHOT_MAGIC( 0x53504347 ); // "GCPS"
+static const quint32 SNAPSHOT_VERSION( 6 );
+static const int SNAPSHOT_HEADER_SIZE( 21 );       // in quint32 values
+static const int SNAPSHOT_RECORD_SIZE( 3 );        // in quint32 values
+static const int SNAPSHOT_POLICY_SIZE( 8 );        // in quint32 values
+
+/*--------------------------- NON-MEMBER UTILITY FUNCTIONS ----------------------------*/
+
+/* Returns the index of "str" in "strings", adding it if it hasn't been seen before. */
+quint32 internString( const QString& str, QHash< QString, quint32 >& indices, QVector< QString >& strings )
+{
+  QHash< QString, quint32 >::const_iterator iter = indices.constFind( str );
+
+  if( iter != indices.constEnd() )
+  {
+    return iter.value();
+  }
+
+  quint32 index = strings.size();
+  indices.insert( str, index );
+  strings.append( str );
+  return index;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+/* 32-bit FNV-1a hash of "size" bytes of "data". */
+quint32 snapshotChecksum( const uchar* data, qint64 size )
+{
+  quint32 hash = 2166136261u;
+
+  for( qint64 i = 0; i < size; ++i )
+  {
+    hash = ( hash ^ data[ i ] ) * 16777619u;
+  }
+
+  return hash;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void appendWords( QByteArray& bytes, const QVector< quint32 >& words )
+{
+  bytes.append( reinterpret_cast< const char* >( words.constData() ), words.size() * sizeof( quint32 ) );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void appendDouble( QVector< quint32 >& words, double value )
+{
+  quint32 halves[ 2 ];
+  std::memcpy( halves, &value, sizeof( double ) );
+  words << halves[ 0 ] << halves[ 1 ];
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+double readDouble( const quint32* words )
+{
+  double value;
+  std::memcpy( &value, words, sizeof( double ) );
+  return value;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+/* Returns "true" if all "count" indices are smaller than "limit". */
+bool validIndices( const quint32* indices, quint32 count, quint32 limit )
+{
+  for( quint32 i = 0; i < count; ++i )
+  {
+    if( indices[ i ] >= limit )
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+/* Returns "true" if the "first" fields (at "field") of the "count" + 1 records in "records" are
+  ascending, starting at zero and ending at "total". */
+bool validRanges( const quint32* records, quint32 count, int field, quint32 total )
+{
+  if( records[ field ] != 0 || records[ count * SNAPSHOT_RECORD_SIZE + field ] != total )
+  {
+    return false;
+  }
+
+  for( quint32 i = 0; i < count; ++i )
+  {
+    if( records[ i * SNAPSHOT_RECORD_SIZE + field ] > records[ ( i + 1 ) * SNAPSHOT_RECORD_SIZE + field ] )
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/*--------------------------------- MEMBER FUNCTIONS ----------------------------------*/
+
+GCProfileCache::GCProfileCache()
+: m_rootElements   (),
+  m_children       (),
+  m_parents        (),
+  m_attributes     (),
+  m_attributeValues(),
+  m_valueFrequencies(),
+  m_valueLastUsed  (),
+  m_attributePolicies(),
+  m_contextChildren(),
+  m_contextValues  (),
+  m_elementContexts(),
+  m_childContexts  (),
+  m_valueIndex     (),
+  m_valueIndexBuilt( false )
+{
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::clear()
+{
+  m_rootElements.clear();
+  m_children.clear();
+  m_parents.clear();
+  m_attributes.clear();
+  m_attributeValues.clear();
+  m_valueFrequencies.clear();
+  m_valueLastUsed.clear();
+  m_attributePolicies.clear();
+  m_contextChildren.clear();
+  m_contextValues.clear();
+  m_elementContexts.clear();
+  m_childContexts.clear();
+  m_valueIndex.clear();
+  m_valueIndexBuilt = false;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCProfileCache::containsElement( const QString& element ) const
+{
+  return m_children.contains( element );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QStringList GCProfileCache::elements() const
+{
+  QStringList elements = m_children.keys();
+  elements.sort();
+  return elements;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QSet< QString > GCProfileCache::elementSet() const
+{
+  QSet< QString > elements;
+  elements.reserve( m_children.size() );
+
+  for( QHash< QString, QStringList >::const_iterator iter = m_children.constBegin(); iter != m_children.constEnd(); ++iter )
+  {
+    elements.insert( iter.key() );
+  }
+
+  return elements;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QStringList GCProfileCache::children( const QString& element ) const
+{
+  return m_children.value( element );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCProfileCache::containsChild( const QString& element, const QString& child ) const
+{
+  /* The child lists are sorted. */
+  QHash< QString, QStringList >::const_iterator iter = m_children.constFind( element );
+  return ( iter != m_children.constEnd() &&
+           std::binary_search( iter.value().constBegin(), iter.value().constEnd(), child ) );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QSet< QString > GCProfileCache::parents( const QString& child ) const
+{
+  return m_parents.value( child );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCProfileCache::containsAttribute( const QString& element, const QString& attribute ) const
+{
+  QHash< QString, QStringList >::const_iterator iter = m_attributes.constFind( element );
+  return ( iter != m_attributes.constEnd() &&
+           iter.value().contains( attribute ) );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QStringList GCProfileCache::attributes( const QString& element ) const
+{
+  return m_attributes.value( element );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QStringList GCProfileCache::attributeValues( const QString& element, const QString& attribute ) const
+{
+  return m_attributeValues.value( element ).value( attribute );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QStringList GCProfileCache::rankedAttributeValues( const QString& element, const QString& attribute, int limit ) const
+{
+  return rankValues( attributeValues( element, attribute ), m_valueFrequencies.value( element ).value( attribute ), limit );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QStringList GCProfileCache::rankValues( const QStringList& values, const QHash< QString, int >& frequencies, int limit )
+{
+  if( limit <= 0 || limit > values.size() )
+  {
+    limit = values.size();
+  }
+
+  /* Negated frequencies sort the most frequent values first and, since the values are sorted,
+    the indices take care of the ties.  Only the top "limit" entries have to be put in order. */
+  QVector< QPair< int/*negated frequency*/, int/*index*/ > > ranking;
+  ranking.reserve( values.size() );
+
+  for( int i = 0; i < values.size(); ++i )
+  {
+    ranking.append( qMakePair( -frequencies.value( values.at( i ) ), i ) );
+  }
+
+  std::partial_sort( ranking.begin(), ranking.begin() + limit, ranking.end() );
+
+  QStringList ranked;
+  ranked.reserve( limit );
+
+  for( int i = 0; i < limit; ++i )
+  {
+    ranked.append( values.at( ranking.at( i ).second ) );
+  }
+
+  return ranked;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+int GCProfileCache::attributeValueFrequency( const QString& element, const QString& attribute, const QString& value ) const
+{
+  return m_valueFrequencies.value( element ).value( attribute ).value( value );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+GCAttributePolicy GCProfileCache::attributePolicy( const QString& element, const QString& attribute ) const
+{
+  return m_attributePolicies.value( element ).value( attribute );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QList< GCValueMatch > GCProfileCache::findAttributeValues( const QString& text, GCValueIndex::MatchMode mode, int limit ) const
+{
+  buildValueIndex();
+  return m_valueIndex.find( text, mode, limit );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::buildValueIndex() const
+{
+  if( !m_valueIndexBuilt )
+  {
+    for( QHash< QString, QHash< QString, QStringList > >::const_iterator element = m_attributeValues.constBegin();
+         element != m_attributeValues.constEnd();
+         ++element )
+    {
+      for( QHash< QString, QStringList >::const_iterator attribute = element.value().constBegin();
+           attribute != element.value().constEnd();
+           ++attribute )
+      {
+        foreach( QString value, attribute.value() )
+        {
+          m_valueIndex.addValue( element.key(), attribute.key(), value );
+        }
+      }
+    }
+
+    m_valueIndexBuilt = true;
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCProfileCache::containsContext( const QString& context ) const
+{
+  return m_contextChildren.contains( context );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QStringList GCProfileCache::contextChildren( const QString& context ) const
+{
+  return m_contextChildren.value( context );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QStringList GCProfileCache::contextAttributeValues( const QString& context, const QString& attribute ) const
+{
+  return m_contextValues.value( context ).value( attribute );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QStringList GCProfileCache::rankedContextAttributeValues( const QString& context, const QString& attribute, int limit ) const
+{
+  QString element = context.section( '/', -1 );
+  return rankValues( contextAttributeValues( context, attribute ), m_valueFrequencies.value( element ).value( attribute ), limit );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QString GCProfileCache::contextPath( const QStringList& path, int depth )
+{
+  return QStringList( path.mid( qMax( 0, path.size() - depth ) ) ).join( "/" );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QString GCProfileCache::childContext( const QString& parentContext, const QString& child, int depth )
+{
+  if( parentContext.isEmpty() )
+  {
+    return child;
+  }
+
+  QString context = QString( "%1/%2" ).arg( parentContext ).arg( child );
+
+  /* The parent's context is at most "depth" names long, so at most one name has to go. */
+  if( context.count( '/' ) >= depth )
+  {
+    context = context.section( '/', 1 );
+  }
+
+  return context;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+const QStringList& GCProfileCache::rootElements() const
+{
+  return m_rootElements;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::addElement( const QString& element )
+{
+  if( !m_children.contains( element ) )
+  {
+    m_children.insert( element, QStringList() );
+    m_attributes.insert( element, QStringList() );
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::removeElement( const QString& element )
+{
+  removeChildren( element );
+  m_children.remove( element );
+  m_attributes.remove( element );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::addRootElement( const QString& root )
+{
+  if( !m_rootElements.contains( root ) )
+  {
+    m_rootElements.append( root );
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::removeRootElement( const QString& root )
+{
+  m_rootElements.removeAll( root );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::addChildren( const QString& element, const QStringList& children )
+{
+  /* Inserts a new (empty) list if the element isn't known yet. */
+  mergeSorted( m_children[ element ], children );
+
+  foreach( QString child, children )
+  {
+    m_parents[ child ].insert( element );
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::addChildren( const QHash< QString, QStringList >& children )
+{
+  for( QHash< QString, QStringList >::const_iterator iter = children.constBegin(); iter != children.constEnd(); ++iter )
+  {
+    addChildren( iter.key(), iter.value() );
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::removeChildren( const QString& element )
+{
+  if( m_children.contains( element ) )
+  {
+    foreach( QString child, m_children.value( element ) )
+    {
+      removeParent( child, element );
+    }
+
+    m_children[ element ].clear();
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::removeChild( const QString& element, const QString& child )
+{
+  if( m_children.contains( element ) )
+  {
+    m_children[ element ].removeAll( child );
+    removeParent( child, element );
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::addAttributes( const QString& element, const QStringList& attributes )
+{
+  QStringList& knownAttributes = m_attributes[ element ];
+
+  foreach( QString attribute, attributes )
+  {
+    if( !knownAttributes.contains( attribute ) )
+    {
+      knownAttributes.append( attribute );
+    }
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::removeAttributes( const QString& element )
+{
+  if( m_attributes.contains( element ) )
+  {
+    m_attributes[ element ].clear();
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::removeAttribute( const QString& element, const QString& attribute )
+{
+  if( m_attributes.contains( element ) )
+  {
+    m_attributes[ element ].removeAll( attribute );
+  }
+
+  removeAttributeValues( element, attribute );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::addAttributeValues( const QString& element, const QString& attribute, const QStringList& values )
+{
+  mergeSorted( m_attributeValues[ element ][ attribute ], values );
+
+  if( m_valueIndexBuilt )
+  {
+    foreach( QString value, values )
+    {
+      m_valueIndex.addValue( element, attribute, value );
+    }
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::addAttributeValues( const QHash< QString, QHash< QString, QStringList > >& values )
+{
+  for( QHash< QString, QHash< QString, QStringList > >::const_iterator iter = values.constBegin(); iter != values.constEnd(); ++iter )
+  {
+    for( QHash< QString, QStringList >::const_iterator attribute = iter.value().constBegin(); attribute != iter.value().constEnd(); ++attribute )
+    {
+      addAttributeValues( iter.key(), attribute.key(), attribute.value() );
+    }
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::removeAttributeValues( const QString& element, const QString& attribute )
+{
+  unindexAttributeValues( element, attribute );
+
+  if( m_attributeValues.contains( element ) )
+  {
+    m_attributeValues[ element ].remove( attribute );
+  }
+
+  if( m_valueFrequencies.contains( element ) )
+  {
+    m_valueFrequencies[ element ].remove( attribute );
+  }
+
+  if( m_valueLastUsed.contains( element ) )
+  {
+    m_valueLastUsed[ element ].remove( attribute );
+  }
+
+  if( m_attributePolicies.contains( element ) )
+  {
+    m_attributePolicies[ element ].remove( attribute );
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::removeElementValues( const QString& element )
+{
+  QSet< QString > attributes = m_attributeValues.value( element ).keys().toSet();
+  attributes += m_valueFrequencies.value( element ).keys().toSet();
+  attributes += m_valueLastUsed.value( element ).keys().toSet();
+  attributes += m_attributePolicies.value( element ).keys().toSet();
+
+  foreach( QString attribute, attributes )
+  {
+    removeAttributeValues( element, attribute );
+  }
+
+  m_attributeValues.remove( element );
+  m_valueFrequencies.remove( element );
+  m_valueLastUsed.remove( element );
+  m_attributePolicies.remove( element );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::removeAttributeValue( const QString& element, const QString& attribute, const QString& value )
+{
+  if( m_attributeValues.contains( element ) && m_attributeValues.value( element ).contains( attribute ) )
+  {
+    m_attributeValues[ element ][ attribute ].removeAll( value );
+  }
+
+  if( m_valueFrequencies.contains( element ) && m_valueFrequencies.value( element ).contains( attribute ) )
+  {
+    m_valueFrequencies[ element ][ attribute ].remove( value );
+  }
+
+  if( m_valueLastUsed.contains( element ) && m_valueLastUsed.value( element ).contains( attribute ) )
+  {
+    m_valueLastUsed[ element ][ attribute ].remove( value );
+  }
+
+  if( m_valueIndexBuilt )
+  {
+    m_valueIndex.removeValue( element, attribute, value );
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::addAttributeValueFrequency( const QString& element, const QString& attribute, const QString& value, int count )
+{
+  m_valueFrequencies[ element ][ attribute ][ value ] += count;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::setAttributeValueLastUsed( const QString& element, const QString& attribute, const QString& value, uint time )
+{
+  m_valueLastUsed[ element ][ attribute ][ value ] = time;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::addContext( const QString& context )
+{
+  if( !m_contextChildren.contains( context ) )
+  {
+    m_contextChildren.insert( context, QStringList() );
+
+    foreach( QString element, context.split( '/' ) )
+    {
+      m_elementContexts[ element ].insert( context );
+    }
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::addContextChildren( const QString& context, const QStringList& children )
+{
+  addContext( context );
+  mergeSorted( m_contextChildren[ context ], children );
+
+  foreach( QString child, children )
+  {
+    m_childContexts[ child ].insert( context );
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::addContextChildren( const QHash< QString, QStringList >& children )
+{
+  for( QHash< QString, QStringList >::const_iterator iter = children.constBegin(); iter != children.constEnd(); ++iter )
+  {
+    addContextChildren( iter.key(), iter.value() );
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::addContextAttributeValues( const QString& context, const QString& attribute, const QStringList& values )
+{
+  addContext( context );
+  mergeSorted( m_contextValues[ context ][ attribute ], values );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::addContextAttributeValues( const QHash< QString, QHash< QString, QStringList > >& values )
+{
+  for( QHash< QString, QHash< QString, QStringList > >::const_iterator iter = values.constBegin(); iter != values.constEnd(); ++iter )
+  {
+    for( QHash< QString, QStringList >::const_iterator attribute = iter.value().constBegin(); attribute != iter.value().constEnd(); ++attribute )
+    {
+      addContextAttributeValues( iter.key(), attribute.key(), attribute.value() );
+    }
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::removeContexts( const QString& element )
+{
+  foreach( QString context, m_elementContexts.value( element ) )
+  {
+    removeContext( context );
+  }
+
+  /* Whatever is left in the child index for the element are contexts that don't contain it. */
+  foreach( QString context, m_childContexts.take( element ) )
+  {
+    m_contextChildren[ context ].removeAll( element );
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::removeContextChild( const QString& element, const QString& child )
+{
+  foreach( QString context, m_elementContexts.value( element ) )
+  {
+    if( isContextOf( context, element ) && m_contextChildren[ context ].removeAll( child ) > 0 )
+    {
+      removeFromIndex( m_childContexts, child, context );
+    }
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::removeContextAttribute( const QString& element, const QString& attribute )
+{
+  foreach( QString context, m_elementContexts.value( element ) )
+  {
+    QHash< QString, QHash< QString, QStringList > >::iterator iter = m_contextValues.find( context );
+
+    if( iter != m_contextValues.end() && isContextOf( context, element ) )
+    {
+      iter.value().remove( attribute );
+    }
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::removeContextAttributeValue( const QString& element, const QString& attribute, const QString& value )
+{
+  foreach( QString context, m_elementContexts.value( element ) )
+  {
+    QHash< QString, QHash< QString, QStringList > >::iterator iter = m_contextValues.find( context );
+
+    if( iter != m_contextValues.end() && isContextOf( context, element ) && iter.value().contains( attribute ) )
+    {
+      iter.value()[ attribute ].removeAll( value );
+    }
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::mergeAttributePolicy( const QString& element, const QString& attribute, const GCAttributePolicy& policy, bool evict )
+{
+  GCAttributePolicy& merged = m_attributePolicies[ element ][ attribute ];
+  merged.merge( policy );
+
+  /* Same selection as the database makes (see GCDataBaseInterface). */
+  QStringList& values = m_attributeValues[ element ][ attribute ];
+
+  if( evict && values.size() > merged.valueLimit() )
+  {
+    QStringList kept = rankedAttributeValues( element, attribute, merged.valueLimit() );
+    kept.sort();
+
+    QHash< QString, int >& frequencies = m_valueFrequencies[ element ][ attribute ];
+    QHash< QString, uint > lastUsed = m_valueLastUsed.value( element ).value( attribute );
+    uint cutoff = GCAttributePolicy::protectionCutoff();
+
+    /* The values are sorted, so the remaining values are too. */
+    QStringList remaining;
+
+    foreach( QString value, values )
+    {
+      if( std::binary_search( kept.constBegin(), kept.constEnd(), value ) ||
+          ( lastUsed.contains( value ) && lastUsed.value( value ) >= cutoff ) )
+      {
+        remaining.append( value );
+      }
+      else
+      {
+        frequencies.remove( value );
+
+        if( lastUsed.contains( value ) )
+        {
+          m_valueLastUsed[ element ][ attribute ].remove( value );
+        }
+
+        if( m_valueIndexBuilt )
+        {
+          m_valueIndex.removeValue( element, attribute, value );
+        }
+      }
+    }
+
+    values = remaining;
+
+    /* Context values are bounded by the element's values (the database does the same). */
+    foreach( QString context, m_elementContexts.value( element ) )
+    {
+      QHash< QString, QHash< QString, QStringList > >::iterator iter = m_contextValues.find( context );
+
+      if( iter != m_contextValues.end() && isContextOf( context, element ) && iter.value().contains( attribute ) )
+      {
+        QStringList contextValues;
+
+        foreach( QString value, iter.value().value( attribute ) )
+        {
+          if( std::binary_search( remaining.constBegin(), remaining.constEnd(), value ) )
+          {
+            contextValues.append( value );
+          }
+        }
+
+        iter.value()[ attribute ] = contextValues;
+      }
+    }
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::unindexAttributeValues( const QString& element, const QString& attribute )
+{
+  if( m_valueIndexBuilt )
+  {
+    foreach( QString value, m_attributeValues.value( element ).value( attribute ) )
+    {
+      m_valueIndex.removeValue( element, attribute, value );
+    }
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCProfileCache::isContextOf( const QString& context, const QString& element )
+{
+  return ( context == element || context.endsWith( QString( "/%1" ).arg( element ) ) );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::removeParent( const QString& child, const QString& parent )
+{
+  removeFromIndex( m_parents, child, parent );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::removeContext( const QString& context )
+{
+  foreach( QString child, m_contextChildren.take( context ) )
+  {
+    removeFromIndex( m_childContexts, child, context );
+  }
+
+  foreach( QString element, context.split( '/' ) )
+  {
+    removeFromIndex( m_elementContexts, element, context );
+  }
+
+  m_contextValues.remove( context );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::removeFromIndex( QHash< QString, QSet< QString > >& index, const QString& key, const QString& value )
+{
+  QHash< QString, QSet< QString > >::iterator iter = index.find( key );
+
+  if( iter != index.end() )
+  {
+    iter.value().remove( value );
+
+    /* Don't keep empty sets around for keys that no longer map to anything. */
+    if( iter.value().isEmpty() )
+    {
+      index.erase( iter );
+    }
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCProfileCache::mergeSorted( QStringList& list, QStringList values )
+{
+  if( values.isEmpty() )
+  {
+    return;
+  }
+
+  std::sort( values.begin(), values.end() );
+  values.erase( std::unique( values.begin(), values.end() ), values.end() );
+
+  /* Both lists are sorted and free of duplicates, so a single pass does it. */
+  QStringList merged;
+  merged.reserve( list.size() + values.size() );
+  std::set_union( list.constBegin(), list.constEnd(), values.constBegin(), values.constEnd(), std::back_inserter( merged ) );
+  list.swap( merged );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCProfileCache::saveSnapshot( const QString& fileName, qint64 sourceSize, qint64 sourceModified ) const
+{
+  QHash< QString, quint32 > indices;
+  QVector< QString > strings;
+  QVector< quint32 > roots;
+  QVector< quint32 > elements;
+  QVector< quint32 > children;
+  QVector< quint32 > attributes;
+  QVector< quint32 > valueKeys;
+  QVector< quint32 > values;
+  QVector< quint32 > frequencies;
+  QVector< quint32 > lastUsed;
+
+  foreach( QString root, m_rootElements )
+  {
+    roots.append( internString( root, indices, strings ) );
+  }
+
+  for( QHash< QString, QStringList >::const_iterator iter = m_children.constBegin(); iter != m_children.constEnd(); ++iter )
+  {
+    elements << internString( iter.key(), indices, strings ) << children.size() << attributes.size();
+
+    foreach( QString child, iter.value() )
+    {
+      children.append( internString( child, indices, strings ) );
+    }
+
+    foreach( QString attribute, m_attributes.value( iter.key() ) )
+    {
+      attributes.append( internString( attribute, indices, strings ) );
+    }
+  }
+
+  elements << 0 << children.size() << attributes.size();
+
+  /* Attribute values are stored separately since values may outlive their attributes (see "removeElement"). */
+  for( QHash< QString, QHash< QString, QStringList > >::const_iterator iter = m_attributeValues.constBegin(); iter != m_attributeValues.constEnd(); ++iter )
+  {
+    for( QHash< QString, QStringList >::const_iterator valueIter = iter.value().constBegin(); valueIter != iter.value().constEnd(); ++valueIter )
+    {
+      valueKeys << internString( iter.key(), indices, strings ) << internString( valueIter.key(), indices, strings ) << values.size();
+      QHash< QString, int > valueFrequencies = m_valueFrequencies.value( iter.key() ).value( valueIter.key() );
+      QHash< QString, uint > valueLastUsed = m_valueLastUsed.value( iter.key() ).value( valueIter.key() );
+
+      foreach( QString value, valueIter.value() )
+      {
+        values.append( internString( value, indices, strings ) );
+        frequencies.append( valueFrequencies.value( value ) );
+        lastUsed.append( valueLastUsed.value( value ) );
+      }
+    }
+  }
+
+  valueKeys << 0 << 0 << values.size();
+
+  QVector< quint32 > policies;
+
+  for( QHash< QString, QHash< QString, GCAttributePolicy > >::const_iterator iter = m_attributePolicies.constBegin(); iter != m_attributePolicies.constEnd(); ++iter )
+  {
+    for( QHash< QString, GCAttributePolicy >::const_iterator policy = iter.value().constBegin(); policy != iter.value().constEnd(); ++policy )
+    {
+      policies << internString( iter.key(), indices, strings )
+               << internString( policy.key(), indices, strings )
+               << policy.value().flags()
+               << ( policy.value().minimum().isNull() ? 0 : 1 );
+      appendDouble( policies, policy.value().minimum().toDouble() );
+      appendDouble( policies, policy.value().maximum().toDouble() );
+    }
+  }
+
+  QVector< quint32 > contexts;
+  QVector< quint32 > contextChildren;
+
+  for( QHash< QString, QStringList >::const_iterator iter = m_contextChildren.constBegin(); iter != m_contextChildren.constEnd(); ++iter )
+  {
+    contexts << internString( iter.key(), indices, strings ) << contextChildren.size() << 0;
+
+    foreach( QString child, iter.value() )
+    {
+      contextChildren.append( internString( child, indices, strings ) );
+    }
+  }
+
+  contexts << 0 << contextChildren.size() << 0;
+
+  QVector< quint32 > contextValueKeys;
+  QVector< quint32 > contextValues;
+
+  for( QHash< QString, QHash< QString, QStringList > >::const_iterator iter = m_contextValues.constBegin(); iter != m_contextValues.constEnd(); ++iter )
+  {
+    for( QHash< QString, QStringList >::const_iterator valueIter = iter.value().constBegin(); valueIter != iter.value().constEnd(); ++valueIter )
+    {
+      contextValueKeys << internString( iter.key(), indices, strings ) << internString( valueIter.key(), indices, strings ) << contextValues.size();
+
+      foreach( QString value, valueIter.value() )
+      {
+        contextValues.append( internString( value, indices, strings ) );
+      }
+    }
+  }
+
+  contextValueKeys << 0 << 0 << contextValues.size();
+
+  QVector< quint32 > stringOffsets;
+  stringOffsets.reserve( strings.size() + 1 );
+  QString characters;
+
+  foreach( QString str, strings )
+  {
+    stringOffsets.append( characters.size() );
+    characters.append( str );
+  }
+
+  stringOffsets.append( characters.size() );
+
+  QByteArray payload;
+  appendWords( payload, stringOffsets );
+  appendWords( payload, roots );
+  appendWords( payload, elements );
+  appendWords( payload, children );
+  appendWords( payload, attributes );
+  appendWords( payload, valueKeys );
+  appendWords( payload, values );
+  appendWords( payload, frequencies );
+  appendWords( payload, lastUsed );
+  appendWords( payload, policies );
+  appendWords( payload, contexts );
+  appendWords( payload, contextChildren );
+  appendWords( payload, contextValueKeys );
+  appendWords( payload, contextValues );
+  payload.append( reinterpret_cast< const char* >( characters.constData() ), characters.size() * sizeof( QChar ) );
+
+  QVector< quint32 > header;
+  header << SNAPSHOT_MAGIC
+         << SNAPSHOT_VERSION
+         << payload.size()
+         << snapshotChecksum( reinterpret_cast< const uchar* >( payload.constData() ), payload.size() )
+         << strings.size()
+         << characters.size()
+         << roots.size()
+         << elements.size() / SNAPSHOT_RECORD_SIZE - 1
+         << children.size()
+         << attributes.size()
+         << valueKeys.size() / SNAPSHOT_RECORD_SIZE - 1
+         << values.size()
+         << policies.size() / SNAPSHOT_POLICY_SIZE
+         << contexts.size() / SNAPSHOT_RECORD_SIZE - 1
+         << contextChildren.size()
+         << contextValueKeys.size() / SNAPSHOT_RECORD_SIZE - 1
+         << contextValues.size()
+         << quint32( quint64( sourceSize ) )
+         << quint32( quint64( sourceSize ) >> 32 )
+         << quint32( quint64( sourceModified ) )
+         << quint32( quint64( sourceModified ) >> 32 );
+
+  QByteArray headerBytes;
+  appendWords( headerBytes, header );
+
+  /* Readers never see a partially written snapshot. */
+  QSaveFile file( fileName );
+
+  if( !file.open( QIODevice::WriteOnly ) ||
+      file.write( headerBytes ) != headerBytes.size() ||
+      file.write( payload ) != payload.size() )
+  {
+    file.cancelWriting();
+    return false;
+  }
+
+  return file.commit();
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCProfileCache::loadSnapshot( const QString& fileName, qint64 sourceSize, qint64 sourceModified )
+{
+  clear();
+
+  QFile file( fileName );
+
+  if( !file.open( QIODevice::ReadOnly ) )
+  {
+    return false;
+  }
+
+  uchar* data = file.map( 0, file.size() );
+
+  if( !data )
+  {
+    return false;
+  }
+
+  bool success = readSnapshot( data, file.size(), sourceSize, sourceModified );
+  file.unmap( data );
+
+  if( !success )
+  {
+    clear();
+  }
+
+  return success;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCProfileCache::readSnapshot( const uchar* data, qint64 size, qint64 sourceSize, qint64 sourceModified )
+{
+  if( size < qint64( SNAPSHOT_HEADER_SIZE * sizeof( quint32 ) ) )
+  {
+    return false;
+  }
+
+  const quint32* header = reinterpret_cast< const quint32* >( data );
+
+  if( header[ 0 ] != SNAPSHOT_MAGIC ||
+      header[ 1 ] != SNAPSHOT_VERSION ||
+      qint64( header[ 2 ] ) != size - qint64( SNAPSHOT_HEADER_SIZE * sizeof( quint32 ) ) )
+  {
+    return false;
+  }
+
+  /* A perfectly valid snapshot is still useless if the database changed after it was taken. */
+  if( ( quint64( header[ 17 ] ) | ( quint64( header[ 18 ] ) << 32 ) ) != quint64( sourceSize ) ||
+      ( quint64( header[ 19 ] ) | ( quint64( header[ 20 ] ) << 32 ) ) != quint64( sourceModified ) )
+  {
+    return false;
+  }
+
+  quint32 stringCount = header[ 4 ];
+  quint32 characterCount = header[ 5 ];
+  quint32 rootCount = header[ 6 ];
+  quint32 elementCount = header[ 7 ];
+  quint32 childCount = header[ 8 ];
+  quint32 attributeCount = header[ 9 ];
+  quint32 valueKeyCount = header[ 10 ];
+  quint32 valueCount = header[ 11 ];
+  quint32 policyCount = header[ 12 ];
+  quint32 contextCount = header[ 13 ];
+  quint32 contextChildCount = header[ 14 ];
+  quint32 contextValueKeyCount = header[ 15 ];
+  quint32 contextValueCount = header[ 16 ];
+
+  /* 64-bit arithmetic so that garbage counts can't overflow into a plausible size. */
+  qint64 wordCount = qint64( stringCount ) + 1 +
+                     rootCount +
+                     ( qint64( elementCount ) + 1 ) * SNAPSHOT_RECORD_SIZE +
+                     childCount +
+                     attributeCount +
+                     ( qint64( valueKeyCount ) + 1 ) * SNAPSHOT_RECORD_SIZE +
+                     qint64( valueCount ) * 3 +
+                     qint64( policyCount ) * SNAPSHOT_POLICY_SIZE +
+                     ( qint64( contextCount ) + 1 ) * SNAPSHOT_RECORD_SIZE +
+                     contextChildCount +
+                     ( qint64( contextValueKeyCount ) + 1 ) * SNAPSHOT_RECORD_SIZE +
+                     contextValueCount;
+
+  if( wordCount * qint64( sizeof( quint32 ) ) + qint64( characterCount ) * qint64( sizeof( QChar ) ) != qint64( header[ 2 ] ) ||
+      snapshotChecksum( data + SNAPSHOT_HEADER_SIZE * sizeof( quint32 ), header[ 2 ] ) != header[ 3 ] )
+  {
+    return false;
+  }
+
+  const quint32* stringOffsets = header + SNAPSHOT_HEADER_SIZE;
+  const quint32* roots = stringOffsets + stringCount + 1;
+  const quint32* elements = roots + rootCount;
+  const quint32* children = elements + ( elementCount + 1 ) * SNAPSHOT_RECORD_SIZE;
+  const quint32* attributes = children + childCount;
+  const quint32* valueKeys = attributes + attributeCount;
+  const quint32* values = valueKeys + ( valueKeyCount + 1 ) * SNAPSHOT_RECORD_SIZE;
+  const quint32* frequencies = values + valueCount;
+  const quint32* lastUsed = frequencies + valueCount;
+  const quint32* policies = lastUsed + valueCount;
+  const quint32* contexts = policies + policyCount * SNAPSHOT_POLICY_SIZE;
+  const quint32* contextChildren = contexts + ( contextCount + 1 ) * SNAPSHOT_RECORD_SIZE;
+  const quint32* contextValueKeys = contextChildren + contextChildCount;
+  const quint32* contextValues = contextValueKeys + ( contextValueKeyCount + 1 ) * SNAPSHOT_RECORD_SIZE;
+  const QChar* characters = reinterpret_cast< const QChar* >( contextValues + contextValueCount );
+
+  /* The checksum only protects against accidental damage, so the structure is verified as well
+    (a bad index would otherwise take the application down). */
+  if( stringOffsets[ 0 ] != 0 || stringOffsets[ stringCount ] != characterCount ||
+      !validIndices( roots, rootCount, stringCount ) ||
+      !validIndices( children, childCount, stringCount ) ||
+      !validIndices( attributes, attributeCount, stringCount ) ||
+      !validIndices( values, valueCount, stringCount ) ||
+      !validIndices( contextChildren, contextChildCount, stringCount ) ||
+      !validIndices( contextValues, contextValueCount, stringCount ) ||
+      !validRanges( elements, elementCount, 1, childCount ) ||
+      !validRanges( elements, elementCount, 2, attributeCount ) ||
+      !validRanges( valueKeys, valueKeyCount, 2, valueCount ) ||
+      !validRanges( contexts, contextCount, 1, contextChildCount ) ||
+      !validRanges( contextValueKeys, contextValueKeyCount, 2, contextValueCount ) )
+  {
+    return false;
+  }
+
+  /* Every string is created exactly once, all the lists share the interned copies. */
+  QVector< QString > strings( stringCount );
+
+  for( quint32 i = 0; i < stringCount; ++i )
+  {
+    if( stringOffsets[ i ] > stringOffsets[ i + 1 ] )
+    {
+      return false;
+    }
+
+    strings[ i ] = QString( characters + stringOffsets[ i ], stringOffsets[ i + 1 ] - stringOffsets[ i ] );
+  }
+
+  for( quint32 i = 0; i < rootCount; ++i )
+  {
+    m_rootElements.append( strings.at( roots[ i ] ) );
+  }
+
+  m_children.reserve( elementCount );
+  m_attributes.reserve( elementCount );
+
+  for( quint32 i = 0; i < elementCount; ++i )
+  {
+    const quint32* record = elements + i * SNAPSHOT_RECORD_SIZE;
+    const quint32* next = record + SNAPSHOT_RECORD_SIZE;
+
+    if( record[ 0 ] >= stringCount )
+    {
+      return false;
+    }
+
+    const QString& element = strings.at( record[ 0 ] );
+
+    QStringList childList;
+    childList.reserve( next[ 1 ] - record[ 1 ] );
+
+    for( quint32 j = record[ 1 ]; j < next[ 1 ]; ++j )
+    {
+      childList.append( strings.at( children[ j ] ) );
+      m_parents[ childList.last() ].insert( element );
+    }
+
+    QStringList attributeList;
+    attributeList.reserve( next[ 2 ] - record[ 2 ] );
+
+    for( quint32 j = record[ 2 ]; j < next[ 2 ]; ++j )
+    {
+      attributeList.append( strings.at( attributes[ j ] ) );
+    }
+
+    m_children.insert( element, childList );
+    m_attributes.insert( element, attributeList );
+  }
+
+  for( quint32 i = 0; i < valueKeyCount; ++i )
+  {
+    const quint32* record = valueKeys + i * SNAPSHOT_RECORD_SIZE;
+    const quint32* next = record + SNAPSHOT_RECORD_SIZE;
+
+    if( record[ 0 ] >= stringCount || record[ 1 ] >= stringCount )
+    {
+      return false;
+    }
+
+    QStringList valueList;
+    valueList.reserve( next[ 2 ] - record[ 2 ] );
+    QHash< QString, int > valueFrequencies;
+    valueFrequencies.reserve( next[ 2 ] - record[ 2 ] );
+    QHash< QString, uint > valueLastUsed;
+
+    for( quint32 j = record[ 2 ]; j < next[ 2 ]; ++j )
+    {
+      valueList.append( strings.at( values[ j ] ) );
+
+      if( frequencies[ j ] > 0 )
+      {
+        valueFrequencies.insert( valueList.last(), frequencies[ j ] );
+      }
+
+      if( lastUsed[ j ] > 0 )
+      {
+        valueLastUsed.insert( valueList.last(), lastUsed[ j ] );
+      }
+    }
+
+    m_attributeValues[ strings.at( record[ 0 ] ) ].insert( strings.at( record[ 1 ] ), valueList );
+
+    if( !valueFrequencies.isEmpty() )
+    {
+      m_valueFrequencies[ strings.at( record[ 0 ] ) ].insert( strings.at( record[ 1 ] ), valueFrequencies );
+    }
+
+    if( !valueLastUsed.isEmpty() )
+    {
+      m_valueLastUsed[ strings.at( record[ 0 ] ) ].insert( strings.at( record[ 1 ] ), valueLastUsed );
+    }
+  }
+
+  for( quint32 i = 0; i < policyCount; ++i )
+  {
+    const quint32* record = policies + i * SNAPSHOT_POLICY_SIZE;
+
+    if( record[ 0 ] >= stringCount || record[ 1 ] >= stringCount )
+    {
+      return false;
+    }
+
+    QVariant minimum = record[ 3 ] ? QVariant( readDouble( record + 4 ) ) : QVariant( QVariant::Double );
+    QVariant maximum = record[ 3 ] ? QVariant( readDouble( record + 6 ) ) : QVariant( QVariant::Double );
+
+    m_attributePolicies[ strings.at( record[ 0 ] ) ].insert( strings.at( record[ 1 ] ),
+                                                             GCAttributePolicy( record[ 2 ], minimum, maximum ) );
+  }
+
+  m_contextChildren.reserve( contextCount );
+
+  for( quint32 i = 0; i < contextCount; ++i )
+  {
+    const quint32* record = contexts + i * SNAPSHOT_RECORD_SIZE;
+    const quint32* next = record + SNAPSHOT_RECORD_SIZE;
+
+    if( record[ 0 ] >= stringCount )
+    {
+      return false;
+    }
+
+    QStringList childList;
+    childList.reserve( next[ 1 ] - record[ 1 ] );
+
+    for( quint32 j = record[ 1 ]; j < next[ 1 ]; ++j )
+    {
+      childList.append( strings.at( contextChildren[ j ] ) );
+    }
+
+    const QString& context = strings.at( record[ 0 ] );
+    addContext( context );
+
+    foreach( QString child, childList )
+    {
+      m_childContexts[ child ].insert( context );
+    }
+
+    m_contextChildren.insert( context, childList );
+  }
+
+  for( quint32 i = 0; i < contextValueKeyCount; ++i )
+  {
+    const quint32* record = contextValueKeys + i * SNAPSHOT_RECORD_SIZE;
+    const quint32* next = record + SNAPSHOT_RECORD_SIZE;
+
+    if( record[ 0 ] >= stringCount || record[ 1 ] >= stringCount )
+    {
+      return false;
+    }
+
+    QStringList valueList;
+    valueList.reserve( next[ 2 ] - record[ 2 ] );
+
+    for( quint32 j = record[ 2 ]; j < next[ 2 ]; ++j )
+    {
+      valueList.append( strings.at( contextValues[ j ] ) );
+    }
+
+    addContext( strings.at( record[ 0 ] ) );
+    m_contextValues[ strings.at( record[ 0 ] ) ].insert( strings.at( record[ 1 ] ), valueList );
+  }
+
+  return true;
+}
+
+/*--------------------------------------------------------------------------------------*/
\ No newline at end of file
@@ -0,0 +1,327 @@
+/* Copyright (c) 2012 - 2013 by William Hallatt.
+ *
+ * This file forms part of "XML Mill".
+ *
+ * The official website for this project is <http://www.goblincoding.com> and,
+ * although not compulsory, it would be appreciated if all works of whatever
+ * nature using this source code (in whole or in part) include a reference to
+ * this site.
+ *
+ * Should you wish to contact me for whatever reason, please do so via:
+ *
+ *                 <http://www.goblincoding.com/contact>
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program (GNUGPL.txt).  If not, see
+ *
+ *                    <http://www.gnu.org/licenses/>
+ */
+
+#ifndef GCPROFILECACHE_H
+#define GCPROFILECACHE_H
+
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QMetaType>
+
+#include "gcattributepolicy.h"
+#include "gcvalueindex.h"
+
+/// In-memory copy of the active database profile.
+
+/**
+  GCDataBaseInterface loads the entire active profile into an instance of this class when a
+  database is set as active and keeps it coherent with every successful write (i.e. it is a
+  write-through cache).  All the read functions of the interface are answered from here so that
+  the UI never has to hit the database when, for instance, the user clicks through a document.
+
+  Since all the data lives in implicitly shared Qt containers, copying the cache is cheap, which
+  is how a snapshot of the profile is handed to the database worker thread.
+
+  The cache can also be saved to (and loaded from) a compact binary snapshot file.  The snapshot
+  stores every string only once and all the lists as offset-indexed ranges of string indices, so that
+  loading a profile amounts to mapping the file and creating each (interned) string exactly once,
+  which is considerably faster than running the queries that fill the cache from the database.
+
+  Path-aware profiles additionally keep children and attribute values per context, i.e. per
+  element name preceded by (at most a fixed number of) the names of its closest ancestors, joined
+  by slashes (e.g. "order/line/item").  Contexts are plain hash keys, so looking one up costs the
+  same as looking up an element, regardless of the size of the profile.
+
+  Finally, the cache maintains an inverted index over all the attribute values (see GCValueIndex)
+  for "findAttributeValues".  The index is built when the profile is loaded (see "buildValueIndex")
+  so that the first search doesn't have to wait for it, and is kept up to date from then on.
+
+  All lists are returned in the same order as the corresponding GCDataBaseInterface functions
+  document (i.e. children, values and element names are sorted, attributes are returned in the
+  order in which they were added).
+
+  This class knows nothing about the database and has been specifically designed to be used in
+  conjunction with GCDataBaseInterface.
+*/
+class GCProfileCache
+{
+public:
+  /*! Constructor. */
+  GCProfileCache();
+
+  /*! Removes everything from the cache. */
+  void clear();
+
+  /*! Returns "true" if "element" is known to the profile. */
+  bool containsElement( const QString& element ) const;
+
+  /*! Returns a sorted list of all known element names. */
+  QStringList elements() const;
+
+  /*! Returns the set of all known element names (use this rather than "elements" for lookups). */
+  QSet< QString > elementSet() const;
+
+  /*! Returns a sorted list of all the first level children associated with "element". */
+  QStringList children( const QString& element ) const;
+
+  /*! Returns "true" if "child" is a known first level child of "element". */
+  bool containsChild( const QString& element, const QString& child ) const;
+
+  /*! Returns the set of all the elements that have "child" as a first level child. */
+  QSet< QString > parents( const QString& child ) const;
+
+  /*! Returns "true" if "attribute" is known to be associated with "element". */
+  bool containsAttribute( const QString& element, const QString& attribute ) const;
+
+  /*! Returns a list of all the attributes associated with "element" (in the order in which they were added). */
+  QStringList attributes( const QString& element ) const;
+
+  /*! Returns a sorted list of all the values associated with "element" and its corresponding "attribute". */
+  QStringList attributeValues( const QString& element, const QString& attribute ) const;
+
+  /*! Returns (at most) "limit" values associated with "element" and its corresponding "attribute", most
+      frequently used first (values used equally often are sorted).  If "limit" is zero, all the values are
+      returned in order of frequency. */
+  QStringList rankedAttributeValues( const QString& element, const QString& attribute, int limit = 0 ) const;
+
+  /*! Returns the number of times "value" has been recorded for "element" and its corresponding "attribute". */
+  int attributeValueFrequency( const QString& element, const QString& attribute, const QString& value ) const;
+
+  /*! Returns the value policy of "element" and its corresponding "attribute" (see GCAttributePolicy). */
+  GCAttributePolicy attributePolicy( const QString& element, const QString& attribute ) const;
+
+  /*! Returns (at most) "limit" element, attribute and value combinations whose values match "text"
+      according to "mode" (all of them if "limit" is zero).
+      \sa GCValueIndex::find */
+  QList< GCValueMatch > findAttributeValues( const QString& text, GCValueIndex::MatchMode mode, int limit = 0 ) const;
+
+  /*! Indexes all the known attribute values for "findAttributeValues" (does nothing if the index is
+      already up to date). */
+  void buildValueIndex() const;
+
+  /*! Returns "true" if "context" is known to the profile (see "childContext"). */
+  bool containsContext( const QString& context ) const;
+
+  /*! Returns a sorted list of all the first level children associated with "context". */
+  QStringList contextChildren( const QString& context ) const;
+
+  /*! Returns a sorted list of all the values associated with "attribute" in "context". */
+  QStringList contextAttributeValues( const QString& context, const QString& attribute ) const;
+
+  /*! As "rankedAttributeValues", but only for the values associated with "attribute" in "context"
+      (the values are ranked by the frequencies recorded for the context's element). */
+  QStringList rankedContextAttributeValues( const QString& context, const QString& attribute, int limit = 0 ) const;
+
+  /*! Returns the context of the last element in "path" (outermost element first), i.e. the names of
+      the last "depth" elements in "path" joined by slashes. */
+  static QString contextPath( const QStringList& path, int depth );
+
+  /*! Returns the context of an element named "child" that is a first level child of an element in
+      "parentContext" (which is empty for root elements), see "contextPath". */
+  static QString childContext( const QString& parentContext, const QString& child, int depth );
+
+  /*! Returns a list of all known root elements. */
+  const QStringList& rootElements() const;
+
+  /*! Adds "element" to the profile (does nothing if the element is already known). */
+  void addElement( const QString& element );
+
+  /*! Removes "element" along with its first level children and attributes (known attribute
+      values are left alone, see "removeAttribute"). */
+  void removeElement( const QString& element );
+
+  /*! Adds "root" to the list of known root elements (does nothing if it is already known). */
+  void addRootElement( const QString& root );
+
+  /*! Removes "root" from the list of known root elements. */
+  void removeRootElement( const QString& root );
+
+  /*! Merges "children" with the first level children associated with "element". */
+  void addChildren( const QString& element, const QStringList& children );
+
+  /*! Merges the children lists in "children" with those of the elements they are stored against.
+      Adding all the children known at once is much faster than adding them one at a time.
+      \sa mergeSorted */
+  void addChildren( const QHash< QString/*element*/, QStringList/*children*/ >& children );
+
+  /*! Removes all the first level children associated with "element". */
+  void removeChildren( const QString& element );
+
+  /*! Removes "child" from the first level children associated with "element". */
+  void removeChild( const QString& element, const QString& child );
+
+  /*! Appends "attributes" that aren't known yet to the attributes associated with "element". */
+  void addAttributes( const QString& element, const QStringList& attributes );
+
+  /*! Removes all the attributes associated with "element" (but not their values). */
+  void removeAttributes( const QString& element );
+
+  /*! Removes "attribute" and all its values from "element". */
+  void removeAttribute( const QString& element, const QString& attribute );
+
+  /*! Merges "values" with the values associated with "element" and its corresponding "attribute". */
+  void addAttributeValues( const QString& element, const QString& attribute, const QStringList& values );
+
+  /*! Merges the value lists in "values" with those of the elements and attributes they are stored
+      against.  Adding all the values known at once is much faster than adding them one at a time.
+      \sa mergeSorted */
+  void addAttributeValues( const QHash< QString/*element*/, QHash< QString/*attribute*/, QStringList/*values*/ > >& values );
+
+  /*! Removes all the values associated with "element" and its corresponding "attribute". */
+  void removeAttributeValues( const QString& element, const QString& attribute );
+
+  /*! Removes all the values (and policies) associated with "element", including those of attributes
+      that are no longer listed against it.
+      \sa removeAttributeValues */
+  void removeElementValues( const QString& element );
+
+  /*! Removes "value" (and its frequency) from the values associated with "element" and its corresponding "attribute". */
+  void removeAttributeValue( const QString& element, const QString& attribute, const QString& value );
+
+  /*! Adds "count" to the number of times "value" has been recorded for "element" and its corresponding
+      "attribute" (the value itself must be added with "addAttributeValues"). */
+  void addAttributeValueFrequency( const QString& element, const QString& attribute, const QString& value, int count );
+
+  /*! Records "time" (in seconds since the epoch) as the last time the user assigned "value" to "element"'s
+      "attribute" (see GCAttributePolicy::PROTECTION_PERIOD). */
+  void setAttributeValueLastUsed( const QString& element, const QString& attribute, const QString& value, uint time );
+
+  /*! Adds "context" to the profile (does nothing if the context is already known). */
+  void addContext( const QString& context );
+
+  /*! Merges "children" with the first level children associated with "context" (adding the context
+      if it isn't known yet). */
+  void addContextChildren( const QString& context, const QStringList& children );
+
+  /*! Merges the children lists in "children" with those of the contexts they are stored against
+      (see "addChildren"). */
+  void addContextChildren( const QHash< QString/*context*/, QStringList/*children*/ >& children );
+
+  /*! Merges "values" with the values associated with "attribute" in "context" (adding the context
+      if it isn't known yet). */
+  void addContextAttributeValues( const QString& context, const QString& attribute, const QStringList& values );
+
+  /*! Merges the value lists in "values" with those of the contexts and attributes they are stored
+      against (see "addAttributeValues"). */
+  void addContextAttributeValues( const QHash< QString/*context*/, QHash< QString/*attribute*/, QStringList/*values*/ > >& values );
+
+  /*! Removes every context that contains "element" anywhere in its path and removes "element" from the
+      children of every other context. */
+  void removeContexts( const QString& element );
+
+  /*! Removes "child" from the first level children of all the contexts of "element". */
+  void removeContextChild( const QString& element, const QString& child );
+
+  /*! Removes all the values associated with "attribute" from all the contexts of "element". */
+  void removeContextAttribute( const QString& element, const QString& attribute );
+
+  /*! Removes "value" from the values associated with "attribute" in all the contexts of "element". */
+  void removeContextAttributeValue( const QString& element, const QString& attribute, const QString& value );
+
+  /*! Merges "policy" with the value policy of "element" and its corresponding "attribute" and then (unless
+      "evict" is false) evicts the least frequently used values if there are more than the merged policy allows.
+      Recently assigned values are never evicted (see GCAttributePolicy::PROTECTION_PERIOD). */
+  void mergeAttributePolicy( const QString& element, const QString& attribute, const GCAttributePolicy& policy, bool evict = true );
+
+  /*! Saves the entire cache to the binary snapshot file "fileName" (the file is replaced atomically).
+      "sourceSize" and "sourceModified" (e.g. milliseconds since the epoch) describe the database file
+      the cache reflects and are recorded in the snapshot.  Returns "false" if the file could not be written.
+      \sa loadSnapshot */
+  bool saveSnapshot( const QString& fileName, qint64 sourceSize, qint64 sourceModified ) const;
+
+  /*! Replaces the contents of the cache with those of the binary snapshot file "fileName".  Returns
+      "false" (and leaves the cache empty) if the file doesn't exist, was written by a different version,
+      fails its checksum or was taken from a database file of a different size or modification time than
+      "sourceSize" and "sourceModified" (i.e. the database was replaced or changed since).
+      \sa saveSnapshot */
+  bool loadSnapshot( const QString& fileName, qint64 sourceSize, qint64 sourceModified );
+
+private:
+  /*! Validates the mapped snapshot "data" of "size" bytes against the source database file's
+      "sourceSize" and "sourceModified" and loads it into the (empty) cache. */
+  bool readSnapshot( const uchar* data, qint64 size, qint64 sourceSize, qint64 sourceModified );
+
+  /*! Removes all the values associated with "element" and its corresponding "attribute" from the
+      value index (if it has been built). */
+  void unindexAttributeValues( const QString& element, const QString& attribute );
+
+  /*! Returns (at most) "limit" of "values", most frequent first according to "frequencies" (see
+      "rankedAttributeValues"). */
+  static QStringList rankValues( const QStringList& values, const QHash< QString, int >& frequencies, int limit );
+
+  /*! Returns "true" if the last element in "context" is "element". */
+  static bool isContextOf( const QString& context, const QString& element );
+
+  /*! Removes "parent" from the reverse index entry for "child". */
+  void removeParent( const QString& child, const QString& parent );
+
+  /*! Removes "context" from the children, values and index hashes. */
+  void removeContext( const QString& context );
+
+  /*! Removes "value" from the set stored against "key" in "index" (and drops the set once it is empty). */
+  static void removeFromIndex( QHash< QString, QSet< QString > >& index, const QString& key, const QString& value );
+
+  /*! Merges "values" into the sorted "list" (values that "list" already contains are skipped).
+      This is linear in the length of "list", so callers should add all the values they have
+      for a list in one go rather than one at a time. */
+  static void mergeSorted( QStringList& list, QStringList values );
+
+  QStringList m_rootElements;
+
+  /* Every known element has an entry in the children and attributes hashes (even if the
+    lists are empty), which is how we keep track of the elements themselves. */
+  QHash< QString/*element*/, QStringList/*children*/ > m_children;
+
+  /* Reverse index of "m_children", kept in step with it so that we never have to scan every
+    child list to find the parents of an element. */
+  QHash< QString/*child*/, QSet< QString >/*parents*/ > m_parents;
+  QHash< QString/*element*/, QStringList/*attributes*/ > m_attributes;
+  QHash< QString/*element*/, QHash< QString/*attribute*/, QStringList/*values*/ > > m_attributeValues;
+  QHash< QString/*element*/, QHash< QString/*attribute*/, QHash< QString/*value*/, int/*frequency*/ > > > m_valueFrequencies;
+  QHash< QString/*element*/, QHash< QString/*attribute*/, QHash< QString/*value*/, uint/*last used*/ > > > m_valueLastUsed;
+  QHash< QString/*element*/, QHash< QString/*attribute*/, GCAttributePolicy > > m_attributePolicies;
+
+  /* Every known context has an entry in the context children hash (even if the list is empty). */
+  QHash< QString/*context*/, QStringList/*children*/ > m_contextChildren;
+  QHash< QString/*context*/, QHash< QString/*attribute*/, QStringList/*values*/ > > m_contextValues;
+
+  /* Reverse indices of the context hashes: the contexts containing an element anywhere in their
+    paths and the contexts listing an element as a child. These let us remove an element's
+    contexts without walking every known context. */
+  QHash< QString/*element*/, QSet< QString >/*contexts*/ > m_elementContexts;
+  QHash< QString/*child*/, QSet< QString >/*contexts*/ > m_childContexts;
+
+  /* Built by "buildValueIndex" (or by "findAttributeValues" if the cache was reloaded since). */
+  mutable GCValueIndex m_valueIndex;
+  mutable bool m_valueIndexBuilt;
+};
+
+Q_DECLARE_METATYPE( GCProfileCache )
+
+#endif // GCPROFILECACHE_H
\ No newline at end of file
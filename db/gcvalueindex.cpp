@@ -0,0 +1,297 @@
+/* Copyright (c) 2012 - 2013 by William Hallatt.
+ *
+ * This file forms part of "XML Mill".
+ *
+ * The official website for this project is <http://www.goblincoding.com> and,
+ * although not compulsory, it would be appreciated if all works of whatever
+ * nature using this source code (in whole or in part) include a reference to
+ * this site.
+ *
+ * Should you wish to contact me for whatever reason, please do so via:
+ *
+ *                 <http://www.goblincoding.com/contact>
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program (GNUGPL.txt).  If not, see
+ *
+ *                    <http://www.gnu.org/licenses/>
+ */
+
+#include "gcvalueindex.h"
+
+#include <algorithm>
+
+/*--------------------------------------------------------------------------------------*/
+
+/* The index is only compacted once it has accumulated this many removed terms (and they outnumber
+  the live ones), otherwise removing the odd value would trigger a rebuild. */
+static const int COMPACT_THRESHOLD( 1024 );
+
+/*--------------------------------------------------------------------------------------*/
+
+GCValueIndex::GCValueIndex()
+: m_termIds     (),
+  m_terms       (),
+  m_matches     (),
+  m_trigrams    (),
+  m_indexed     (),
+  m_removedTerms( 0 )
+{
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCValueIndex::clear()
+{
+  m_termIds.clear();
+  m_terms.clear();
+  m_matches.clear();
+  m_trigrams.clear();
+  m_indexed.clear();
+  m_removedTerms = 0;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCValueIndex::addValue( const QString& element, const QString& attribute, const QString& value )
+{
+  ValueKey key( qMakePair( element, attribute ), value );
+
+  if( m_indexed.contains( key ) )
+  {
+    return;
+  }
+
+  m_indexed.insert( key );
+
+  QString term = value.toCaseFolded();
+  int termId = m_termIds.value( term, -1 );
+
+  if( termId < 0 )
+  {
+    termId = m_terms.size();
+    m_termIds.insert( term, termId );
+    m_terms.append( term );
+    m_matches.append( QList< GCValueMatch >() );
+
+    foreach( quint64 trigram, trigrams( term ) )
+    {
+      m_trigrams[ trigram ].append( termId );
+    }
+  }
+
+  GCValueMatch match;
+  match.element = element;
+  match.attribute = attribute;
+  match.value = value;
+  m_matches[ termId ].append( match );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCValueIndex::removeValue( const QString& element, const QString& attribute, const QString& value )
+{
+  if( !m_indexed.remove( ValueKey( qMakePair( element, attribute ), value ) ) )
+  {
+    return;
+  }
+
+  QString term = value.toCaseFolded();
+  int termId = m_termIds.value( term, -1 );
+
+  QList< GCValueMatch >& matches = m_matches[ termId ];
+
+  for( int i = 0; i < matches.size(); ++i )
+  {
+    const GCValueMatch& match = matches.at( i );
+
+    if( match.element == element && match.attribute == attribute && match.value == value )
+    {
+      matches.removeAt( i );
+      break;
+    }
+  }
+
+  if( matches.isEmpty() )
+  {
+    m_termIds.remove( term );
+    m_terms[ termId ].clear();
+    ++m_removedTerms;
+
+    foreach( quint64 trigram, trigrams( term ) )
+    {
+      QVector< int >& termIds = m_trigrams[ trigram ];
+      QVector< int >::iterator iter = std::lower_bound( termIds.begin(), termIds.end(), termId );
+
+      if( iter != termIds.end() && *iter == termId )
+      {
+        termIds.erase( iter );
+      }
+
+      if( termIds.isEmpty() )
+      {
+        m_trigrams.remove( trigram );
+      }
+    }
+
+    if( m_removedTerms > COMPACT_THRESHOLD && m_removedTerms > m_termIds.size() )
+    {
+      compact();
+    }
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QList< GCValueMatch > GCValueIndex::find( const QString& text, MatchMode mode, int limit ) const
+{
+  QList< GCValueMatch > matches;
+  QString query = text.toCaseFolded();
+
+  if( query.isEmpty() )
+  {
+    return matches;
+  }
+
+  if( mode == PrefixMatch )
+  {
+    for( QMap< QString, int >::const_iterator iter = m_termIds.lowerBound( query );
+         iter != m_termIds.constEnd() && iter.key().startsWith( query );
+         ++iter )
+    {
+      if( !appendMatches( iter.value(), matches, limit ) )
+      {
+        break;
+      }
+    }
+
+    return matches;
+  }
+
+  QVector< quint64 > queryTrigrams = trigrams( query );
+
+  /* Queries shorter than a trigram would match nearly everything anyway, and finding out which
+    values contain them means scanning every distinct value. */
+  if( queryTrigrams.isEmpty() )
+  {
+    return find( text, PrefixMatch, limit );
+  }
+
+  /* Start with the shortest list and only check the remaining lists for its entries. */
+  QList< const QVector< int >* > termIdLists;
+
+  foreach( quint64 trigram, queryTrigrams )
+  {
+    QHash< quint64, QVector< int > >::const_iterator iter = m_trigrams.constFind( trigram );
+
+    if( iter == m_trigrams.constEnd() )
+    {
+      return matches;
+    }
+
+    termIdLists.append( &iter.value() );
+  }
+
+  const QVector< int >* shortest = termIdLists.first();
+
+  foreach( const QVector< int >* termIds, termIdLists )
+  {
+    if( termIds->size() < shortest->size() )
+    {
+      shortest = termIds;
+    }
+  }
+
+  foreach( int termId, *shortest )
+  {
+    bool candidate = true;
+
+    foreach( const QVector< int >* termIds, termIdLists )
+    {
+      if( termIds != shortest && !std::binary_search( termIds->constBegin(), termIds->constEnd(), termId ) )
+      {
+        candidate = false;
+        break;
+      }
+    }
+
+    /* Sharing all the trigrams doesn't necessarily mean they appear in the same order. */
+    if( candidate &&
+        m_terms.at( termId ).contains( query ) &&
+        !appendMatches( termId, matches, limit ) )
+    {
+      break;
+    }
+  }
+
+  return matches;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QVector< quint64 > GCValueIndex::trigrams( const QString& term )
+{
+  QVector< quint64 > result;
+  result.reserve( qMax( 0, term.size() - 2 ) );
+
+  for( int i = 0; i + 2 < term.size(); ++i )
+  {
+    result.append( ( quint64( term.at( i ).unicode() ) << 32 ) |
+                   ( quint64( term.at( i + 1 ).unicode() ) << 16 ) |
+                     quint64( term.at( i + 2 ).unicode() ) );
+  }
+
+  std::sort( result.begin(), result.end() );
+  result.erase( std::unique( result.begin(), result.end() ), result.end() );
+  return result;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCValueIndex::appendMatches( int termId, QList< GCValueMatch >& matches, int limit ) const
+{
+  foreach( const GCValueMatch& match, m_matches.at( termId ) )
+  {
+    if( limit > 0 && matches.size() >= limit )
+    {
+      return false;
+    }
+
+    matches.append( match );
+  }
+
+  return ( limit <= 0 || matches.size() < limit );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCValueIndex::compact()
+{
+  QVector< QList< GCValueMatch > > liveMatches;
+
+  foreach( int termId, m_termIds )
+  {
+    liveMatches.append( m_matches.at( termId ) );
+  }
+
+  clear();
+
+  foreach( const QList< GCValueMatch >& matches, liveMatches )
+  {
+    foreach( const GCValueMatch& match, matches )
+    {
+      addValue( match.element, match.attribute, match.value );
+    }
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
\ No newline at end of file
@@ -0,0 +1,123 @@
+/* Copyright (c) 2012 - 2013 by William Hallatt.
+ *
+ * This file forms part of "XML Mill".
+ *
+ * The official website for this project is <http://www.goblincoding.com> and,
+ * although not compulsory, it would be appreciated if all works of whatever
+ * nature using this source code (in whole or in part) include a reference to
+ * this site.
+ *
+ * Should you wish to contact me for whatever reason, please do so via:
+ *
+ *                 <http://www.goblincoding.com/contact>
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program (GNUGPL.txt).  If not, see
+ *
+ *                    <http://www.gnu.org/licenses/>
+ */
+
+#ifndef GCVALUEINDEX_H
+#define GCVALUEINDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QPair>
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+/// A single attribute value found by GCValueIndex::find.
+
+struct GCValueMatch
+{
+  QString element;
+  QString attribute;
+  QString value;
+};
+
+/// Inverted index over the attribute values of a profile.
+
+/**
+  Maps every distinct attribute value to the element/attribute pairs it has been recorded
+  against so that finding out where a value has been used doesn't require a scan of the
+  entire profile.
+
+  Lookups are case insensitive.  All distinct (case folded) values are kept in an ordered map
+  which answers prefix lookups with a binary search, and each value is also listed against every
+  trigram (run of three characters) it contains so that a substring lookup only has to verify the
+  values that contain all of the query's trigrams.  Substring queries shorter than a trigram are
+  answered as prefix queries (scanning every distinct value for one or two characters would be
+  too slow for a search box over millions of values).
+
+  This class has been specifically designed to be used by GCProfileCache, which keeps it in step
+  with its own contents.
+*/
+class GCValueIndex
+{
+public:
+  /*! Determines how the query text passed to "find" is matched against the indexed values. */
+  enum MatchMode
+  {
+    PrefixMatch,    ///< values starting with the query text
+    SubstringMatch  ///< values containing the query text anywhere
+  };
+
+  /*! Constructor. */
+  GCValueIndex();
+
+  /*! Removes everything from the index. */
+  void clear();
+
+  /*! Indexes "value" as having been recorded against "element" and "attribute" (does nothing if it
+      already has been). */
+  void addValue( const QString& element, const QString& attribute, const QString& value );
+
+  /*! Removes "value" as recorded against "element" and "attribute" from the index. */
+  void removeValue( const QString& element, const QString& attribute, const QString& value );
+
+  /*! Returns (at most) "limit" element, attribute and value combinations whose values match "text"
+      according to "mode" (all of them if "limit" is zero).  Prefix matches are returned in sorted
+      order, substring matches in the order in which their values were first indexed.  Substring
+      queries shorter than three characters are treated as prefix queries. */
+  QList< GCValueMatch > find( const QString& text, MatchMode mode, int limit = 0 ) const;
+
+private:
+  /*! Returns the (sorted) trigrams contained in the case folded "term" (without duplicates). */
+  static QVector< quint64 > trigrams( const QString& term );
+
+  /*! Appends the matches recorded against "termId" to "matches" until "limit" is reached.
+      Returns "false" once it has been. */
+  bool appendMatches( int termId, QList< GCValueMatch >& matches, int limit ) const;
+
+  /*! Rebuilds the index from scratch (reclaiming the IDs of removed terms). */
+  void compact();
+
+  /*! Identifies a value as recorded against an element and attribute. */
+  typedef QPair< QPair< QString/*element*/, QString/*attribute*/ >, QString/*value*/ > ValueKey;
+
+  /* Term IDs are handed out in increasing order, which keeps every trigram list sorted
+    without any effort on our part.  The IDs of removed terms aren't reused until the index
+    is compacted. */
+  QMap< QString/*folded value*/, int/*term ID*/ > m_termIds;
+  QVector< QString/*folded value*/ > m_terms;
+  QVector< QList< GCValueMatch > > m_matches;
+  QHash< quint64/*trigram*/, QVector< int >/*term IDs*/ > m_trigrams;
+
+  /* Common values (e.g. "true" or "0") are recorded against thousands of element/attribute
+    pairs, so checking for duplicates in their match lists would be far too slow. */
+  QSet< ValueKey > m_indexed;
+  int m_removedTerms;
+};
+
+#endif // GCVALUEINDEX_H
\ No newline at end of file
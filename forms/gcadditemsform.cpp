@@ -32,8 +32,10 @@
 #include "utils/gcmessagespace.h"
 #include "utils/gcglobalspace.h"
 #include "utils/gctreewidgetitem.h"
+#include "utils/gcvaluesearch.h"
 
 #include <QMessageBox>
+#include <QListWidgetItem>
 
 /*--------------------------------------------------------------------------------------*/
 
@@ -53,6 +55,9 @@ GCAddItemsForm::GCAddItemsForm( QWidget* parent )
   connect( ui->showHelpButton, SIGNAL( clicked() ), this, SLOT( showHelp() ) );
   connect( ui->comboBox, SIGNAL( activated( const QString& ) ), this, SLOT( comboValueChanged( const QString& ) ) );
 
+  new GCValueSearch( ui->searchLineEdit, ui->substringCheckBox, ui->searchResultsListWidget, this );
+  connect( ui->searchResultsListWidget, SIGNAL( itemDoubleClicked( QListWidgetItem* ) ), this, SLOT( searchResultActivated( QListWidgetItem* ) ) );
+
   populateCombo();
   ui->treeWidget->populateFromDatabase();
 
@@ -182,6 +187,20 @@ void GCAddItemsForm::comboValueChanged( const QString& element )
 
 /*--------------------------------------------------------------------------------------*/
 
+void GCAddItemsForm::searchResultActivated( QListWidgetItem* item )
+{
+  QString element = item->data( Qt::UserRole ).toString();
+  int index = ui->comboBox->findText( element );
+
+  if( index != -1 )
+  {
+    ui->comboBox->setCurrentIndex( index );
+    comboValueChanged( element );
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
 void GCAddItemsForm::showHelp()
 {
   QMessageBox::information( this,
@@ -31,6 +31,8 @@
 
 #include <QDialog>
 
+class QListWidgetItem;
+
 namespace Ui
 {
   class GCAddItemsForm;
@@ -71,6 +73,10 @@ private slots:
   /*! Disables the line edit when an existing element is selected in the drop down. */
   void comboValueChanged( const QString& element );
 
+  /*! Triggered when a search result is double clicked.  Selects the result's element in the
+      drop down (root elements can't be added as children and aren't listed). */
+  void searchResultActivated( QListWidgetItem* item );
+
   /*! Displays help specific to this form. */
   void showHelp();
 
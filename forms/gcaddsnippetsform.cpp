@@ -122,9 +122,18 @@ void GCAddSnippetsForm::elementSelected( GCTreeWidgetItem* item, int column )
       ui->tableWidget->setItem( i, LABELCOLUMN, label );
 
       GCComboBox* attributeCombo = new GCComboBox;
-      attributeCombo->addItems( GCDataBaseInterface::instance()->attributeValues( elementName, attributeNames.at( i ) ) );
+      attributeCombo->addAttributeValues( QStringList( elementName ), attributeNames.at( i ) );
       attributeCombo->setEditable( true );
-      attributeCombo->setCurrentIndex( attributeCombo->findText( item->element().attribute( attributeNames.at( i ) ) ) );
+
+      /* The current value isn't necessarily one of the most frequently used ones. */
+      QString attributeValue = item->element().attribute( attributeNames.at( i ) );
+
+      if( !attributeValue.isEmpty() && attributeCombo->findText( attributeValue ) == -1 )
+      {
+        attributeCombo->addItem( attributeValue );
+      }
+
+      attributeCombo->setCurrentIndex( attributeCombo->findText( attributeValue ) );
 
       connect( attributeCombo, SIGNAL( currentIndexChanged( QString ) ), this, SLOT( attributeValueChanged() ) );
 
@@ -271,8 +280,8 @@ void GCAddSnippetsForm::addSnippet()
           localItem->element().setAttribute( attr.name(), attributeValue );
         }
 
-        /* This call does nothing if the attribute value already exists. */
-        GCDataBaseInterface::instance()->updateAttributeValues( elementName, attr.name(), QStringList( attributeValue ) );
+        /* Adds the value if it doesn't exist yet and counts it either way. */
+        GCDataBaseInterface::instance()->recordAttributeValue( elementName, attr.name(), attributeValue );
       }
     }
 
@@ -32,8 +32,10 @@
 #include "utils/gcmessagespace.h"
 #include "utils/gcglobalspace.h"
 #include "utils/gctreewidgetitem.h"
+#include "utils/gcvaluesearch.h"
 
 #include <QMessageBox>
+#include <QListWidgetItem>
 
 /*--------------------------------------------------------------------------------------*/
 
@@ -42,8 +44,7 @@ GCRemoveItemsForm::GCRemoveItemsForm( QWidget* parent )
   ui                    ( new Ui::GCRemoveItemsForm ),
   m_currentElement      ( "" ),
   m_currentElementParent( "" ),
-  m_currentAttribute    ( "" ),
-  m_deletedElements     ()
+  m_currentAttribute    ( "" )
 {
   ui->setupUi( this );
   ui->showAttributeHelpButton->setVisible( GCGlobalSpace::showHelpButtons() );
@@ -59,6 +60,9 @@ GCRemoveItemsForm::GCRemoveItemsForm( QWidget* parent )
   connect( ui->treeWidget, SIGNAL( gcCurrentItemSelected( GCTreeWidgetItem*, int ) ), this, SLOT( elementSelected( GCTreeWidgetItem*, int ) ) );
   connect( ui->comboBox, SIGNAL( currentIndexChanged( QString ) ), this, SLOT( attributeActivated( QString ) ) );
 
+  new GCValueSearch( ui->searchLineEdit, ui->substringCheckBox, ui->searchResultsListWidget, this );
+  connect( ui->searchResultsListWidget, SIGNAL( itemDoubleClicked( QListWidgetItem* ) ), this, SLOT( searchResultActivated( QListWidgetItem* ) ) );
+
   ui->treeWidget->populateFromDatabase();
 
   setAttribute( Qt::WA_DeleteOnClose );
@@ -123,63 +127,14 @@ void GCRemoveItemsForm::attributeActivated( const QString& attribute )
 
 /*--------------------------------------------------------------------------------------*/
 
-void GCRemoveItemsForm::deleteElement( const QString& element )
+void GCRemoveItemsForm::deleteElement()
 {
-  /* If the element name is empty, then this function was called directly by the user
-    clicking on "delete" (as opposed to this function being called further down below
-    during the recursive process of getting rid of the element's children) in that case,
-    the first element to be removed is the current one (set in "elementSelected"). */
-  QString currentElement = ( element.isEmpty() ) ? m_currentElement : element;
-
-  QStringList children = GCDataBaseInterface::instance()->children( currentElement );
-  m_deletedElements.clear();
-
-  /* Attributes and values must be removed before we can remove elements and we must also
-    ensure that children are removed before their parents.  To achieve this, we need to ensure
-    that we clean the element tree from "the bottom up". */
-  if( !children.isEmpty() )
-  {
-    foreach( QString child, children )
-    {
-      if( GCDataBaseInterface::instance()->isUniqueChildElement( currentElement, child ) )
-      {
-        deleteElement( child );
-      }
-    }
-  }
-
-  /* Remove all the attributes (and their known values) associated with this element. */
-  QStringList attributes = GCDataBaseInterface::instance()->attributes( currentElement );
-
-  foreach( QString attribute, attributes )
-  {
-    if( !GCDataBaseInterface::instance()->removeAttribute( currentElement, attribute ) )
-    {
-      GCMessageSpace::showErrorMessageBox( this, GCDataBaseInterface::instance()->lastError() );
-    }
-  }
-
-  /* Now we can remove the element itself. */
-  if( !GCDataBaseInterface::instance()->removeElement( currentElement ) )
+  /* The element, its attributes (and their known values), its root entry (if any), its references
+    in other elements' child lists and the hierarchy below it are all removed in one go. */
+  if( !GCDataBaseInterface::instance()->removeElementTree( m_currentElement ) )
   {
     GCMessageSpace::showErrorMessageBox( this, GCDataBaseInterface::instance()->lastError() );
   }
-  else
-  {
-    m_deletedElements.append( currentElement );
-  }
-
-  /* Check if the user removed a root element. */
-  if( GCDataBaseInterface::instance()->knownRootElements().contains( currentElement ) )
-  {
-    if( !GCDataBaseInterface::instance()->removeRootElement( currentElement ) )
-    {
-      GCMessageSpace::showErrorMessageBox( this, GCDataBaseInterface::instance()->lastError() );
-    }
-  }
-
-  /* Remove the element from all its parents' first level child lists. */
-  updateChildLists();
 
   ui->comboBox->clear();
   ui->plainTextEdit->clear();
@@ -211,7 +166,9 @@ void GCRemoveItemsForm::removeChildElement()
 
         if( accepted )
         {
+          /* Refreshes the form as well. */
           deleteElement();
+          return;
         }
       }
 
@@ -279,27 +236,22 @@ void GCRemoveItemsForm::deleteAttribute()
 
 /*--------------------------------------------------------------------------------------*/
 
-void GCRemoveItemsForm::updateChildLists()
+void GCRemoveItemsForm::searchResultActivated( QListWidgetItem* item )
 {
-  QStringList knownElements = GCDataBaseInterface::instance()->knownElements();
+  QString element = item->data( Qt::UserRole ).toString();
+  QString attribute = item->data( Qt::UserRole + 1 ).toString();
 
-  foreach( QString element, knownElements )
+  /* The same element may appear more than once in the hierarchy, any of its items will do. */
+  foreach( GCTreeWidgetItem* treeItem, ui->treeWidget->allTreeWidgetItems() )
   {
-   QStringList children = GCDataBaseInterface::instance()->children( element );
-
-   if( !children.isEmpty() )
-   {
-     foreach( QString deletedElement, m_deletedElements )
-     {
-       if( children.contains( deletedElement ) )
-       {
-         if( !GCDataBaseInterface::instance()->removeChildElement( element, deletedElement ) )
-         {
-           GCMessageSpace::showErrorMessageBox( this, GCDataBaseInterface::instance()->lastError() );
-         }
-       }
-     }
-   }
+    if( treeItem->name() == element )
+    {
+      ui->treeWidget->setCurrentItem( treeItem );
+      ui->treeWidget->scrollToItem( treeItem );
+      elementSelected( treeItem, 0 );
+      ui->comboBox->setCurrentIndex( ui->comboBox->findText( attribute ) );
+      return;
+    }
   }
 }
 
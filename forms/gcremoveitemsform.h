@@ -30,7 +30,8 @@
 #define GCREMOVEITEMSFORM_H
 
 #include <QDialog>
-#include <QList>
+
+class QListWidgetItem;
 
 namespace Ui
 {
@@ -67,10 +68,11 @@ public:
   void elementSelected( GCTreeWidgetItem* item, int column );
 
   /*! Triggered when the user clicks the "Delete Element" button. A complete clean-up of everything
-      (first level children, attributes, attribute values, etc) is executed recursively for the
-      deleted element (in other words, everything related to the element is removed, including
-      the entire hierarchy of elements below it). */
-  void deleteElement( const QString& element = QString() );
+      (first level children, attributes, attribute values, etc) is executed for the deleted element
+      (in other words, everything related to the element is removed, including the entire hierarchy
+      of elements below it).
+      \sa GCDataBaseInterface::removeElementTree */
+  void deleteElement();
 
   /*! Triggered when the "Remove Child" button is clicked. The currently active element
       (corresponding to the selected tree widget item) is removed as a first level child
@@ -91,6 +93,10 @@ public:
       attribute combo box is deleted from the active element's list of associated attributes. */
   void deleteAttribute();
 
+  /*! Triggered when a search result is double clicked.  Selects the result's element in the tree
+      widget and its attribute in the attribute combo box. */
+  void searchResultActivated( QListWidgetItem* item );
+
   /*! Triggered by the "show element help" button.  Displays help information related to actions
       executed against elements. */
   void showElementHelp();
@@ -100,14 +106,10 @@ public:
   void showAttributeHelp();
 
 private:
-  /*! Removes a deleted element from all elements that may have it in their first level child lists. */
-  void updateChildLists();
-
   Ui::GCRemoveItemsForm* ui;
   QString m_currentElement;
   QString m_currentElementParent;
   QString m_currentAttribute;
-  QList< QString > m_deletedElements;
 };
 
 #endif // GCREMOVEITEMSFORM_H
\ No newline at end of file
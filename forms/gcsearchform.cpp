@@ -29,6 +29,7 @@
 #include "gcsearchform.h"
 #include "ui_gcsearchform.h"
 #include "utils/gctreewidgetitem.h"
+#include "utils/gcdomtreewidget.h"
 
 #include <QMessageBox>
 #include <QTextBlock>
@@ -49,7 +50,7 @@ bool greaterThan( GCTreeWidgetItem* lhs, GCTreeWidgetItem* rhs )
 
 /*---------------------------------- MEMBER FUNCTIONS ----------------------------------*/
 
-GCSearchForm::GCSearchForm( const QList< GCTreeWidgetItem* >& items, QPlainTextEdit* textEdit, QWidget* parent )
+GCSearchForm::GCSearchForm( GCDomTreeWidget* tree, QPlainTextEdit* textEdit, QWidget* parent )
 : QDialog          ( parent ),
   ui               ( new Ui::GCSearchForm ),
   m_text           ( textEdit ),
@@ -60,7 +61,7 @@ GCSearchForm::GCSearchForm( const QList< GCTreeWidgetItem* >& items, QPlainTextE
   m_firstRun       ( true ),
   m_previousIndex  ( -1 ),
   m_searchFlags    ( 0 ),
-  m_items          ( items )
+  m_tree           ( tree )
 {
   ui->setupUi( this );
   ui->lineEdit->setFocus();
@@ -225,19 +226,8 @@ void GCSearchForm::wholeWords()
 
 QList< GCTreeWidgetItem* > GCSearchForm::gatherMatchingItems( const QString& nodeText )
 {
-  QList< GCTreeWidgetItem* > matchingItems;
-
-  for( int i = 0; i < m_items.size(); ++i )
-  {
-    GCTreeWidgetItem* treeItem = m_items.at( i );
-
-    if( treeItem->toString() == nodeText )
-    {
-      matchingItems.append( treeItem );
-    }
-  }
-
-  return matchingItems;
+  /* The tree keeps its items in a lookup table by content hash. */
+  return m_tree->identicalItems( nodeText );
 }
 
 /*--------------------------------------------------------------------------------------*/
@@ -38,6 +38,7 @@ namespace Ui
 }
 
 class GCTreeWidgetItem;
+class GCDomTreeWidget;
 
 /// Search through the current document for specific text.
 
@@ -53,9 +54,9 @@ Q_OBJECT
 
 public:
   /*! Constructor.
-      @param elements - a list of all the elements in the active document.
+      @param tree - the tree widget representing the active document.
       @param textEdit - the textEdit currently displaying the active document's DOM content. */
-  explicit GCSearchForm( const QList< GCTreeWidgetItem* >& items, QPlainTextEdit* textEdit, QWidget* parent = 0 );
+  explicit GCSearchForm( GCDomTreeWidget* tree, QPlainTextEdit* textEdit, QWidget* parent = 0 );
 
   /*! Destructor. */
   ~GCSearchForm();
@@ -118,7 +119,7 @@ private:
   int m_previousIndex;
 
   QTextDocument::FindFlags m_searchFlags;
-  QList< GCTreeWidgetItem* > m_items;
+  GCDomTreeWidget* m_tree;
 };
 
 #endif // GCSEARCHFORM_H
\ No newline at end of file
@@ -47,6 +47,7 @@
 #include <QTextBlock>
 #include <QMessageBox>
 #include <QFileDialog>
+#include <QDirIterator>
 #include <QTextStream>
 #include <QTextCursor>
 #include <QComboBox>
@@ -58,6 +59,11 @@
 #include <QScrollBar>
 #include <QMovie>
 #include <QSettings>
+#include <QProgressDialog>
+#include <QFutureWatcher>
+#include <QEventLoop>
+#include <QInputDialog>
+#include <QApplication>
 
 /*--------------------------------------------------------------------------------------*/
 
@@ -70,6 +76,8 @@ const qint64 DOMLIMIT  ( 524288 );  // 0.5MB  or ~15 000 lines
 const int ATTRIBUTECOLUMN = 0;
 const int VALUESCOLUMN = 1;
 
+const int PROGRESS_DELAY( 500 );  // milliseconds before database progress is shown
+
 /*--------------------------------- MEMBER FUNCTIONS ----------------------------------*/
 
 GCMainWindow::GCMainWindow( QWidget* parent )
@@ -131,6 +139,7 @@ GCMainWindow::GCMainWindow( QWidget* parent )
   connect( ui->treeWidget, SIGNAL( gcCurrentItemChanged( GCTreeWidgetItem*, int ) ), this, SLOT( elementChanged( GCTreeWidgetItem*, int ) ) );
   connect( ui->treeWidget, SIGNAL( collapsed( QModelIndex ) ), this, SLOT( uncheckExpandAll() ) );
   connect( ui->actionShowTreeElementsVerbose, SIGNAL( triggered( bool ) ), this, SLOT( setShowTreeItemsVerbose( bool ) ) );
+  connect( ui->actionUsePathAwareProfiles, SIGNAL( triggered( bool ) ), this, SLOT( setUsePathAwareProfiles( bool ) ) );
 
   /* Everything table widget related. */
   connect( ui->tableWidget, SIGNAL( itemClicked( QTableWidgetItem* ) ), this, SLOT( attributeSelected( QTableWidgetItem* ) ) );
@@ -140,10 +149,12 @@ GCMainWindow::GCMainWindow( QWidget* parent )
   connect( ui->actionAddItems, SIGNAL( triggered() ), this, SLOT( addItemsToDB() ) );
   connect( ui->actionRemoveItems, SIGNAL( triggered() ), this, SLOT( removeItemsFromDB() ) );
   connect( ui->actionImportXMLToDatabase, SIGNAL( triggered() ), this, SLOT( importXMLFromFile() ) );
+  connect( ui->actionImportXMLDirectoryToDatabase, SIGNAL( triggered() ), this, SLOT( importXMLFromDirectory() ) );
   connect( ui->actionSwitchSessionDatabase, SIGNAL( triggered() ), this, SLOT( switchActiveDatabase() ) );
   connect( ui->actionAddNewDatabase, SIGNAL( triggered() ), this, SLOT( addNewDatabase() ) );
   connect( ui->actionAddExistingDatabase, SIGNAL( triggered() ), this, SLOT( addExistingDatabase() ) );
   connect( ui->actionRemoveDatabase, SIGNAL( triggered() ), this, SLOT( removeDatabase() ) );
+  connect( ui->actionMergeDatabase, SIGNAL( triggered() ), this, SLOT( mergeDatabase() ) );
 
   connect( m_signalMapper, SIGNAL( mapped( QWidget* ) ), this, SLOT( setCurrentComboBox( QWidget* ) ) );
 
@@ -247,6 +258,10 @@ void GCMainWindow::elementSelected( GCTreeWidgetItem* item, int column )
     QString elementName = item->name();
     QStringList attributeNames = GCDataBaseInterface::instance()->attributes( elementName );
 
+    /* Only as much of the path as a context holds is needed (the name alone if path-aware
+    profiles are switched off). */
+    QStringList path = item->namePath( GCDataBaseInterface::instance()->contextDepth() );
+
     /* Add all the associated attribute names to the first column of the table widget,
     create and populate combo boxes with the attributes' known values and insert the
     combo boxes into the second column of the table widget. Finally, insert an "empty"
@@ -271,7 +286,9 @@ void GCMainWindow::elementSelected( GCTreeWidgetItem* item, int column )
       ui->tableWidget->setRowCount( i + 1 );
       ui->tableWidget->setItem( i, 0, label );
 
-      attributeCombo->addItems( GCDataBaseInterface::instance()->attributeValues( elementName, attributeNames.at( i ) ) );
+      /* Only the most frequently used values are added up front, the rest follow when the
+      user expands the drop-down list. */
+      attributeCombo->addAttributeValues( path, attributeNames.at( i ) );
       attributeCombo->setEditable( true );
 
       /* If we are still in the process of building the document, the attribute value will
@@ -282,6 +299,12 @@ void GCMainWindow::elementSelected( GCTreeWidgetItem* item, int column )
 
       if( !attributeValue.isEmpty() )
       {
+        /* The current value isn't necessarily one of the most frequently used ones. */
+        if( attributeCombo->findText( attributeValue ) == -1 )
+        {
+          attributeCombo->addItem( attributeValue );
+        }
+
         attributeCombo->setCurrentIndex( attributeCombo->findText( attributeValue ) );
       }
       else
@@ -311,7 +334,7 @@ void GCMainWindow::elementSelected( GCTreeWidgetItem* item, int column )
     /* Populate the "add child element" combo box with the known first level children of the
     current highlighted element (highlighted in the tree widget, of course). */
     ui->addElementComboBox->clear();
-    ui->addElementComboBox->addItems( GCDataBaseInterface::instance()->children( elementName ) );
+    ui->addElementComboBox->addItems( GCDataBaseInterface::instance()->contextChildren( path ) );
 
     /* The following will be used to allow the user to add an element of the current type to
     its parent (this should improve the user experience as they do not have to explicitly
@@ -453,14 +476,14 @@ void GCMainWindow::attributeValueChanged( const QString& value )
     GCTreeWidgetItem* treeItem = ui->treeWidget->gcCurrentItem();
     QString currentAttributeName = ui->tableWidget->item( m_comboBoxes.value( m_currentCombo ), ATTRIBUTECOLUMN )->text();
 
-    /* If we don't know about this value, we need to add it to the DB. */
-    QStringList attributeValues = GCDataBaseInterface::instance()->attributeValues( treeItem->name(), currentAttributeName );
-
-    if( !attributeValues.contains( value ) )
+    /* Every value the user assigns is recorded (and added to the DB if we don't know about it yet) so that
+      the most frequently used values are offered first.  This slot is also called when the combo box merely
+      loses focus, which is why unchanged values aren't counted. */
+    if( treeItem->element().attribute( currentAttributeName ) != value )
     {
-      if( !GCDataBaseInterface::instance()->updateAttributeValues( treeItem->name(),
-                                                                   currentAttributeName,
-                                                                   QStringList( value ) ) )
+      if( !GCDataBaseInterface::instance()->recordAttributeValue( treeItem->name(),
+                                                                  currentAttributeName,
+                                                                  value ) )
       {
         GCMessageSpace::showErrorMessageBox( this, GCDataBaseInterface::instance()->lastError() );
       }
@@ -499,6 +522,13 @@ bool GCMainWindow::openXMLFile()
     return false;
   }
 
+  return loadXMLFile( fileName );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCMainWindow::loadXMLFile( const QString& fileName )
+{
   /* Note to future self: although the user would have explicitly saved (or not saved) the file
     by the time this functionality is encountered, we only reset the document once we have a new,
     active file to work with since users are fickle and may still change their minds.  In other
@@ -563,9 +593,21 @@ bool GCMainWindow::openXMLFile()
 
   if( !m_busyImporting )
   {
+    /* The check is done in the background since it may take a while for large documents. */
+    QFuture< bool > compatible = GCDataBaseInterface::instance()->isDocumentCompatibleAsync( fileContent );
+    bool isCompatible = waitForDatabase( compatible, "Checking document against active profile..." );
+
+    /* If the user cancelled the check, we abort opening the file altogether. */
+    if( compatible.isCanceled() )
+    {
+      resetDOM();
+      m_currentXMLFileName = "";
+      return false;
+    }
+
     /* If the user is opening an XML file of a kind that isn't supported by the current active DB,
         we need to warn him/her of this fact and provide them with a couple of options. */
-    if( !ui->treeWidget->documentCompatible() )
+    if( !isCompatible )
     {
       bool accepted = GCMessageSpace::userAccepted( "QueryImportXML",
                                                     "Import document?",
@@ -576,21 +618,22 @@ bool GCMainWindow::openXMLFile()
 
       if( accepted )
       {
-        QTimer timer;
-        timer.singleShot( 1000, this, SLOT( createSpinner() ) );
-        qApp->processEvents( QEventLoop::ExcludeUserInputEvents );
+        QFuture< bool > imported = GCDataBaseInterface::instance()->batchProcessXmlAsync( fileContent );
 
-        if( !ui->treeWidget->batchProcessSuccess() )
+        if( !waitForDatabase( imported, "Importing document..." ) )
         {
-          GCMessageSpace::showErrorMessageBox( this, GCDataBaseInterface::instance()->lastError() );
+          if( !imported.isCanceled() )
+          {
+            GCMessageSpace::showErrorMessageBox( this, GCDataBaseInterface::instance()->lastError() );
+          }
         }
         else
         {
+          createSpinner();
           qApp->processEvents( QEventLoop::ExcludeUserInputEvents );
           processDOMDoc();
+          deleteSpinner();
         }
-
-        deleteSpinner();
       }
       else
       {
@@ -703,72 +746,175 @@ void GCMainWindow::closeXMLFile()
 
 void GCMainWindow::importXMLFromFile()
 {
-  /* This flag is used in "openXMLFile" to distinguish between an explicit import
-    and a simple file opening operation. */
-  m_busyImporting = true;
-  ui->treeWidget->setVisible( false );
+  /* Can't import a file if there is no DB profile to add it to. */
+  querySetActiveSession( QString( "No active profile set, please set one for this session." ) );
 
-  if( openXMLFile() )
+  /* Start off where the user finished last. */
+  QString fileName = QFileDialog::getOpenFileName( this, "Import File", GCGlobalSpace::lastUserSelectedDirectory(), "XML Files (*.*)" );
+
+  /* If the user cancelled, we don't want to continue. */
+  if( fileName.isEmpty() )
   {
-    if( importXMLToDatabase() )
-    {
-      if( m_progressLabel )
-      {
-        m_progressLabel->hide();
-      }
+    return;
+  }
 
-      QMessageBox::StandardButtons accept = QMessageBox::question( this,
-                                                                   "Edit file",
-                                                                   "Also open file for editing?",
-                                                                   QMessageBox::Yes | QMessageBox::No,
-                                                                   QMessageBox::Yes );
+  /* Save whatever directory the user ended up in. */
+  QFileInfo fileInfo( fileName );
+  QString finalDirectory = fileInfo.dir().path();
+  GCGlobalSpace::setLastUserSelectedDirectory( finalDirectory );
 
-      if( accept == QMessageBox::Yes )
-      {
-        QTimer timer;
+  if( importXMLToDatabase( fileName ) )
+  {
+    QMessageBox::StandardButtons accept = QMessageBox::question( this,
+                                                                 "Edit file",
+                                                                 "Also open file for editing?",
+                                                                 QMessageBox::Yes | QMessageBox::No,
+                                                                 QMessageBox::Yes );
 
-        if( m_progressLabel )
-        {
-          timer.singleShot( 1000, m_progressLabel, SLOT( show() ) );
-        }
+    if( accept == QMessageBox::Yes &&
+        queryResetDOM( "Save document before continuing?" ) )
+    {
+      /* This flag is used in "loadXMLFile" to distinguish between an explicit import
+        and a simple file opening operation. */
+      m_busyImporting = true;
+      ui->treeWidget->setVisible( false );
 
+      if( loadXMLFile( fileName ) )
+      {
         qApp->processEvents( QEventLoop::ExcludeUserInputEvents );
         processDOMDoc();
       }
-      else
-      {
-        /* DOM was set in the process of opening the XML file and loading its content.  If the user
-            doesn't want to work with the file that was imported, we need to reset it here. */
-        resetDOM();
-        m_currentXMLFileName = "";
-      }
+
+      ui->treeWidget->setVisible( true );
+      m_busyImporting = false;
     }
   }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCMainWindow::importXMLFromDirectory()
+{
+  /* Can't import anything if there is no DB profile to add it to. */
+  querySetActiveSession( QString( "No active profile set, please set one for this session." ) );
+
+  /* Start off where the user finished last. */
+  QString directory = QFileDialog::getExistingDirectory( this, "Import Directory", GCGlobalSpace::lastUserSelectedDirectory() );
+
+  /* If the user cancelled, we don't want to continue. */
+  if( directory.isEmpty() )
+  {
+    return;
+  }
+
+  GCGlobalSpace::setLastUserSelectedDirectory( directory );
+
+  /* Pick up all the XML files in the directory and its sub-directories. */
+  QStringList fileNames;
+  QDirIterator iter( directory, QStringList( "*.xml" ), QDir::Files, QDirIterator::Subdirectories );
+
+  while( iter.hasNext() )
+  {
+    fileNames << iter.next();
+  }
+
+  if( fileNames.isEmpty() )
+  {
+    GCMessageSpace::showErrorMessageBox( this, QString( "No XML files found in \"%1\"." ).arg( directory ) );
+    return;
+  }
+
+  /* The files are parsed concurrently and written to the profile in one go. */
+  QFuture< bool > imported = GCDataBaseInterface::instance()->batchProcessXmlFilesAsync( fileNames );
 
-  ui->treeWidget->setVisible( true );
-  m_busyImporting = false;
+  if( !waitForDatabase( imported, QString( "Importing %1 files..." ).arg( fileNames.size() ) ) )
+  {
+    if( !imported.isCanceled() )
+    {
+      GCMessageSpace::showErrorMessageBox( this, GCDataBaseInterface::instance()->lastError() );
+    }
+
+    return;
+  }
+
+  const QStringList& skippedFiles = GCDataBaseInterface::instance()->lastSkippedFiles();
+
+  if( !skippedFiles.isEmpty() )
+  {
+    /* There may be thousands, only show the first couple. */
+    QString message = QString( "Imported %1 of %2 files, the following could not be imported:\n\n%3" )
+      .arg( fileNames.size() - skippedFiles.size() )
+      .arg( fileNames.size() )
+      .arg( QStringList( skippedFiles.mid( 0, 10 ) ).join( "\n" ) );
+
+    if( skippedFiles.size() > 10 )
+    {
+      message.append( QString( "\n...and %1 more." ).arg( skippedFiles.size() - 10 ) );
+    }
+
+    QMessageBox::warning( this, "Files skipped", message );
+  }
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-bool GCMainWindow::importXMLToDatabase()
+bool GCMainWindow::importXMLToDatabase( const QString& fileName )
 {
-  createSpinner();
-  qApp->processEvents( QEventLoop::ExcludeUserInputEvents );
+  /* The file is streamed straight into the profile (no DOM is built), which means that files
+    that are too large to be opened for editing can still be imported. */
+  QFuture< bool > imported = GCDataBaseInterface::instance()->batchProcessXmlFileAsync( fileName );
 
-  if( !ui->treeWidget->batchProcessSuccess() )
+  if( !waitForDatabase( imported, "Importing file..." ) )
   {
-    GCMessageSpace::showErrorMessageBox( this, GCDataBaseInterface::instance()->lastError() );
-    deleteSpinner();
+    if( !imported.isCanceled() )
+    {
+      GCMessageSpace::showErrorMessageBox( this, GCDataBaseInterface::instance()->lastError() );
+    }
+
     return false;
   }
 
-  deleteSpinner();
   return true;
 }
 
 /*--------------------------------------------------------------------------------------*/
 
+bool GCMainWindow::waitForDatabase( QFuture< bool > future, const QString& labelText )
+{
+  /* Only shown if the operation takes a while (we show it ourselves, see below). */
+  QProgressDialog progress( labelText, "Cancel", 0, 0, this );
+  progress.setWindowModality( Qt::WindowModal );
+  progress.setMinimumDuration( PROGRESS_DELAY );
+
+  QEventLoop loop;
+  QFutureWatcher< bool > watcher;
+  connect( &watcher, SIGNAL( progressRangeChanged( int,int ) ), &progress, SLOT( setRange( int,int ) ) );
+  connect( &watcher, SIGNAL( progressValueChanged( int ) ), &progress, SLOT( setValue( int ) ) );
+  connect( &progress, SIGNAL( canceled() ), &watcher, SLOT( cancel() ) );
+  connect( &watcher, SIGNAL( finished() ), &loop, SLOT( quit() ) );
+  watcher.setFuture( future );
+
+  /* The future may have finished before the watcher was connected, in which case "finished"
+    has already been emitted.  Until the (window modal) dialog is shown, user input is held back
+    so that the user can't start another import, open a file or switch profiles while this call
+    is still on the stack (the input is delivered once we're done). */
+  if( !future.isFinished() )
+  {
+    QTimer::singleShot( PROGRESS_DELAY, &loop, SLOT( quit() ) );
+    loop.exec( QEventLoop::ExcludeUserInputEvents );
+  }
+
+  if( !future.isFinished() )
+  {
+    progress.show();
+    loop.exec();
+  }
+
+  return !future.isCanceled() && future.result();
+}
+
+/*--------------------------------------------------------------------------------------*/
+
 void GCMainWindow::addNewDatabase()
 {
   GCDBSessionManager* manager = createDBSessionManager();
@@ -842,6 +988,78 @@ void GCMainWindow::removeDatabase()
 
 /*--------------------------------------------------------------------------------------*/
 
+void GCMainWindow::mergeDatabase()
+{
+  querySetActiveSession( QString( "No active profile set, please set one for this session." ) );
+
+  GCDataBaseInterface* dbInterface = GCDataBaseInterface::instance();
+  QStringList profiles = dbInterface->connectionList();
+  profiles.removeAll( dbInterface->activeSessionName() );
+
+  if( profiles.isEmpty() )
+  {
+    GCMessageSpace::showErrorMessageBox( this, "There are no other profiles to merge." );
+    return;
+  }
+
+  bool accepted = false;
+  QString profile = QInputDialog::getItem( this,
+                                           "Merge Profile",
+                                           QString( "Merge into \"%1\":" ).arg( dbInterface->activeSessionName() ),
+                                           profiles,
+                                           0,
+                                           false,
+                                           &accepted );
+
+  if( !accepted || profile.isEmpty() )
+  {
+    return;
+  }
+
+  GCProfileDifferences added;
+
+  if( !dbInterface->profileDifferences( profile, &added ) )
+  {
+    GCMessageSpace::showErrorMessageBox( this, dbInterface->lastError() );
+    return;
+  }
+
+  QMessageBox::StandardButton merge = QMessageBox::question( this,
+                                                             "Merge Profile",
+                                                             QString( "\"%1\" adds %2 elements, %3 child relationships, %4 attributes "
+                                                                      "and %5 attribute values to the active profile. Merge?" )
+                                                               .arg( profile )
+                                                               .arg( added.elements.size() )
+                                                               .arg( added.children.size() )
+                                                               .arg( added.attributes.size() )
+                                                               .arg( added.values.size() ),
+                                                             QMessageBox::Yes | QMessageBox::No,
+                                                             QMessageBox::Yes );
+
+  if( merge != QMessageBox::Yes )
+  {
+    return;
+  }
+
+  QApplication::setOverrideCursor( Qt::WaitCursor );
+  bool merged = dbInterface->mergeProfile( profile );
+  QApplication::restoreOverrideCursor();
+
+  if( !merged )
+  {
+    GCMessageSpace::showErrorMessageBox( this, dbInterface->lastError() );
+    return;
+  }
+
+  /* The element selected in the tree may have picked up new children and values. */
+  if( ui->treeWidget->gcCurrentItem() )
+  {
+    elementSelected( ui->treeWidget->gcCurrentItem(), 0 );
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
 void GCMainWindow::switchActiveDatabase()
 {
   GCDBSessionManager* manager = createDBSessionManager();
@@ -1051,7 +1269,7 @@ void GCMainWindow::addItemsToDB()
 void GCMainWindow::searchDocument()
 {
   /* Delete on close flag set (no clean-up needed). */
-  GCSearchForm* form = new GCSearchForm( ui->treeWidget->allTreeWidgetItems(), ui->dockWidgetTextEdit, this );
+  GCSearchForm* form = new GCSearchForm( ui->treeWidget, ui->dockWidgetTextEdit, this );
   connect( form, SIGNAL( foundItem( GCTreeWidgetItem* ) ), this, SLOT( itemFound( GCTreeWidgetItem* ) ) );
   form->exec();
 }
@@ -1315,6 +1533,13 @@ void GCMainWindow::setShowTreeItemsVerbose( bool verbose )
 
 /*--------------------------------------------------------------------------------------*/
 
+void GCMainWindow::setUsePathAwareProfiles( bool use )
+{
+  GCDataBaseInterface::instance()->setPathAwareProfiles( use );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
 GCDBSessionManager* GCMainWindow::createDBSessionManager()
 {
   /* Clean-up is the responsibility of the calling function. */
@@ -1375,9 +1600,14 @@ void GCMainWindow::highlightTextElement( GCTreeWidgetItem* item )
 {
   if( item )
   {
-    QString stringToMatch = item->toString();
-    int pos = ui->treeWidget->itemPositionRelativeToIdenticalSiblings( stringToMatch, item->index() );
-    ui->dockWidgetTextEdit->findTextRelativeToDuplicates( stringToMatch, pos );
+    /* The text edit knows where each element is, unless its content was edited directly (in
+      which case we'll have to look for the element's text). */
+    if( !ui->dockWidgetTextEdit->findElement( item->index() ) )
+    {
+      QString stringToMatch = item->toString();
+      int pos = ui->treeWidget->itemPositionRelativeToIdenticalSiblings( stringToMatch, item->index() );
+      ui->dockWidgetTextEdit->findTextRelativeToDuplicates( stringToMatch, pos );
+    }
   }
 }
 
@@ -1501,6 +1731,7 @@ void GCMainWindow::readSettings()
   ui->actionRememberWindowGeometry->setChecked( GCGlobalSpace::useWindowSettings() );
   ui->actionUseDarkTheme->setChecked( GCGlobalSpace::useDarkTheme() );
   ui->actionShowHelpButtons->setChecked( GCGlobalSpace::showHelpButtons() );
+  ui->actionUsePathAwareProfiles->setChecked( GCGlobalSpace::usePathAwareProfiles() );
 }
 
 /*--------------------------------------------------------------------------------------*/
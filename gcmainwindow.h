@@ -32,6 +32,7 @@
 #include <QMainWindow>
 #include <QHash>
 #include <QDomElement>
+#include <QFuture>
 
 namespace Ui
 {
@@ -207,9 +208,15 @@ private slots:
       \sa newXMLFile
       \sa saveXMLFile
       \sa saveXMLFileAs
-      \sa importXMLToDatabase */
+      \sa importXMLToDatabase
+      \sa importXMLFromDirectory */
   void importXMLFromFile();
 
+  /*! Triggered by the "Import XML Directory to Profile" UI action.  Imports all the XML files in
+      the selected directory (and its sub-directories) to the active profile in one go.
+      \sa importXMLFromFile */
+  void importXMLFromDirectory();
+
   /*! Triggered by the "Add New Profile" UI action.
       \sa addExistingDatabase
       \sa removeDatabase
@@ -231,6 +238,11 @@ private slots:
       \sa activeDatabaseChanged */
   void removeDatabase();
 
+  /*! Triggered by the "Merge Profile" UI action.  Shows the user what the selected profile would add
+      to the active profile and merges the two if the user agrees.
+      \sa GCDataBaseInterface::mergeProfile */
+  void mergeDatabase();
+
   /*! Triggered by the "Switch Profile" UI action.
       \sa addNewDatabase
       \sa addExistingDatabase
@@ -335,6 +347,9 @@ private slots:
   /*! Decides whether or not to display tree items' elements "verbose" throughout the entire application. */
   void setShowTreeItemsVerbose( bool verbose );
 
+  /*! Switches path-aware profiles on or off (only imports made while switched on record contexts). */
+  void setUsePathAwareProfiles( bool use );
+
   /*! Opens this application's website. */
   void goToSite();
 
@@ -393,9 +408,20 @@ private:
       \sa resetDOM */
   bool queryResetDOM( const QString& resetReason );
 
-  /*! Imports the DOM content to the active database.
+  /*! Imports the content of "fileName" to the active database (without building a DOM document).
       \sa importXMLFromFile */
-  bool importXMLToDatabase();
+  bool importXMLToDatabase( const QString& fileName );
+
+  /*! Loads "fileName" into the DOM (and tree widget), checking the document against the active
+      profile unless an import is in progress.
+      \sa openXMLFile */
+  bool loadXMLFile( const QString& fileName );
+
+  /*! Waits for an asynchronous database operation to complete while keeping the UI responsive.  The
+      user is shown a progress dialog (labelled "labelText") through which the operation can be cancelled.
+      Returns "false" if the operation was cancelled or its result is "false".
+      \sa GCDataBaseInterface::batchProcessXmlFilesAsync */
+  bool waitForDatabase( QFuture< bool > future, const QString& labelText );
 
   /*! Deletes the "busy loading" spinner.
       \sa createSpinner */
@@ -0,0 +1,124 @@
+/* Copyright (c) 2012 - 2013 by William Hallatt.
+ *
+ * This file forms part of "XML Mill".
+ *
+ * The official website for this project is <http://www.goblincoding.com> and,
+ * although not compulsory, it would be appreciated if all works of whatever
+ * nature using this source code (in whole or in part) include a reference to
+ * this site.
+ *
+ * Should you wish to contact me for whatever reason, please do so via:
+ *
+ *                 <http://www.goblincoding.com/contact>
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program (GNUGPL.txt).  If not, see
+ *
+ *                    <http://www.gnu.org/licenses/>
+ */
+
+#include "db/gcbatchprocessorhelper.h"
+
+#include <QtTest>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+
+/*--------------------------------------------------------------------------------------*/
+
+/* Each synthetic element has this many attributes. */
+static const int ATTRIBUTES_PER_ELEMENT( 10 );
+
+/*--------------------------------------------------------------------------------------*/
+
+/// Benchmarks GCBatchProcessorHelper's classification of extracted records.
+
+/**
+  Every element, child and attribute in the synthetic document is already known to the (equally
+  synthetic) profile, so the helper has to look up each of them and ends up with nothing new to add.
+  The document grows along with the profile, which means that the time per row should grow linearly
+  with the number of known attribute keys (with linear lookups, it grew quadratically).
+*/
+class GCBatchProcessorHelperBenchmark : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void classifyKnownRecords_data();
+  void classifyKnownRecords();
+};
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCBatchProcessorHelperBenchmark::classifyKnownRecords_data()
+{
+  QTest::addColumn< int >( "attributeKeys" );
+
+  QTest::newRow( "1k attribute keys" ) << 1000;
+  QTest::newRow( "5k attribute keys" ) << 5000;
+  QTest::newRow( "20k attribute keys" ) << 20000;
+  QTest::newRow( "50k attribute keys" ) << 50000;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCBatchProcessorHelperBenchmark::classifyKnownRecords()
+{
+  QFETCH( int, attributeKeys );
+
+  QSet< QString > knownElements;
+  GCRelationshipKeySet knownChildKeys;
+  GCRelationshipKeySet knownAttributeKeys;
+
+  /* A flat document in which the root holds every known element once (with all its attributes). */
+  QString xml;
+  QXmlStreamWriter writer( &xml );
+  writer.writeStartElement( "root" );
+  knownElements.insert( "root" );
+
+  for( int i = 0; i < attributeKeys / ATTRIBUTES_PER_ELEMENT; ++i )
+  {
+    QString element = QString( "element%1" ).arg( i );
+    knownElements.insert( element );
+    knownChildKeys.insert( GCRelationshipKey( "root", element ) );
+    writer.writeStartElement( element );
+
+    for( int j = 0; j < ATTRIBUTES_PER_ELEMENT; ++j )
+    {
+      QString attribute = QString( "attribute%1" ).arg( j );
+      knownAttributeKeys.insert( GCRelationshipKey( element, attribute ) );
+      writer.writeAttribute( attribute, QString::number( j ) );
+    }
+
+    writer.writeEndElement();
+  }
+
+  writer.writeEndElement();
+
+  QBENCHMARK
+  {
+    QXmlStreamReader reader( xml );
+    GCBatchProcessorHelper helper( &reader, knownElements, knownChildKeys, knownAttributeKeys );
+
+    QVERIFY( !reader.hasError() );
+    QVERIFY( helper.newElementsToAdd().isEmpty() );
+    QVERIFY( helper.newChildElementsToAdd().isEmpty() );
+    QVERIFY( helper.newAttributesToAdd().isEmpty() );
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QTEST_APPLESS_MAIN( GCBatchProcessorHelperBenchmark )
+
+#include "tst_gcbatchprocessorhelper.moc"
+
+/*--------------------------------------------------------------------------------------*/
\ No newline at end of file
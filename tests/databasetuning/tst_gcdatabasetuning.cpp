@@ -0,0 +1,269 @@
+/* Copyright (c) 2012 - 2013 by William Hallatt.
+ *
+ * This file forms part of "XML Mill".
+ *
+ * The official website for this project is <http://www.goblincoding.com> and,
+ * although not compulsory, it would be appreciated if all works of whatever
+ * nature using this source code (in whole or in part) include a reference to
+ * this site.
+ *
+ * Should you wish to contact me for whatever reason, please do so via:
+ *
+ *                 <http://www.goblincoding.com/contact>
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program (GNUGPL.txt).  If not, see
+ *
+ *                    <http://www.gnu.org/licenses/>
+ */
+
+#include "db/gcdatabaseinterface.h"
+#include "utils/gcglobalspace.h"
+
+#include <QtTest>
+#include <QSettings>
+#include <QTemporaryDir>
+#include <QXmlStreamWriter>
+
+/*--------------------------------------------------------------------------------------*/
+
+/* Size of the synthetic document (and therefore of the profiles built from it). */
+static const int ELEMENTS( 2000 );
+static const int ATTRIBUTES_PER_ELEMENT( 5 );
+static const int VALUES_PER_ATTRIBUTE( 20 );
+
+/* Number of single-value updates per benchmark iteration (each is a transaction of its own). */
+static const int UPDATES( 200 );
+
+/*--------------------------------------------------------------------------------------*/
+
+/// Benchmarks profile imports, updates and loads under each database tuning preset.
+
+/**
+  Each preset gets a profile database of its own in a temporary directory, which is also where the
+  interface keeps its list of known databases during the benchmark (the user's own list is left alone).
+  The benchmark is built with test settings (see GCGlobalSpace::ORGANISATION), so selecting presets
+  doesn't touch the user's settings either.
+
+  Lookups are served from the profile cache, so the database is only read when a profile is loaded
+  without a snapshot, which is what "loadProfile" measures.
+*/
+class GCDataBaseTuningBenchmark : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void cleanupTestCase();
+
+  void importDocument_data();
+  void importDocument();
+  void reimportDocument_data();
+  void reimportDocument();
+  void updateAttributeValues_data();
+  void updateAttributeValues();
+  void loadProfile_data();
+  void loadProfile();
+
+private:
+  /*! Adds a "tuning" column with a row per preset. */
+  void addTuningRows();
+
+  /*! Sets "tuning" as the preset and activates the profile database "fileName" (which applies the
+      preset).  If "fileName" is empty, the profile database used for "tuning" is activated. */
+  bool activateProfile( int tuning, const QString& fileName = QString() );
+
+  /*! Returns the file name of the profile database used for "tuning". */
+  QString profileFileName( int tuning ) const;
+
+  QTemporaryDir m_dir;
+  QString m_documentFile;
+  QString m_previousDirectory;
+};
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCDataBaseTuningBenchmark::initTestCase()
+{
+  QVERIFY( m_dir.isValid() );
+
+  m_previousDirectory = QDir::currentPath();
+  QDir::setCurrent( m_dir.path() );
+  QVERIFY( GCDataBaseInterface::instance()->isInitialised() );
+
+  m_documentFile = m_dir.filePath( "document.xml" );
+  QFile file( m_documentFile );
+  QVERIFY( file.open( QIODevice::WriteOnly ) );
+
+  QXmlStreamWriter writer( &file );
+  writer.writeStartDocument();
+  writer.writeStartElement( "root" );
+
+  for( int i = 0; i < ELEMENTS; ++i )
+  {
+    writer.writeStartElement( QString( "element%1" ).arg( i % ( ELEMENTS / 10 ) ) );
+
+    for( int j = 0; j < ATTRIBUTES_PER_ELEMENT; ++j )
+    {
+      writer.writeAttribute( QString( "attribute%1" ).arg( j ), QString::number( ( i + j ) % VALUES_PER_ATTRIBUTE ) );
+    }
+
+    writer.writeEndElement();
+  }
+
+  writer.writeEndElement();
+  writer.writeEndDocument();
+  file.close();
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCDataBaseTuningBenchmark::cleanupTestCase()
+{
+  /* The same as what happens when the application quits (closes the worker's connection). */
+  QMetaObject::invokeMethod( GCDataBaseInterface::instance(), "stopWorker" );
+
+  QSettings( GCGlobalSpace::ORGANISATION, GCGlobalSpace::APPLICATION ).clear();
+  QDir::setCurrent( m_previousDirectory );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCDataBaseTuningBenchmark::importDocument_data()
+{
+  addTuningRows();
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCDataBaseTuningBenchmark::importDocument()
+{
+  QFETCH( int, tuning );
+  QVERIFY( activateProfile( tuning, m_dir.filePath( QString( "import%1.db" ).arg( tuning ) ) ) );
+
+  /* Only an import into an empty profile writes the entire profile (as a single transaction),
+    which is why this is measured once, against a profile of its own. */
+  QBENCHMARK_ONCE
+  {
+    QVERIFY2( GCDataBaseInterface::instance()->batchProcessXmlFile( m_documentFile ),
+              qPrintable( GCDataBaseInterface::instance()->lastError() ) );
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCDataBaseTuningBenchmark::reimportDocument_data()
+{
+  addTuningRows();
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCDataBaseTuningBenchmark::reimportDocument()
+{
+  QFETCH( int, tuning );
+  QVERIFY( activateProfile( tuning ) );
+  QVERIFY( GCDataBaseInterface::instance()->batchProcessXmlFile( m_documentFile ) );
+
+  /* Once the profile knows the document, importing it again only updates the frequencies of
+    all its values. */
+  QBENCHMARK
+  {
+    QVERIFY2( GCDataBaseInterface::instance()->batchProcessXmlFile( m_documentFile ),
+              qPrintable( GCDataBaseInterface::instance()->lastError() ) );
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCDataBaseTuningBenchmark::updateAttributeValues_data()
+{
+  addTuningRows();
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCDataBaseTuningBenchmark::updateAttributeValues()
+{
+  QFETCH( int, tuning );
+  QVERIFY( activateProfile( tuning ) );
+
+  /* This is what happens whenever the user assigns a value to an attribute, i.e. lots of tiny
+    transactions (which is where the presets' sync settings make the biggest difference). */
+  QBENCHMARK
+  {
+    for( int i = 0; i < UPDATES; ++i )
+    {
+      QVERIFY2( GCDataBaseInterface::instance()->recordAttributeValue( "element0", "attribute0", QString::number( i % VALUES_PER_ATTRIBUTE ) ),
+                qPrintable( GCDataBaseInterface::instance()->lastError() ) );
+    }
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCDataBaseTuningBenchmark::loadProfile_data()
+{
+  addTuningRows();
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCDataBaseTuningBenchmark::loadProfile()
+{
+  QFETCH( int, tuning );
+  QVERIFY( activateProfile( tuning ) );
+  QVERIFY( GCDataBaseInterface::instance()->batchProcessXmlFile( m_documentFile ) );
+
+  /* Without its snapshot, the profile is read from the database (the snapshot file name is
+    that of the database with ".snapshot" appended). */
+  QBENCHMARK
+  {
+    QFile::remove( profileFileName( tuning ) + ".snapshot" );
+    QVERIFY2( GCDataBaseInterface::instance()->setActiveDatabase( profileFileName( tuning ) ),
+              qPrintable( GCDataBaseInterface::instance()->lastError() ) );
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCDataBaseTuningBenchmark::addTuningRows()
+{
+  QTest::addColumn< int >( "tuning" );
+
+  QTest::newRow( "safe" ) << int( GCGlobalSpace::SafeTuning );
+  QTest::newRow( "balanced" ) << int( GCGlobalSpace::BalancedTuning );
+  QTest::newRow( "fast" ) << int( GCGlobalSpace::FastTuning );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+bool GCDataBaseTuningBenchmark::activateProfile( int tuning, const QString& fileName )
+{
+  GCGlobalSpace::setDatabaseTuning( static_cast< GCGlobalSpace::DatabaseTuning >( tuning ) );
+  return GCDataBaseInterface::instance()->setActiveDatabase( fileName.isEmpty() ? profileFileName( tuning ) : fileName );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QString GCDataBaseTuningBenchmark::profileFileName( int tuning ) const
+{
+  return m_dir.filePath( QString( "tuning%1.db" ).arg( tuning ) );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QTEST_MAIN( GCDataBaseTuningBenchmark )
+
+#include "tst_gcdatabasetuning.moc"
+
+/*--------------------------------------------------------------------------------------*/
\ No newline at end of file
@@ -0,0 +1,139 @@
+/* Copyright (c) 2012 - 2013 by William Hallatt.
+ *
+ * This file forms part of "XML Mill".
+ *
+ * The official website for this project is <http://www.goblincoding.com> and,
+ * although not compulsory, it would be appreciated if all works of whatever
+ * nature using this source code (in whole or in part) include a reference to
+ * this site.
+ *
+ * Should you wish to contact me for whatever reason, please do so via:
+ *
+ *                 <http://www.goblincoding.com/contact>
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program (GNUGPL.txt).  If not, see
+ *
+ *                    <http://www.gnu.org/licenses/>
+ */
+
+#include "db/gcvalueindex.h"
+
+#include <QtTest>
+
+/*--------------------------------------------------------------------------------------*/
+
+/* The most results the search boxes ask for (see GCValueSearch). */
+static const int SEARCH_RESULTS( 500 );
+
+/* The synthetic values are spread over this many element/attribute pairs. */
+static const int ATTRIBUTE_KEYS( 1000 );
+
+/*--------------------------------------------------------------------------------------*/
+
+/// Benchmarks the latency of GCValueIndex lookups as made by the value search boxes.
+
+/**
+  The index holds GUID-like values (the kind of values that make profiles grow) and is queried
+  the way a search box queries it while the user types: one and two character queries (which
+  are answered as prefix queries) followed by longer substring queries.  Each lookup should take
+  well under 100 ms, even with a million distinct values.
+*/
+class GCValueIndexBenchmark : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void cleanupTestCase();
+  void find_data();
+  void find();
+
+private:
+  /*! Returns the index holding "values" distinct values (built once per size). */
+  const GCValueIndex& index( int values );
+
+  QMap< int, GCValueIndex* > m_indices;
+};
+
+/*--------------------------------------------------------------------------------------*/
+
+const GCValueIndex& GCValueIndexBenchmark::index( int values )
+{
+  if( !m_indices.contains( values ) )
+  {
+    GCValueIndex* valueIndex = new GCValueIndex;
+
+    for( int i = 0; i < values; ++i )
+    {
+      QString value = QString( "%1-%2" ).arg( quint64( i ) * 2654435761u % 4294967296u, 8, 16, QChar( '0' ) ).arg( i, 8, 10, QChar( '0' ) );
+      valueIndex->addValue( QString( "element%1" ).arg( i % ATTRIBUTE_KEYS ), "id", value );
+    }
+
+    m_indices.insert( values, valueIndex );
+  }
+
+  return *m_indices.value( values );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCValueIndexBenchmark::cleanupTestCase()
+{
+  qDeleteAll( m_indices );
+  m_indices.clear();
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCValueIndexBenchmark::find_data()
+{
+  QTest::addColumn< int >( "values" );
+  QTest::addColumn< QString >( "text" );
+  QTest::addColumn< bool >( "substring" );
+
+  foreach( int values, QList< int >() << 100000 << 1000000 )
+  {
+    QByteArray size = QByteArray::number( values / 1000 ) + "k values, ";
+
+    QTest::newRow( size + "1 character prefix" ) << values << "a" << false;
+    QTest::newRow( size + "1 character substring" ) << values << "a" << true;
+    QTest::newRow( size + "2 character substring" ) << values << "a1" << true;
+    QTest::newRow( size + "3 character substring" ) << values << "a1b" << true;
+    QTest::newRow( size + "6 character substring" ) << values << "-00012" << true;
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCValueIndexBenchmark::find()
+{
+  QFETCH( int, values );
+  QFETCH( QString, text );
+  QFETCH( bool, substring );
+
+  const GCValueIndex& valueIndex = index( values );
+  GCValueIndex::MatchMode mode = substring ? GCValueIndex::SubstringMatch : GCValueIndex::PrefixMatch;
+
+  QBENCHMARK
+  {
+    QList< GCValueMatch > matches = valueIndex.find( text, mode, SEARCH_RESULTS );
+    QVERIFY( matches.size() <= SEARCH_RESULTS );
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+QTEST_APPLESS_MAIN( GCValueIndexBenchmark )
+
+#include "tst_gcvalueindex.moc"
+
+/*--------------------------------------------------------------------------------------*/
\ No newline at end of file
@@ -27,11 +27,81 @@
  */
 
 #include "gccombobox.h"
+#include "db/gcdatabaseinterface.h"
+
+#include <QSet>
+
+/*--------------------------------------------------------------------------------------*/
+
+/* The number of values added straight away by "addAttributeValues". */
+static const int RANKED_VALUES( 100 );
 
 /*--------------------------------------------------------------------------------------*/
 
 GCComboBox::GCComboBox( QWidget* parent )
-: QComboBox( parent ) {}
+: QComboBox          ( parent ),
+  m_path             (),
+  m_attribute        ( "" ),
+  m_hasDeferredValues( false )
+{
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCComboBox::addAttributeValues( const QStringList& path, const QString& attribute )
+{
+  if( path.isEmpty() )
+  {
+    return;
+  }
+
+  GCDataBaseInterface* dbInterface = GCDataBaseInterface::instance();
+  QString element = path.last();
+  QStringList values = dbInterface->rankedContextAttributeValues( path, attribute, RANKED_VALUES );
+  addItems( values );
+
+  /* Let the user know what kind of values the attribute is known to take. */
+  setToolTip( dbInterface->attributePolicy( element, attribute ).description( dbInterface->attributeValues( element, attribute ).size() ) );
+
+  m_path = path;
+  m_attribute = attribute;
+  m_hasDeferredValues = ( values.size() == RANKED_VALUES );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCComboBox::showPopup()
+{
+  if( m_hasDeferredValues )
+  {
+    m_hasDeferredValues = false;
+
+    /* Items may also have been added by other means in the meantime (e.g. the current value). */
+    QSet< QString > known;
+
+    for( int i = 0; i < count(); ++i )
+    {
+      known.insert( itemText( i ) );
+    }
+
+    QStringList remaining;
+
+    foreach( QString value, GCDataBaseInterface::instance()->contextAttributeValues( m_path, m_attribute ) )
+    {
+      if( !known.contains( value ) )
+      {
+        remaining << value;
+      }
+    }
+
+    /* Adding items doesn't change the selection, but we don't want to take any chances. */
+    bool signalsWereBlocked = blockSignals( true );
+    addItems( remaining );
+    blockSignals( signalsWereBlocked );
+  }
+
+  QComboBox::showPopup();
+}
 
 /*--------------------------------------------------------------------------------------*/
 
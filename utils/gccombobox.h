@@ -37,6 +37,11 @@
     Initially I understood that the "activated" signal is emitted when a user clicks on
     a QComboBox (e.g. when the dropdown is expanded), but it turns out that this is not the
     case.
+
+    It also knows how to populate itself with an attribute's known values in order of frequency,
+    deferring the bulk of the values until the user actually expands the drop-down list (some
+    attributes have tens of thousands of distinct values).  If path-aware profiles are switched on,
+    only the values known in the element's context are offered (where known).
 */
 class GCComboBox : public QComboBox
 {
@@ -46,6 +51,15 @@ public:
   /*! Constructor. */
   explicit GCComboBox( QWidget* parent = 0 );
 
+  /*! Adds the most frequently used values of "attribute" (associated with the last element in "path",
+      outermost element first) in the active profile.  The remaining values are only added when the
+      drop-down list is shown for the first time.
+      \sa GCDataBaseInterface::rankedContextAttributeValues */
+  void addAttributeValues( const QStringList& path, const QString& attribute );
+
+  /*! Re-implemented from QComboBox to add the values deferred by "addAttributeValues". */
+  void showPopup();
+
 protected:
   /*! Re-eimplemented from QComboBox to emit the activated(int) signal. */
   void mousePressEvent( QMouseEvent* e );
@@ -55,6 +69,11 @@ protected:
 
   /*! Re-eimplemented from QComboBox to emit the currentIndexChanged(QString) signal. */
   void focusOutEvent( QFocusEvent* e );
+
+private:
+  QStringList m_path;
+  QString m_attribute;
+  bool m_hasDeferredValues;
 };
 
 #endif // GCCOMBOBOX_H
\ No newline at end of file
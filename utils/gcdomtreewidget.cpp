@@ -32,15 +32,42 @@
 #include "utils/gcmessagespace.h"
 #include "utils/gcglobalspace.h"
 
-#include <QApplication>
 #include <QDomDocument>
 #include <QAction>
 #include <QMouseEvent>
 #include <QInputDialog>
 #include <QXmlInputSource>
 
+/*-------------------------------- NON MEMBER FUNCTIONS --------------------------------*/
+
+namespace
+{
+  /* QDomNode does not expose its identity, but its (protected) implementation pointer is
+    exactly that. */
+  class GCDomNodeIdentity : public QDomNode
+  {
+  public:
+    explicit GCDomNodeIdentity( const QDomNode& node ) : QDomNode( node ) {}
+    quintptr identity() const { return reinterpret_cast< quintptr >( impl ); }
+  };
+
+  /*--------------------------------------------------------------------------------------*/
+
+  bool indexLessThan( GCTreeWidgetItem* lhs, GCTreeWidgetItem* rhs )
+  {
+    return ( lhs->index() < rhs->index() );
+  }
+}
+
 /*--------------------------------------------------------------------------------------*/
 
+uint qHash( const QDomNode& node )
+{
+  return qHash( GCDomNodeIdentity( node ).identity() );
+}
+
+/*---------------------------------- MEMBER FUNCTIONS ----------------------------------*/
+
 GCDomTreeWidget::GCDomTreeWidget( QWidget* parent )
 : QTreeWidget           ( parent ),
   m_activeItem          ( NULL ),
@@ -49,7 +76,12 @@ GCDomTreeWidget::GCDomTreeWidget( QWidget* parent )
   m_isEmpty             ( true ),
   m_busyIterating       ( false ),
   m_itemBeingManipulated( false ),
-  m_items               (),
+  m_itemsByNode         (),
+  m_itemsByIndex        (),
+  m_itemsByHash         (),
+  m_itemHashes          (),
+  m_unfetchedItems      (),
+  m_descendantCounts    (),
   m_comments            ()
 {
   setFont( QFont( GCGlobalSpace::FONT, GCGlobalSpace::FONTSIZE ) );
@@ -94,6 +126,7 @@ GCDomTreeWidget::GCDomTreeWidget( QWidget* parent )
   connect( this, SIGNAL( itemClicked( QTreeWidgetItem*,int ) ), this, SLOT( emitGcCurrentItemSelected( QTreeWidgetItem*,int ) ) );
   connect( this, SIGNAL( itemActivated( QTreeWidgetItem*, int ) ), this, SLOT( emitGcCurrentItemSelected( QTreeWidgetItem*, int ) ) );
   connect( this, SIGNAL( itemChanged( QTreeWidgetItem*, int ) ), this, SLOT( emitGcCurrentItemChanged( QTreeWidgetItem*, int ) ) );
+  connect( this, SIGNAL( itemExpanded( QTreeWidgetItem* ) ), this, SLOT( fetchChildren( QTreeWidgetItem* ) ) );
 }
 
 /*--------------------------------------------------------------------------------------*/
@@ -183,13 +216,14 @@ void GCDomTreeWidget::setActiveCommentValue( const QString& value )
 
 /*--------------------------------------------------------------------------------------*/
 
-QList< GCTreeWidgetItem* > GCDomTreeWidget::includedTreeWidgetItems() const
+QList< GCTreeWidgetItem* > GCDomTreeWidget::includedTreeWidgetItems()
 {
+  QList< GCTreeWidgetItem* > items = allTreeWidgetItems();
   QList< GCTreeWidgetItem* > includedItems;
 
-  for( int i = 0; i < m_items.size(); ++i )
+  for( int i = 0; i < items.size(); ++i )
   {
-    GCTreeWidgetItem* localItem = m_items.at( i );
+    GCTreeWidgetItem* localItem = items.at( i );
 
     if( !localItem->elementExcluded() )
     {
@@ -202,39 +236,99 @@ QList< GCTreeWidgetItem* > GCDomTreeWidget::includedTreeWidgetItems() const
 
 /*--------------------------------------------------------------------------------------*/
 
-const QList< GCTreeWidgetItem* >& GCDomTreeWidget::allTreeWidgetItems() const
+QList< GCTreeWidgetItem* > GCDomTreeWidget::allTreeWidgetItems()
 {
-  return m_items;
+  fetchAll();
+
+  QList< GCTreeWidgetItem* > items = m_itemsByNode.values();
+  qSort( items.begin(), items.end(), indexLessThan );
+  return items;
 }
 
 /*--------------------------------------------------------------------------------------*/
 
-int GCDomTreeWidget::itemPositionRelativeToIdenticalSiblings( const QString& nodeText, int itemIndex ) const
+QList< GCTreeWidgetItem* > GCDomTreeWidget::identicalItems( const QString& nodeText )
 {
-  QList< int > indices;
+  fetchAll();
 
-  if( !m_isEmpty )
+  QList< GCTreeWidgetItem* > items;
+
+  /* Different content may (very rarely) produce the same hash. */
+  foreach( GCTreeWidgetItem* item, m_itemsByHash.values( GCTreeWidgetItem::contentHash( nodeText ) ) )
   {
-    /* If there are multiple nodes with the same element name (more likely than not), check which
-    of these nodes are exact duplicates with regards to attributes, values, etc. */
-    for( int i = 0; i < m_items.size(); ++i )
+    if( item->toString() == nodeText )
     {
-      GCTreeWidgetItem* treeItem = m_items.at( i );
+      items.append( item );
+    }
+  }
+
+  return items;
+}
 
-      if( treeItem->toString() == nodeText )
+/*--------------------------------------------------------------------------------------*/
+
+int GCDomTreeWidget::itemPositionRelativeToIdenticalSiblings( const QString& nodeText, int itemIndex ) const
+{
+  if( m_isEmpty )
+  {
+    return -1;
+  }
+
+  /* Indices are a rough indication of an element's position in the DOM (they are assigned in
+    document order), which means that all we have to do is count the elements identical to the
+    selected one (same name, attributes, values, etc) that precede it.  Identical items share
+    a content hash, so only those have to be compared. */
+  int position = 0;
+  bool found = false;
+
+  foreach( GCTreeWidgetItem* item, m_itemsByHash.values( GCTreeWidgetItem::contentHash( nodeText ) ) )
+  {
+    if( item->toString() == nodeText )
+    {
+      if( item->index() < itemIndex )
+      {
+        ++position;
+      }
+      else if( item->index() == itemIndex )
       {
-        indices.append( treeItem->index() );
+        found = true;
       }
     }
   }
 
-  /* Now that we have a list of all the indices matching identical nodes (indices are a rough
-    indication of an element's position in the DOM and closely matches the "line numbers" of the
-    items in the tree widget), we can determine the position of the selected DOM element relative
-    to its doppelgangers. */
-  qSort( indices.begin(), indices.end() );
+  if( !found )
+  {
+    return -1;
+  }
+
+  /* Elements that don't have items yet aren't in the lookup table and have to be checked
+    individually (by hash, the strings are only built for elements that could match). */
+  quint64 hash = GCTreeWidgetItem::contentHash( nodeText );
+  QHash< GCTreeWidgetItem*, int >::const_iterator iterator = m_unfetchedItems.constBegin();
+
+  for( ; iterator != m_unfetchedItems.constEnd(); ++iterator )
+  {
+    if( iterator.key()->index() < itemIndex )
+    {
+      position += matchingDescendantCount( iterator.key()->element(), nodeText, hash );
+    }
+  }
+
+  return position;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCDomTreeWidget::updateItemHash( GCTreeWidgetItem* item )
+{
+  if( m_itemHashes.contains( item ) )
+  {
+    m_itemsByHash.remove( m_itemHashes.value( item ), item );
 
-  return indices.indexOf( itemIndex );
+    quint64 hash = item->contentHash();
+    m_itemsByHash.insert( hash, item );
+    m_itemHashes.insert( item, hash );
+  }
 }
 
 /*--------------------------------------------------------------------------------------*/
@@ -284,30 +378,30 @@ bool GCDomTreeWidget::matchesRootName( const QString& elementName ) const
 
 /*--------------------------------------------------------------------------------------*/
 
-bool GCDomTreeWidget::documentCompatible() const
-{
-  return GCDataBaseInterface::instance()->isDocumentCompatible( m_domDoc );
-}
-
-/*--------------------------------------------------------------------------------------*/
-
-bool GCDomTreeWidget::batchProcessSuccess() const
-{
-  return GCDataBaseInterface::instance()->batchProcessDomDocument( m_domDoc );
-}
-
-/*--------------------------------------------------------------------------------------*/
-
 void GCDomTreeWidget::updateItemNames( const QString& oldName, const QString& newName )
 {
-  for( int i = 0; i < m_items.size(); ++i )
+  foreach( GCTreeWidgetItem* item, m_itemsByNode )
   {
-    if( m_items.at( i )->name() == oldName )
+    if( item->name() == oldName )
     {
-      GCTreeWidgetItem* item = const_cast< GCTreeWidgetItem* >( m_items.at( i ) );
       item->rename( newName );
     }
   }
+
+  /* Elements that don't have items yet are renamed directly (the node list is "live", so
+    we need to take a copy of the elements before changing any of their names). */
+  QDomNodeList nodes = m_domDoc->elementsByTagName( oldName );
+  QList< QDomElement > elements;
+
+  for( int i = 0; i < nodes.size(); ++i )
+  {
+    elements.append( nodes.at( i ).toElement() );
+  }
+
+  foreach( QDomElement element, elements )
+  {
+    element.setTagName( newName );
+  }
 }
 
 /*--------------------------------------------------------------------------------------*/
@@ -315,15 +409,20 @@ void GCDomTreeWidget::updateItemNames( const QString& oldName, const QString& ne
 void GCDomTreeWidget::rebuildTreeWidget()
 {
   clear();    // ONLY whack the tree widget items.
-  m_items.clear();
-
-  /* Set the document root as the first item in the tree. */
-  GCTreeWidgetItem* item = new GCTreeWidgetItem( m_domDoc->documentElement(), m_items.size() );
+  m_itemsByNode.clear();
+  m_itemsByIndex.clear();
+  m_itemsByHash.clear();
+  m_itemHashes.clear();
+  m_unfetchedItems.clear();
+  m_descendantCounts.clear();
+
+  /* Set the document root as the first item in the tree (only the root's children are
+    created here, the rest is created as and when needed). */
+  GCTreeWidgetItem* item = createItem( m_domDoc->documentElement(), 0 );
   invisibleRootItem()->addChild( item );  // takes ownership
-  m_items.append( item );
   m_isEmpty = false;
 
-  processElement( item, item->element().firstChildElement() );
+  fetchChildren( item );
 
   m_comments.clear();
   populateCommentList( m_domDoc->documentElement() );
@@ -335,10 +434,12 @@ void GCDomTreeWidget::rebuildTreeWidget()
 
 void GCDomTreeWidget::appendSnippet( GCTreeWidgetItem* parentItem, QDomElement childElement )
 {
+  /* The snippet's item must be added after the parent's existing children. */
+  fetchChildren( parentItem );
   parentItem->element().appendChild( childElement );
   processElement( parentItem, childElement );
   populateCommentList( childElement );
-  updateIndices();
+  updateIndices( parentItem->gcChild( parentItem->childCount() - 1 ), false, parentItem->childCount() - 1 );
   emitGcCurrentItemSelected( currentItem(), 0 );
 }
 
@@ -349,47 +450,51 @@ void GCDomTreeWidget::replaceItemsWithComment( const QList< int >& indices, cons
   QList< GCTreeWidgetItem* > itemsToDelete;
   GCTreeWidgetItem* commentParentItem = NULL;
 
-  for( int i = 0; i < m_items.size(); ++i )
+  /* Find all the items before removing any of them (the lookup relies on the indices, and
+    these are only updated once we're done). */
+  for( int j = 0; j < indices.size(); ++j )
   {
-    GCTreeWidgetItem* item = m_items.at( i );
+    GCTreeWidgetItem* item = gcItemFromIndex( indices.at( j ) );
 
-    for( int j = 0; j < indices.size(); ++j )
+    if( item )
     {
-      if( item->index() == indices.at( j ) )
+      /* This works because the indices are always sorted from small to big, i.e.
+        the item corresponding to the lowest index in indices will be the furthest up
+        the node hierarchy. */
+      if( j == 0 && item->gcParent() )
       {
-        /* This works because the indices are always sorted from small to big, i.e.
-          the item corresponding to the lowest index in indices will be the furthest up
-          the node hierarchy. */
-        if( j == 0 && item->gcParent() )
-        {
-          commentParentItem = item->gcParent();
-        }
+        commentParentItem = item->gcParent();
+      }
 
-        /* Remove the element from the DOM first. */
-        QDomNode parentNode = item->element().parentNode();
-        parentNode.removeChild( item->element() );
+      itemsToDelete.append( item );
+    }
+  }
 
-        /* Now whack it. */
-        if( item->gcParent() )
-        {
-          GCTreeWidgetItem* parentItem = item->gcParent();
-          parentItem->removeChild( item );
-        }
-        else
-        {
-          invisibleRootItem()->removeChild( item );
-        }
+  /* The item preceding the first one to be removed is the last one that keeps its index. */
+  GCTreeWidgetItem* lastUnaffectedItem = itemsToDelete.isEmpty() ? NULL : previousItem( itemsToDelete.first() );
 
-        /* Removing an item from another's child list does not delete it. */
-        itemsToDelete.append( item );
-      }
+  foreach( GCTreeWidgetItem* item, itemsToDelete )
+  {
+    /* Remove the element from the DOM first. */
+    QDomNode parentNode = item->element().parentNode();
+    parentNode.removeChild( item->element() );
+
+    /* Now whack it. */
+    if( item->gcParent() )
+    {
+      GCTreeWidgetItem* parentItem = item->gcParent();
+      parentItem->removeChild( item );
+    }
+    else
+    {
+      invisibleRootItem()->removeChild( item );
     }
   }
 
-  /* Delete the items here so that we may be sure that they are actually removed
-    from the items list as well (deleting items in the loop above resulted in parent
-    items deleting all their children, but obviously not updating the items list in
-    the process). */
+  /* Removing an item from another's child list does not delete it.  Delete the items here
+    so that we may be sure that they are actually removed from the lookup tables as well
+    (deleting items in the loop above resulted in parent items deleting all their children,
+    but obviously not updating the lookup tables in the process). */
   for( int i = 0; i < itemsToDelete.size(); ++ i )
   {
     GCTreeWidgetItem* item = itemsToDelete.at( i );
@@ -412,8 +517,8 @@ void GCDomTreeWidget::replaceItemsWithComment( const QList< int >& indices, cons
   }
 
   m_comments.append( newComment );
-  m_isEmpty = m_items.isEmpty();
-  updateIndices();
+  m_isEmpty = m_itemsByNode.isEmpty();
+  updateIndices( nextItem( lastUnaffectedItem ) );
 }
 
 /*--------------------------------------------------------------------------------------*/
@@ -424,15 +529,119 @@ void GCDomTreeWidget::processElement( GCTreeWidgetItem* parentItem, QDomElement
   {
     while( !element.isNull() )
     {
-      GCTreeWidgetItem* item = new GCTreeWidgetItem( element, m_items.size() );
+      GCTreeWidgetItem* item = createItem( element, -1 );
       parentItem->addChild( item );  // takes ownership
-      m_items.append( item );
 
-      processElement( item, element.firstChildElement() );
+      /* The new item follows whatever precedes it in the tree. */
+      setItemIndex( item, indexFollowing( previousItem( item, parentItem->childCount() - 1 ) ) );
       element = element.nextSiblingElement();
     }
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+GCTreeWidgetItem* GCDomTreeWidget::createItem( QDomElement element, int index )
+{
+  GCTreeWidgetItem* item = new GCTreeWidgetItem( element, index );
+  m_itemsByNode.insert( element, item );
+  m_itemsByHash.insert( item->contentHash(), item );
+  m_itemHashes.insert( item, item->contentHash() );
+
+  if( index >= 0 )
+  {
+    m_itemsByIndex.insert( index, item );
+  }
+
+  /* The item's children are only created when they are needed (see "fetchChildren"), but we
+    want the user to know that they are there. */
+  if( !element.firstChildElement().isNull() )
+  {
+    item->setChildIndicatorPolicy( QTreeWidgetItem::ShowIndicator );
+    m_unfetchedItems.insert( item, descendantCount( element ) );
+  }
+
+  return item;
+}
 
-    qApp->processEvents( QEventLoop::ExcludeUserInputEvents );
+/*--------------------------------------------------------------------------------------*/
+
+void GCDomTreeWidget::setItemIndex( GCTreeWidgetItem* item, int index )
+{
+  /* The item's previous index may already have been claimed by another item. */
+  if( m_itemsByIndex.value( item->index() ) == item )
+  {
+    m_itemsByIndex.remove( item->index() );
+  }
+
+  item->setIndex( index );
+  m_itemsByIndex.insert( index, item );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCDomTreeWidget::fetchChildren( QTreeWidgetItem* item )
+{
+  GCTreeWidgetItem* parentItem = dynamic_cast< GCTreeWidgetItem* >( item );
+
+  if( !parentItem ||
+      !m_unfetchedItems.remove( parentItem ) )
+  {
+    return;
+  }
+
+  /* Items may have been moved onto the parent before it was ever expanded, we don't want
+    to create these a second time, but they do have to be moved to their DOM positions. */
+  QList< QTreeWidgetItem* > existingItems = parentItem->takeChildren();
+  QDomElement element = parentItem->element().firstChildElement();
+  int index = parentItem->index() + 1;
+
+  while( !element.isNull() )
+  {
+    GCTreeWidgetItem* childItem = NULL;
+
+    for( int i = 0; i < existingItems.size(); ++i )
+    {
+      GCTreeWidgetItem* existingItem = dynamic_cast< GCTreeWidgetItem* >( existingItems.at( i ) );
+
+      if( existingItem->element() == element )
+      {
+        childItem = existingItem;
+        existingItems.removeAt( i );
+        break;
+      }
+    }
+
+    if( !childItem )
+    {
+      childItem = createItem( element, index );
+      index += m_unfetchedItems.value( childItem, 0 ) + 1;
+    }
+    else
+    {
+      index += descendantCount( element ) + 1;
+    }
+
+    parentItem->addChild( childItem );  // takes ownership
+
+    element = element.nextSiblingElement();
+  }
+
+  /* Whatever is left over (excluded elements) no longer has a DOM position. */
+  parentItem->addChildren( existingItems );
+  parentItem->setChildIndicatorPolicy( QTreeWidgetItem::DontShowIndicatorWhenChildless );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCDomTreeWidget::fetchAll()
+{
+  /* Fetching an item's children adds those children that have children of their own.  Events
+    aren't processed in between, anything re-entering the widget would otherwise find the lookup
+    tables only partly filled. */
+  while( !m_unfetchedItems.isEmpty() )
+  {
+    fetchChildren( m_unfetchedItems.begin().key() );
   }
 }
 
@@ -517,10 +726,12 @@ void GCDomTreeWidget::addItem( const QString& element, bool toParent )
   {
     if( toParent )
     {
-      insertItem( element, m_activeItem->parent()->indexOfChild( m_activeItem ), toParent );
+      insertItem( element, childPosition( m_activeItem ), toParent );
     }
     else
     {
+      /* The new item is added after the active item's existing children. */
+      fetchChildren( m_activeItem );
       insertItem( element, m_activeItem->childCount() - 1, toParent );
     }
   }
@@ -545,19 +756,21 @@ void GCDomTreeWidget::insertItem( const QString& elementName, int index, bool to
     element.setAttribute( attributeNames.at( i ), "" );
   }
 
-  GCTreeWidgetItem* item = new GCTreeWidgetItem( element, m_items.size() );
-  m_items.append( item );
+  GCTreeWidgetItem* item = createItem( element, -1 );
+  int position = index + 1;
 
   if( m_isEmpty )
   {
     invisibleRootItem()->addChild( item );  // takes ownership
     m_domDoc->appendChild( element );
     m_isEmpty = false;
+    position = 0;
   }
   else
   {
     if( !toParent )
     {
+      fetchChildren( m_activeItem );
       m_activeItem->insertGcChild( index, item );
     }
     else
@@ -566,10 +779,9 @@ void GCDomTreeWidget::insertItem( const QString& elementName, int index, bool to
     }
   }
 
-  /* I will have to rethink this approach if it turns out that it is too expensive to
-    iterate through the tree on each and every addition...for now, this is the easiest
-    solution, even if not the best. */
-  updateIndices();
+  /* Only the new item and those following it in document order are affected ("insertGcChild"
+    inserts the item after the one at "index"). */
+  updateIndices( item, false, position );
 
   setCurrentItem( item );
 }
@@ -579,19 +791,24 @@ void GCDomTreeWidget::insertItem( const QString& elementName, int index, bool to
 void GCDomTreeWidget::setCurrentItemFromIndex( int index )
 {
   index = ( index < 0 ) ? 0 : index;
+  GCTreeWidgetItem* item = gcItemFromIndex( index );
 
-  for( int i = 0; i < m_items.size(); ++i )
+  if( item )
   {
-    if( m_items.at( i )->index() == index )
-    {
-      emitGcCurrentItemSelected( m_items.at( i ), 0 );
-      break;
-    }
+    emitGcCurrentItemSelected( item, 0 );
   }
 }
 
 /*--------------------------------------------------------------------------------------*/
 
+void GCDomTreeWidget::expandAll()
+{
+  fetchAll();
+  QTreeWidget::expandAll();
+}
+
+/*--------------------------------------------------------------------------------------*/
+
 void GCDomTreeWidget::setAllCheckStates( Qt::CheckState state )
 {
   m_busyIterating = true;
@@ -627,19 +844,69 @@ void GCDomTreeWidget::setShowTreeItemsVerbose( bool verbose )
 
 /*--------------------------------------------------------------------------------------*/
 
-void GCDomTreeWidget::updateIndices()
+void GCDomTreeWidget::updateIndices( GCTreeWidgetItem* from, bool untilUnchanged, int position )
 {
+  if( !from )
+  {
+    return;
+  }
+
   m_busyIterating = true;
 
-  QTreeWidgetItemIterator iterator( this );
-  int index = 0;
+  /* Keep track of the positions of the current item and its ancestors within their parents so
+    that we don't have to search the parents' child lists when moving on to the next sibling. */
+  QList< int > positions;
+  positions.append( ( position < 0 ) ? childPosition( from ) : position );
 
-  while( *iterator )
+  for( GCTreeWidgetItem* ancestor = from->gcParent(); ancestor; ancestor = ancestor->gcParent() )
   {
-    GCTreeWidgetItem* treeItem = dynamic_cast< GCTreeWidgetItem* >( *iterator );
-    treeItem->setIndex( index );
+    positions.prepend( childPosition( ancestor ) );
+  }
+
+  QTreeWidgetItem* item = from;
+  int index = indexFollowing( previousItem( from, positions.last() ) );
+
+  while( item )
+  {
+    GCTreeWidgetItem* treeItem = dynamic_cast< GCTreeWidgetItem* >( item );
+
+    /* When items are moved around, everything beyond the affected range stays as it was. */
+    if( untilUnchanged &&
+        treeItem->index() == index )
+    {
+      break;
+    }
+
+    setItemIndex( treeItem, index );
     ++index;
-    ++iterator;
+
+    if( m_unfetchedItems.contains( treeItem ) )
+    {
+      /* Items that haven't been created yet still have indices reserved for them. */
+      index += m_unfetchedItems.value( treeItem );
+    }
+    else if( item->childCount() > 0 )
+    {
+      item = item->child( 0 );
+      positions.append( 0 );
+      continue;
+    }
+
+    /* Move on to the next sibling, or to that of the closest ancestor that has one. */
+    while( item )
+    {
+      QTreeWidgetItem* parent = item->parent() ? item->parent() : invisibleRootItem();
+      int position = positions.takeLast() + 1;
+
+      if( position < parent->childCount() )
+      {
+        item = parent->child( position );
+        positions.append( position );
+        break;
+      }
+
+      item = item->parent();
+    }
   }
 
   m_busyIterating = false;
@@ -647,23 +914,236 @@ void GCDomTreeWidget::updateIndices()
 
 /*--------------------------------------------------------------------------------------*/
 
-GCTreeWidgetItem* GCDomTreeWidget::gcItemFromNode( QDomNode element )
+int GCDomTreeWidget::indexFollowing( GCTreeWidgetItem* item ) const
+{
+  if( item )
+  {
+    return item->index() + m_unfetchedItems.value( item, 0 ) + 1;
+  }
+
+  return 0;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+GCTreeWidgetItem* GCDomTreeWidget::previousItem( GCTreeWidgetItem* item, int position ) const
 {
-  GCTreeWidgetItem* parentItem = NULL;
+  QTreeWidgetItem* parent = item->parent() ? item->parent() : invisibleRootItem();
 
-  if( !element.isNull() )
+  if( position < 0 )
+  {
+    position = childPosition( item );
+  }
+
+  if( position <= 0 )
+  {
+    return item->gcParent();
+  }
+
+  /* The previous sibling's last descendant (if it has any). */
+  GCTreeWidgetItem* previous = dynamic_cast< GCTreeWidgetItem* >( parent->child( position - 1 ) );
+
+  while( !m_unfetchedItems.contains( previous ) &&
+         previous->childCount() > 0 )
+  {
+    previous = previous->gcChild( previous->childCount() - 1 );
+  }
+
+  return previous;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+GCTreeWidgetItem* GCDomTreeWidget::nextItem( GCTreeWidgetItem* item, bool skipChildren ) const
+{
+  if( !item )
+  {
+    return dynamic_cast< GCTreeWidgetItem* >( topLevelItem( 0 ) );
+  }
+
+  if( !skipChildren &&
+      !m_unfetchedItems.contains( item ) &&
+      item->childCount() > 0 )
+  {
+    return item->gcChild( 0 );
+  }
+
+  while( item )
+  {
+    QTreeWidgetItem* parent = item->parent() ? item->parent() : invisibleRootItem();
+    int position = childPosition( item ) + 1;
+
+    if( position < parent->childCount() )
+    {
+      return dynamic_cast< GCTreeWidgetItem* >( parent->child( position ) );
+    }
+
+    item = item->gcParent();
+  }
+
+  return NULL;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+GCTreeWidgetItem* GCDomTreeWidget::gcItemFromIndex( int index )
+{
+  if( m_itemsByIndex.contains( index ) )
+  {
+    return m_itemsByIndex.value( index );
+  }
+
+  /* If we get here, the item hasn't been created yet.  Since indices increase in document order, the item we're looking for is either the last
+    item (at each level) with an index smaller than or equal to "index", or one of its descendants. */
+  GCTreeWidgetItem* item = childFromIndex( invisibleRootItem(), index );
+
+  while( item &&
+         item->index() != index )
+  {
+    fetchChildren( item );
+    item = childFromIndex( item, index );
+  }
+
+  return item;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+GCTreeWidgetItem* GCDomTreeWidget::childFromIndex( QTreeWidgetItem* parent, int index, int* position )
+{
+  GCTreeWidgetItem* child = NULL;
+  int low = 0;
+  int high = parent->childCount() - 1;
+
+  /* The children's indices are in ascending order. */
+  while( low <= high )
   {
-    for( int i = 0; i < m_items.size(); ++i )
+    int middle = ( low + high ) / 2;
+    GCTreeWidgetItem* candidate = dynamic_cast< GCTreeWidgetItem* >( parent->child( middle ) );
+
+    if( candidate->index() <= index )
     {
-      if( m_items.at( i )->element() == element )
+      child = candidate;
+      low = middle + 1;
+
+      if( position )
       {
-        parentItem = m_items.at( i );
-        break;
+        *position = middle;
       }
     }
+    else
+    {
+      high = middle - 1;
+    }
+  }
+
+  return child;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+int GCDomTreeWidget::childPosition( GCTreeWidgetItem* item ) const
+{
+  QTreeWidgetItem* parent = item->parent() ? item->parent() : invisibleRootItem();
+  int position = -1;
+
+  /* Items that were only just added or moved don't have valid indices yet, in which case we
+    have no choice but to search the parent's child list. */
+  if( childFromIndex( parent, item->index(), &position ) != item )
+  {
+    position = parent->indexOfChild( item );
+  }
+
+  return position;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+GCTreeWidgetItem* GCDomTreeWidget::gcItemFromNode( QDomNode element )
+{
+  if( !element.isNull() )
+  {
+    return m_itemsByNode.value( element, NULL );
   }
 
-  return parentItem;
+  return NULL;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+int GCDomTreeWidget::descendantCount( const QDomElement& element )
+{
+  /* Elements below an item that has already been counted were counted along with it. */
+  if( m_descendantCounts.contains( element ) )
+  {
+    return m_descendantCounts.take( element );
+  }
+
+  return countDescendants( element );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+int GCDomTreeWidget::countDescendants( const QDomElement& element )
+{
+  int count = 0;
+  QDomElement childElement = element.firstChildElement();
+
+  while( !childElement.isNull() )
+  {
+    int childCount = countDescendants( childElement );
+
+    /* Keep the counts of the elements that have children of their own for when their items
+      are created (so that each element is only ever counted once). */
+    if( childCount > 0 )
+    {
+      m_descendantCounts.insert( childElement, childCount );
+    }
+
+    count += childCount + 1;
+    childElement = childElement.nextSiblingElement();
+  }
+
+  return count;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCDomTreeWidget::forgetDescendantCounts( const QDomElement& element )
+{
+  QDomElement childElement = element.firstChildElement();
+
+  while( !childElement.isNull() )
+  {
+    if( m_descendantCounts.remove( childElement ) > 0 )
+    {
+      forgetDescendantCounts( childElement );
+    }
+
+    childElement = childElement.nextSiblingElement();
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+int GCDomTreeWidget::matchingDescendantCount( const QDomElement& element, const QString& nodeText, quint64 hash )
+{
+  int count = 0;
+  QDomElement childElement = element.firstChildElement();
+
+  while( !childElement.isNull() )
+  {
+    if( GCTreeWidgetItem::contentHash( childElement ) == hash &&
+        GCTreeWidgetItem::toString( childElement ) == nodeText )
+    {
+      ++count;
+    }
+
+    count += matchingDescendantCount( childElement, nodeText, hash );
+    childElement = childElement.nextSiblingElement();
+  }
+
+  return count;
 }
 
 /*--------------------------------------------------------------------------------------*/
@@ -676,7 +1156,20 @@ void GCDomTreeWidget::removeFromList( GCTreeWidgetItem* item )
     removeFromList( childItem );
   }
 
-  m_items.removeAll( item );
+  m_itemsByNode.remove( item->element() );
+  m_itemsByHash.remove( m_itemHashes.take( item ), item );
+
+  /* The elements below an item that was never expanded may still have their counts cached. */
+  if( m_unfetchedItems.remove( item ) > 0 &&
+      !m_descendantCounts.isEmpty() )
+  {
+    forgetDescendantCounts( item->element() );
+  }
+
+  if( m_itemsByIndex.value( item->index() ) == item )
+  {
+    m_itemsByIndex.remove( item->index() );
+  }
 }
 
 /*--------------------------------------------------------------------------------------*/
@@ -703,6 +1196,11 @@ void GCDomTreeWidget::dropEvent( QDropEvent* event )
 {
   m_itemBeingManipulated = true;
 
+  /* Remember where the item came from so that we only have to update the indices of the
+    items that were affected by the move. */
+  GCTreeWidgetItem* followingItem = m_activeItem ? nextItem( m_activeItem, true ) : NULL;
+  int previousIndex = m_activeItem ? m_activeItem->index() : 0;
+
   QTreeWidget::dropEvent( event );
   DropIndicatorPosition indicatorPos = dropIndicatorPosition();
 
@@ -766,12 +1264,27 @@ void GCDomTreeWidget::dropEvent( QDropEvent* event )
 
       /* Update the database to reflect the re-parenting. */
       GCDataBaseInterface::instance()->updateElementChildren( parent->name(), QStringList( m_activeItem->name() ) );
+
+      /* If the item was dropped onto an item that was never expanded, the new parent's
+        other children must be created now. */
+      fetchChildren( parent );
     }
 
     expandItem( parent );
+
+    /* If the item was moved up, the first affected item is the item itself, otherwise it is
+      the one that followed it before the move. */
+    if( !followingItem ||
+        indexFollowing( previousItem( m_activeItem ) ) < previousIndex )
+    {
+      updateIndices( m_activeItem, true );
+    }
+    else
+    {
+      updateIndices( followingItem, true );
+    }
   }
 
-  updateIndices();
   emitGcCurrentItemChanged( m_activeItem, 0 );
   m_itemBeingManipulated = false;
 }
@@ -909,6 +1422,9 @@ void GCDomTreeWidget::removeItem()
       }
     }
 
+    /* The item preceding the one being removed is the last one that keeps its index. */
+    GCTreeWidgetItem* lastUnaffectedItem = previousItem( m_activeItem );
+
     /* Remove the element from the DOM first. */
     QDomNode parentNode = m_activeItem->element().parentNode();
     parentNode.removeChild( m_activeItem->element() );
@@ -925,12 +1441,12 @@ void GCDomTreeWidget::removeItem()
     }
 
     removeFromList( m_activeItem );
-    m_isEmpty = m_items.isEmpty();
+    m_isEmpty = m_itemsByNode.isEmpty();
 
     delete m_activeItem;
     m_activeItem = gcCurrentItem();
 
-    updateIndices();
+    updateIndices( nextItem( lastUnaffectedItem ) );
     emitGcCurrentItemChanged( m_activeItem, 0 );
     m_itemBeingManipulated = false;
   }
@@ -952,15 +1468,17 @@ void GCDomTreeWidget::stepUp()
 
       if( grandParent )
       {
+        int position = childPosition( parentItem );
         parentItem->removeChild( m_activeItem );
-        grandParent->insertChild( grandParent->indexOfChild( parentItem ), m_activeItem );
+        grandParent->insertChild( position, m_activeItem );
         grandParent->element().insertBefore( m_activeItem->element(), parentItem->element() );
 
         /* Update the database to reflect the re-parenting. */
         GCDataBaseInterface::instance()->updateElementChildren( grandParent->name(), QStringList( m_activeItem->name() ) );
       }
 
-      updateIndices();
+      /* The item moved up in the document so it is the first one affected. */
+      updateIndices( m_activeItem, true );
       emitGcCurrentItemChanged( m_activeItem, 0 );
     }
 
@@ -978,15 +1496,19 @@ void GCDomTreeWidget::stepDown()
 
     GCTreeWidgetItem* parentItem = m_activeItem->gcParent();
     GCTreeWidgetItem* siblingItem = gcItemFromNode( m_activeItem->element().previousSiblingElement() );
+    GCTreeWidgetItem* firstAffectedItem = m_activeItem;
 
-    /* Try again in the opposite direction. */
+    /* Try again in the opposite direction (in which case the sibling moves up in the document
+      and becomes the first item affected). */
     if( !siblingItem )
     {
       siblingItem = gcItemFromNode( m_activeItem->element().nextSiblingElement() );
+      firstAffectedItem = siblingItem;
     }
 
     if( siblingItem && parentItem )
     {
+      fetchChildren( siblingItem );
       parentItem->removeChild( m_activeItem );
       siblingItem->insertChild( 0, m_activeItem );
       siblingItem->element().insertBefore( m_activeItem->element(), siblingItem->element().firstChild() );
@@ -994,7 +1516,7 @@ void GCDomTreeWidget::stepDown()
       /* Update the database to reflect the re-parenting. */
       GCDataBaseInterface::instance()->updateElementChildren( siblingItem->name(), QStringList( m_activeItem->name() ) );
 
-      updateIndices();
+      updateIndices( firstAffectedItem, true );
       emitGcCurrentItemChanged( m_activeItem, 0 );
     }
 
@@ -1022,7 +1544,12 @@ void GCDomTreeWidget::clearAndReset()
 {
   clear();
   m_domDoc->clear();
-  m_items.clear();
+  m_itemsByNode.clear();
+  m_itemsByIndex.clear();
+  m_itemsByHash.clear();
+  m_itemHashes.clear();
+  m_unfetchedItems.clear();
+  m_descendantCounts.clear();
   m_isEmpty = true;
 }
 
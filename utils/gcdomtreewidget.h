@@ -31,12 +31,17 @@
 
 #include <QTreeWidget>
 #include <QDomComment>
+#include <QHash>
 
 class GCTreeWidgetItem;
 class QDomDocument;
 class QDomElement;
 class QDomNode;
 
+/*! Hashes DOM nodes on identity (i.e. all handles to the same node produce the same value)
+    so that nodes may be used as QHash keys. */
+uint qHash( const QDomNode& node );
+
 /// Specialist tree widget class consisting of GCTreeWidgetItems.
 
 /**
@@ -44,6 +49,16 @@ class QDomNode;
    on changes to the DOM, but also manages the DOM based on changes made to its items.  Perhaps
    a better way of describing this relationship is to say that this class is, in effect, a non-textual
    visual representation of a DOM document.
+
+   Items are created on demand: when a document is loaded, only the root item and its immediate
+   children are created and an item's own children are only created once it is expanded (or once
+   something needs to get hold of them).  Items whose children have not been created yet are kept
+   in a separate table (along with the number of elements below them) and show an expansion
+   indicator regardless.
+
+   Indices are only ever updated from the first item affected by a change onwards (and, when items
+   are moved around, only up to the last affected item), which means that building a document
+   element by element does not require a walk of the entire tree on each addition.
 */
 
 class GCDomTreeWidget : public QTreeWidget
@@ -60,19 +75,31 @@ public:
   GCTreeWidgetItem* gcCurrentItem() const;
 
   /*! Returns a list of all the included \sa GCTreeWidgetItems in the tree (i.e. all the
-      items that do not have their "exclude" flags set).
+      items that do not have their "exclude" flags set).  Any items that have not yet been
+      created will be created first.
       \sa allTreeWidgetItems */
-  QList< GCTreeWidgetItem* > includedTreeWidgetItems() const;
+  QList< GCTreeWidgetItem* > includedTreeWidgetItems();
 
-  /*! Returns a list of ALL the GCTreeWidgetItems currently in the tree.
+  /*! Returns a list of ALL the GCTreeWidgetItems in the tree (in document order).  Any items
+      that have not yet been created will be created first.
       \sa getIncludedTreeWidgetItems */
-  const QList< GCTreeWidgetItem* >& allTreeWidgetItems() const;
+  QList< GCTreeWidgetItem* > allTreeWidgetItems();
+
+  /*! Returns the items matching "nodeText" (looked up by content hash).  Any items that have
+      not yet been created will be created first.
+      \sa GCTreeWidgetItem::toString, GCTreeWidgetItem::contentHash */
+  QList< GCTreeWidgetItem* > identicalItems( const QString& nodeText );
 
   /*! Returns the position of "itemIndex" relative to that of ALL items matching "nodeText"
       (this is is not as odd as it sounds, it is possible that a DOM document may have
       multiple elements of the same name with matching attributes and attribute values). */
   int itemPositionRelativeToIdenticalSiblings( const QString& nodeText, int itemIndex ) const;
 
+  /*! Called by "item" whenever its content hash changes (i.e. when its element's name or
+      attributes change) in order to keep the identical item lookup table up to date.
+      \sa GCTreeWidgetItem::contentHash */
+  void updateItemHash( GCTreeWidgetItem* item );
+
   /*! Returns a deep copy of the underlying DOM document. */
   QDomNode cloneDocument() const;
 
@@ -113,12 +140,6 @@ public:
       \sa rootName */
   bool matchesRootName( const QString& elementName ) const;
 
-  /*! Returns true if the underlying DOM document is compatible with the active DB session. */
-  bool documentCompatible() const;
-
-  /*! Returns true if batch processing of DOM content to the active DB was successful. */
-  bool batchProcessSuccess() const;
-
   /*! Rebuild the tree to conform to updated DOM content.
       \sa processNextElement */
   void rebuildTreeWidget();
@@ -178,6 +199,10 @@ public slots:
       comment nodes). */
   void setCurrentItemFromIndex( int index );
 
+  /*! Hides QTreeView::expandAll in order to create all outstanding items before the
+      tree is expanded. */
+  void expandAll();
+
 signals:
   /*! Emitted when the current active item changes.
       \sa emitGcCurrentItemSelected
@@ -237,14 +262,35 @@ private slots:
       \sa expand */
   void collapse();
 
+  /*! Connected to "itemExpanded". Creates the child items of "item" if these haven't been
+      created yet (items that already exist, e.g. those dropped onto an item that was never
+      expanded, are kept and moved to their DOM positions).
+      \sa fetchAll */
+  void fetchChildren( QTreeWidgetItem* item );
+
 private:
-  /*! Creates a new GCTreeWidgetItem item with corresponding "element" and adds it
-      as a child to "parentItem".
+  /*! Creates new GCTreeWidgetItem items for "element" and all its next siblings and adds them
+      as children to "parentItem" (the new items' own children are only created when needed).
+      Updating the indices of the items following the new ones is left to the caller.
       \sa setContent
       \sa appendSnippet
-      \sa rebuildTreeWidget */
+      \sa fetchChildren */
   void processElement( GCTreeWidgetItem* parentItem, QDomElement element );
 
+  /*! Creates a new GCTreeWidgetItem with corresponding "element" and "index", adds it to the
+      lookup tables and marks it as unfetched if "element" has child elements.  Items created
+      with a negative index are only added to the index table once they are assigned an index.
+      \sa fetchChildren
+      \sa setItemIndex */
+  GCTreeWidgetItem* createItem( QDomElement element, int index );
+
+  /*! Sets the index of "item" to "index" and updates the index lookup table accordingly. */
+  void setItemIndex( GCTreeWidgetItem* item, int index );
+
+  /*! Creates all the items that have not yet been created.
+      \sa fetchChildren */
+  void fetchAll();
+
   /*! Processes individual elements.  This function is called recursively from within
       "populateFromDatabase", creating a representative tree widget item (and corresponding
       DOM element) named "element" and adding it (the item) to the correct parent.
@@ -259,15 +305,75 @@ private:
   /*! Populates the comments list with all the comment nodes in the document. */
   void populateCommentList( QDomNode node );
 
-  /*! Iterates through the tree and updates all items' indices (useful when new items
-      are added or items removed) to ensure that indices correspond roughly to "row numbers"
-      in the accompanying plain text representation of the document's content. */
-  void updateIndices();
-
-  /*! Finds and returns the GCTreeWidget item that is linked to "element". */
+  /*! Updates the indices of "from" and all the items following it in document order (useful
+      when new items are added or items removed) to ensure that indices correspond roughly to
+      "row numbers" in the accompanying plain text representation of the document's content.
+      If "untilUnchanged" is true, the update stops at the first item whose index is already
+      correct (only safe when items were moved rather than added or removed, in which case
+      "from" must be the earliest item affected by the move).  Callers that know "from's"
+      position within its parent can pass it as "position" to save a search of the child list.
+      Every created item after "from" is renumbered (bar the "untilUnchanged" case), so this
+      remains linear in the number of items following the edit.
+      \sa indexFollowing */
+  void updateIndices( GCTreeWidgetItem* from, bool untilUnchanged = false, int position = -1 );
+
+  /*! Returns the index of whichever item follows "item" and its hierarchy in document order
+      (0 if "item" is NULL).
+      \sa updateIndices */
+  int indexFollowing( GCTreeWidgetItem* item ) const;
+
+  /*! Returns the item preceding "item" in document order (or NULL if "item" is the first one).
+      "position" is "item's" position within its parent, if known.
+      \sa nextItem */
+  GCTreeWidgetItem* previousItem( GCTreeWidgetItem* item, int position = -1 ) const;
+
+  /*! Returns the item following "item" in document order (or NULL if "item" is the last one).
+      If "item" is NULL, the first item in the tree is returned. If "skipChildren" is true,
+      the item following "item's" hierarchy is returned instead.
+      \sa previousItem */
+  GCTreeWidgetItem* nextItem( GCTreeWidgetItem* item, bool skipChildren = false ) const;
+
+  /*! Finds and returns the item with index matching "index".  If the item hasn't been created
+      yet, it is created (along with the items on the way there).  Returns NULL if no such
+      item exists. */
+  GCTreeWidgetItem* gcItemFromIndex( int index );
+
+  /*! Returns the last of "parent's" children with an index smaller than or equal to "index"
+      (or NULL if there is no such child).  If "position" is provided, it is set to the returned
+      child's position within "parent". */
+  static GCTreeWidgetItem* childFromIndex( QTreeWidgetItem* parent, int index, int* position = NULL );
+
+  /*! Returns "item's" position within its parent.  Sibling indices are in ascending order, so
+      this is a binary search unless "item's" own index is out of date (in which case the
+      parent's child list is searched).
+      \sa childFromIndex */
+  int childPosition( GCTreeWidgetItem* item ) const;
+
+  /*! Returns the number of elements in the hierarchy below "element".  The count is taken
+      from the cache if "element" was counted as part of an ancestor's hierarchy.
+      \sa countDescendants */
+  int descendantCount( const QDomElement& element );
+
+  /*! Counts the elements in the hierarchy below "element" and caches the counts of all the
+      descendants that have children of their own.
+      \sa descendantCount */
+  int countDescendants( const QDomElement& element );
+
+  /*! Removes the cached counts of all the elements in the hierarchy below "element".
+      \sa countDescendants */
+  void forgetDescendantCounts( const QDomElement& element );
+
+  /*! Returns the number of elements in the hierarchy below "element" with a string
+      representation matching "nodeText" ("hash" is the content hash of "nodeText", only
+      elements with the same hash are compared as strings).
+      \sa GCTreeWidgetItem::toString, GCTreeWidgetItem::contentHash */
+  static int matchingDescendantCount( const QDomElement& element, const QString& nodeText, quint64 hash );
+
+  /*! Returns the GCTreeWidget item that is linked to "element" (or NULL if "element"
+      does not have an item). */
   GCTreeWidgetItem* gcItemFromNode( QDomNode element );
 
-  /*! Recursively removes item and its children from the internal GCTreeWidgetItem list. */
+  /*! Recursively removes item and its children from the internal lookup tables. */
   void removeFromList( GCTreeWidgetItem* item );
 
   GCTreeWidgetItem* m_activeItem;
@@ -277,7 +383,12 @@ private:
   bool m_busyIterating;
   bool m_itemBeingManipulated;
 
-  QList< GCTreeWidgetItem* > m_items;
+  QHash< QDomNode, GCTreeWidgetItem* > m_itemsByNode;
+  QHash< int /*index*/, GCTreeWidgetItem* > m_itemsByIndex;
+  QMultiHash< quint64 /*content hash*/, GCTreeWidgetItem* > m_itemsByHash;
+  QHash< GCTreeWidgetItem*, quint64 /*content hash*/ > m_itemHashes;
+  QHash< GCTreeWidgetItem*, int /*descendants*/ > m_unfetchedItems;
+  QHash< QDomNode, int /*descendants*/ > m_descendantCounts;
   QList< QDomComment > m_comments;
 };
 
@@ -43,6 +43,8 @@ namespace GCGlobalSpace
     const QString STATE = "windowState";
     const QString USE_DARK = "useDarkTheme";
     const QString SAVE_WINDOW = "saveWindowInformation";
+    const QString DB_TUNING = "databaseTuning";
+    const QString PATH_AWARE = "usePathAwareProfiles";
   }
 
   /*--------------------------------------------------------------------------------------*/
@@ -173,6 +175,108 @@ namespace GCGlobalSpace
     QSettings settings( GCGlobalSpace::ORGANISATION, GCGlobalSpace::APPLICATION );
     settings.setValue( SAVE_WINDOW, use );
   }
+
+  /*--------------------------------------------------------------------------------------*/
+
+  DatabaseTuning databaseTuning()
+  {
+    QSettings settings( GCGlobalSpace::ORGANISATION, GCGlobalSpace::APPLICATION );
+    int tuning = settings.value( DB_TUNING, SafeTuning ).toInt();
+
+    /* Guard against hand-edited settings. */
+    if( tuning < SafeTuning || tuning > FastTuning )
+    {
+      return SafeTuning;
+    }
+
+    return static_cast< DatabaseTuning >( tuning );
+  }
+
+  /*--------------------------------------------------------------------------------------*/
+
+  void setDatabaseTuning( DatabaseTuning tuning )
+  {
+    QSettings settings( GCGlobalSpace::ORGANISATION, GCGlobalSpace::APPLICATION );
+    settings.setValue( DB_TUNING, static_cast< int >( tuning ) );
+  }
+
+  /*--------------------------------------------------------------------------------------*/
+
+  QString databaseJournalMode( DatabaseTuning tuning )
+  {
+    return ( tuning == SafeTuning ) ? "DELETE" : "WAL";
+  }
+
+  /*--------------------------------------------------------------------------------------*/
+
+  QString databaseSynchronous( DatabaseTuning tuning )
+  {
+    switch( tuning )
+    {
+      case SafeTuning:
+        return "FULL";
+      case BalancedTuning:
+        return "NORMAL";
+      case FastTuning:
+      default:
+        return "OFF";
+    }
+  }
+
+  /*--------------------------------------------------------------------------------------*/
+
+  qint64 databaseMmapSize( DatabaseTuning tuning )
+  {
+    switch( tuning )
+    {
+      case SafeTuning:
+        return 0;
+      case BalancedTuning:
+        return Q_INT64_C( 64 ) * 1024 * 1024;
+      case FastTuning:
+      default:
+        return Q_INT64_C( 256 ) * 1024 * 1024;
+    }
+  }
+
+  /*--------------------------------------------------------------------------------------*/
+
+  int databaseCacheSize( DatabaseTuning tuning )
+  {
+    switch( tuning )
+    {
+      case SafeTuning:
+        return 2000;    // SQLite's default
+      case BalancedTuning:
+        return 16384;
+      case FastTuning:
+      default:
+        return 65536;
+    }
+  }
+
+  /*--------------------------------------------------------------------------------------*/
+
+  bool databaseTempStoreInMemory( DatabaseTuning tuning )
+  {
+    return ( tuning != SafeTuning );
+  }
+
+  /*--------------------------------------------------------------------------------------*/
+
+  bool usePathAwareProfiles()
+  {
+    QSettings settings( GCGlobalSpace::ORGANISATION, GCGlobalSpace::APPLICATION );
+    return settings.value( PATH_AWARE, false ).toBool();
+  }
+
+  /*--------------------------------------------------------------------------------------*/
+
+  void setUsePathAwareProfiles( bool use )
+  {
+    QSettings settings( GCGlobalSpace::ORGANISATION, GCGlobalSpace::APPLICATION );
+    settings.setValue( PATH_AWARE, use );
+  }
 }
 
 /*--------------------------------------------------------------------------------------*/
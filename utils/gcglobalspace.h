@@ -39,11 +39,20 @@ namespace GCGlobalSpace
 {
   /*--------------------------------------------------------------------------------------*/
 
+#ifdef GC_TEST_SETTINGS
+  /*! Used when saving and loading settings to registry/XML/ini (tests keep their settings apart
+      from the user's). */
+  const QString ORGANISATION = "GoblinCoding Tests";
+
+  /*! Used when saving and loading settings to registry/XML/ini. */
+  const QString APPLICATION = "XML Mill Tests";
+#else
   /*! Used when saving and loading settings to registry/XML/ini. */
   const QString ORGANISATION = "GoblinCoding";
 
   /*! Used when saving and loading settings to registry/XML/ini. */
   const QString APPLICATION = "XML Mill";
+#endif
 
   /*--------------------------------------------------------------------------------------*/
 
@@ -102,6 +111,55 @@ namespace GCGlobalSpace
 
   /*--------------------------------------------------------------------------------------*/
 
+  /*! Determines how the SQLite connections to profile databases are tuned (applied whenever a
+      profile is opened, see GCDataBaseInterface). */
+  enum DatabaseTuning
+  {
+    SafeTuning,     /*!< SQLite defaults: rollback journal, full sync on every commit, small page cache. */
+    BalancedTuning, /*!< Write-ahead log with normal sync, larger page cache, memory mapped I/O and temporary
+                         tables in memory.  The database can't be corrupted, but the last commit may be lost
+                         if the machine loses power. */
+    FastTuning      /*!< As "balanced", but without syncing at all and with more memory.  Only recommended
+                         for profiles that can easily be rebuilt (e.g. on build servers). */
+  };
+
+  /*! Returns the tuning preset used for profile database connections ("safe" unless the user chose otherwise). */
+  DatabaseTuning databaseTuning();
+
+  /*! Saves the database tuning preset to the registry/ini/xml (takes effect the next time a profile is opened). */
+  void setDatabaseTuning( DatabaseTuning tuning );
+
+  /*! Returns the SQLite journal mode for "tuning" (e.g. "WAL"). */
+  QString databaseJournalMode( DatabaseTuning tuning );
+
+  /*! Returns the SQLite synchronous level for "tuning" (e.g. "NORMAL"). */
+  QString databaseSynchronous( DatabaseTuning tuning );
+
+  /*! Returns the maximum number of bytes of the database file that SQLite may memory map for "tuning". */
+  qint64 databaseMmapSize( DatabaseTuning tuning );
+
+  /*! Returns the SQLite page cache size for "tuning" (in KiB, i.e. SQLite's negative "cache_size" convention is
+      handled by GCDataBaseInterface). */
+  int databaseCacheSize( DatabaseTuning tuning );
+
+  /*! Returns "true" if temporary tables and indices should be kept in memory for "tuning". */
+  bool databaseTempStoreInMemory( DatabaseTuning tuning );
+
+  /*--------------------------------------------------------------------------------------*/
+
+  /*! The number of element names (the element itself and its closest ancestors) that make up a
+      profile context when path-aware profiles are used (see GCDataBaseInterface::contextDepth). */
+  const int PROFILE_CONTEXT_DEPTH = 3;
+
+  /*! Returns "true" if profiles should record (and suggest) children and attribute values per
+      element context rather than only per element name. */
+  bool usePathAwareProfiles();
+
+  /*! Saves the path-aware profile preference to the registry/ini/xml. */
+  void setUsePathAwareProfiles( bool use );
+
+  /*--------------------------------------------------------------------------------------*/
+
   /*! Default font for displaying XML content (directly or via table and tree views). */
   const QString FONT = "Courier New";
 
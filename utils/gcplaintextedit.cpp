@@ -60,6 +60,95 @@ void removeDuplicates( QList< int >& indices )
   }
 }
 
+/*--------------------------------------------------------------------------------------*/
+
+QList< QPair< int, int > > findStartTags( const QString& text )
+{
+  QList< QPair< int, int > > ranges;
+  int pos = text.indexOf( '<' );
+
+  while( pos >= 0 )
+  {
+    int end = -1;
+
+    if( text.midRef( pos, OPENCOMMENT.size() ) == OPENCOMMENT )
+    {
+      /* Elements that were commented out don't count. */
+      end = text.indexOf( CLOSECOMMENT, pos );
+      end = ( end < 0 ) ? end : end + CLOSECOMMENT.size();
+    }
+    else if( text.midRef( pos, 9 ) == QLatin1String( "<![CDATA[" ) )
+    {
+      end = text.indexOf( "]]>", pos );
+      end = ( end < 0 ) ? end : end + 3;
+    }
+    else if( text.midRef( pos, 2 ) == QLatin1String( "<?" ) )
+    {
+      end = text.indexOf( "?>", pos );
+      end = ( end < 0 ) ? end : end + 2;
+    }
+    else if( text.midRef( pos, 2 ) == QLatin1String( "<!" ) )
+    {
+      /* Document type declarations may have an internal subset (which may contain '>'). */
+      int subset = text.indexOf( '[', pos );
+      end = text.indexOf( '>', pos );
+
+      if( subset >= 0 && subset < end )
+      {
+        end = text.indexOf( '>', text.indexOf( ']', subset ) );
+      }
+
+      end = ( end < 0 ) ? end : end + 1;
+    }
+    else if( text.midRef( pos, 2 ) == QLatin1String( "</" ) )
+    {
+      end = text.indexOf( '>', pos );
+      end = ( end < 0 ) ? end : end + 1;
+    }
+    else
+    {
+      /* Element start tag, attribute values may contain '>'. */
+      QChar quote;
+
+      for( int i = pos + 1; i < text.size(); ++i )
+      {
+        QChar character = text.at( i );
+
+        if( quote.isNull() )
+        {
+          if( character == '"' || character == '\'' )
+          {
+            quote = character;
+          }
+          else if( character == '>' )
+          {
+            end = i + 1;
+            break;
+          }
+        }
+        else if( character == quote )
+        {
+          quote = QChar();
+        }
+      }
+
+      if( end >= 0 )
+      {
+        ranges.append( qMakePair( pos, end ) );
+      }
+    }
+
+    if( end < 0 )
+    {
+      break;
+    }
+
+    pos = text.indexOf( '<', end );
+  }
+
+  return ranges;
+}
+
 /*---------------------------------- MEMBER FUNCTIONS ----------------------------------*/
 
 GCPlainTextEdit::GCPlainTextEdit( QWidget* parent )
@@ -74,7 +163,8 @@ GCPlainTextEdit::GCPlainTextEdit( QWidget* parent )
   m_cursorPositionChanging( false ),
   m_cursorPositionChanged ( false ),
   m_mouseDragEntered      ( false ),
-  m_textEditClicked       ( false )
+  m_textEditClicked       ( false ),
+  m_elementRanges         ()
 {
   setAcceptDrops( false );
   setFont( QFont( GCGlobalSpace::FONT, GCGlobalSpace::FONTSIZE ) );
@@ -118,6 +208,10 @@ void GCPlainTextEdit::setContent( const QString& text )
   setPlainText( text );
   setUpdatesEnabled( true );
 
+  /* Knowing where each element is saves us from having to search for it whenever an element
+    is selected (which gets very slow for large documents with many identical elements). */
+  m_elementRanges = findStartTags( text );
+
   m_cursorPositionChanging = false;
 }
 
@@ -132,33 +226,11 @@ void GCPlainTextEdit::findTextRelativeToDuplicates( const QString& text, int rel
     */
   if( m_textEditClicked )
   {
-    m_savedBackground = textCursor().blockCharFormat().background();
-    m_savedForeground = textCursor().blockCharFormat().foreground();
-
-    QTextEdit::ExtraSelection extra;
-    extra.cursor = textCursor();
-    extra.format.setProperty( QTextFormat::FullWidthSelection, true );
-    extra.format.setBackground( QApplication::palette().highlight() );
-    extra.format.setForeground( QApplication::palette().highlightedText() );
-
-    QList< QTextEdit::ExtraSelection > extras;
-    extras << extra;
-    setExtraSelections( extras );
-    m_textEditClicked = false;
+    highlightClickedLine();
   }
   else
   {
-    /* Unset any previously set selections. */
-    QList< QTextEdit::ExtraSelection > extras = extraSelections();
-
-    for( int i = 0; i < extras.size(); ++i )
-    {
-      extras[ i ].format.setProperty( QTextFormat::FullWidthSelection, true );
-      extras[ i ].format.setBackground( m_savedBackground );
-      extras[ i ].format.setForeground( m_savedForeground );
-    }
-
-    setExtraSelections( extras );
+    resetHighlights();
 
     m_cursorPositionChanging = true;
 
@@ -175,10 +247,79 @@ void GCPlainTextEdit::findTextRelativeToDuplicates( const QString& text, int rel
 
 /*--------------------------------------------------------------------------------------*/
 
+bool GCPlainTextEdit::findElement( int index )
+{
+  if( index < 0 ||
+      index >= m_elementRanges.size() )
+  {
+    return false;
+  }
+
+  /* See "findTextRelativeToDuplicates". */
+  if( m_textEditClicked )
+  {
+    highlightClickedLine();
+  }
+  else
+  {
+    resetHighlights();
+
+    m_cursorPositionChanging = true;
+
+    QTextCursor cursor = textCursor();
+    cursor.setPosition( m_elementRanges.at( index ).first );
+    cursor.setPosition( m_elementRanges.at( index ).second, QTextCursor::KeepAnchor );
+    setTextCursor( cursor );
+    ensureCursorVisible();
+
+    m_cursorPositionChanging = false;
+  }
+
+  return true;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCPlainTextEdit::highlightClickedLine()
+{
+  m_savedBackground = textCursor().blockCharFormat().background();
+  m_savedForeground = textCursor().blockCharFormat().foreground();
+
+  QTextEdit::ExtraSelection extra;
+  extra.cursor = textCursor();
+  extra.format.setProperty( QTextFormat::FullWidthSelection, true );
+  extra.format.setBackground( QApplication::palette().highlight() );
+  extra.format.setForeground( QApplication::palette().highlightedText() );
+
+  QList< QTextEdit::ExtraSelection > extras;
+  extras << extra;
+  setExtraSelections( extras );
+  m_textEditClicked = false;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCPlainTextEdit::resetHighlights()
+{
+  QList< QTextEdit::ExtraSelection > extras = extraSelections();
+
+  for( int i = 0; i < extras.size(); ++i )
+  {
+    extras[ i ].format.setProperty( QTextFormat::FullWidthSelection, true );
+    extras[ i ].format.setBackground( m_savedBackground );
+    extras[ i ].format.setForeground( m_savedForeground );
+  }
+
+  setExtraSelections( extras );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
 void GCPlainTextEdit::clearAndReset()
 {
   m_cursorPositionChanging = true;
   clear();
+  m_elementRanges.clear();
   m_cursorPositionChanging = false;
 }
 
@@ -224,6 +365,7 @@ void GCPlainTextEdit::showContextMenu( const QPoint& point )
 void GCPlainTextEdit::commentOutSelection()
 {
   m_cursorPositionChanging = true;
+  m_elementRanges.clear();    // direct edits invalidate the element positions
 
   /* Capture the text before we make any changes. */
   QString comment = textCursor().selectedText();
@@ -279,6 +421,7 @@ void GCPlainTextEdit::commentOutSelection()
 void GCPlainTextEdit::uncommentSelection()
 {
   m_cursorPositionChanging = true;
+  m_elementRanges.clear();    // direct edits invalidate the element positions
 
   int selectionStart = textCursor().selectionStart();
   int selectionEnd = textCursor().selectionEnd();
@@ -321,6 +464,7 @@ void GCPlainTextEdit::uncommentSelection()
 void GCPlainTextEdit::deleteSelection()
 {
   m_cursorPositionChanging = true;
+  m_elementRanges.clear();    // direct edits invalidate the element positions
 
   textCursor().removeSelectedText();
 
@@ -337,6 +481,8 @@ void GCPlainTextEdit::deleteSelection()
 
 void GCPlainTextEdit::insertEmptyRow()
 {
+  m_elementRanges.clear();    // direct edits invalidate the element positions
+
   QTextCursor cursor = textCursor();
   cursor.movePosition( QTextCursor::EndOfBlock );
   cursor.insertBlock();
@@ -354,6 +500,7 @@ void GCPlainTextEdit::deleteEmptyRow()
     that is allowed). */
   if( block.text().remove( " " ).isEmpty() )
   {
+    m_elementRanges.clear();    // direct edits invalidate the element positions
     cursor.movePosition( QTextCursor::PreviousBlock );
     cursor.movePosition( QTextCursor::EndOfBlock );
     cursor.movePosition( QTextCursor::NextBlock, QTextCursor::KeepAnchor );
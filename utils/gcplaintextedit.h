@@ -31,6 +31,7 @@
 
 #include <QPlainTextEdit>
 #include <QTextBlock>
+#include <QPair>
 
 /// Specialist text edit class for displaying XML content in the XML Mill context.
 
@@ -47,14 +48,23 @@ public:
   explicit GCPlainTextEdit( QWidget* parent = 0 );
 
   /*! Use instead of "setPlainText" as it improves performance significantly (especially
-      for larger documents). */
+      for larger documents).  This also records the positions of all the element start
+      tags in "text" (see "findElement"). */
   void setContent( const QString& text );
 
   /*! Finds the "relativePos"'s occurrence of "text" within the active document (i.e if there
       are multiple occurrences of "text" within the document, we will find the "relativePos"
-      occurrence measured from the start of the document). */
+      occurrence measured from the start of the document).
+      \sa findElement */
   void findTextRelativeToDuplicates( const QString& text, int relativePos );
 
+  /*! Selects the start tag of the element at "index" (the element's position relative to the first
+      element in the document, excluding comments and other "non-active" XML).  Returns false if the
+      element's position isn't known (e.g. if the text was edited directly since it was last set),
+      in which case "findTextRelativeToDuplicates" must be used instead.
+      \sa setContent */
+  bool findElement( int index );
+
   /*! Resets the internal state of GCPlainTextEdit. */
   void clearAndReset();
 
@@ -131,6 +141,16 @@ private slots:
       element of the document, excluding comment blocks and other "non-active" XML. */
   int findIndexMatchingBlockNumber( QTextBlock block );
 
+  /*! Highlights the line the user clicked on (there is no need to find the text since we
+      already know where it is).
+      \sa findTextRelativeToDuplicates
+      \sa findElement */
+  void highlightClickedLine();
+
+  /*! Unsets any previously set highlights.
+      \sa highlightClickedLine */
+  void resetHighlights();
+
 private:
   QBrush m_savedBackground;
   QBrush m_savedForeground;
@@ -143,6 +163,8 @@ private:
   bool m_cursorPositionChanged;
   bool m_mouseDragEntered;
   bool m_textEditClicked;
+
+  QList< QPair< int /*start*/, int /*end*/ > > m_elementRanges;
 };
 
 #endif // GCPLAINTEXTEDIT_H
\ No newline at end of file
@@ -26,6 +26,7 @@
  *                    <http://www.gnu.org/licenses/>
  */
 #include "gctreewidgetitem.h"
+#include "gcdomtreewidget.h"
 #include "gcglobalspace.h"
 
 /*--------------------------------------------------------------------------------------*/
@@ -50,6 +51,8 @@ void GCTreeWidgetItem::init( QDomElement element, int index )
   m_elementExcluded = false;
   m_index = index;
   m_verbose = GCGlobalSpace::showTreeItemsVerbose();
+  m_contentHash = 0;
+  m_startTagDirty = true;
 
   QDomNamedNodeMap attributes = m_element.attributes();
 
@@ -131,6 +134,7 @@ void GCTreeWidgetItem::excludeAttribute( const QString& attribute )
   m_element.removeAttribute( attribute );
   m_includedAttributes.removeAll( attribute );
   m_includedAttributes.sort();
+  invalidateStartTag();
   setDisplayText();
 }
 
@@ -142,6 +146,7 @@ void GCTreeWidgetItem::includeAttribute( const QString& attribute, const QString
   m_includedAttributes.append( attribute );
   m_includedAttributes.removeDuplicates();
   m_includedAttributes.sort();
+  invalidateStartTag();
   setDisplayText();
 }
 
@@ -205,50 +210,41 @@ void GCTreeWidgetItem::revertToFixedValues()
   {
     m_element.setAttribute( attribute, m_fixedValues.value( attribute ) );
   }
+
+  invalidateStartTag();
 }
 
 /*--------------------------------------------------------------------------------------*/
 
 QString GCTreeWidgetItem::toString() const
 {
-  QString text( "<" );
-  text += m_element.tagName();
-
-  QDomNamedNodeMap attributes = m_element.attributes();
-
-  /* For elements with no attributes (e.g. <element/>). */
-  if( attributes.isEmpty() &&
-      m_element.childNodes().isEmpty() )
+  if( m_startTagDirty )
   {
-    text += "/>";
-    return text;
+    m_startTag = startTag( m_element );
+    m_contentHash = contentHash( m_startTag );
+    m_startTagDirty = false;
   }
 
-  if( !attributes.isEmpty() )
+  /* Whether or not the element has children can change without this item knowing about it,
+    so the closing bracket isn't cached. */
+  if( m_element.firstChild().isNull() )
   {
-    for( int i = 0; i < attributes.size(); ++i )
-    {
-      text += " ";
+    return m_startTag + "/>";
+  }
 
-      QString attribute = attributes.item( i ).toAttr().name();
-      text += attribute;
-      text += "=\"";
+  return m_startTag + ">";
+}
 
-      QString attributeValue = attributes.item( i ).toAttr().value();
-      text += attributeValue;
-      text += "\"";
-    }
+/*--------------------------------------------------------------------------------------*/
 
-    /* For elements without children but with attributes. */
-    if( m_element.firstChild().isNull() )
-    {
-      text += "/>";
-    }
-    else
-    {
-      /* For elements with children and attributes. */
-      text += ">";
-    }
+QString GCTreeWidgetItem::toString( const QDomElement& element )
+{
+  QString text = startTag( element );
+
+  /* For elements without children (e.g. <element/>). */
+  if( element.firstChild().isNull() )
+  {
+    text += "/>";
   }
   else
   {
@@ -260,6 +256,116 @@ QString GCTreeWidgetItem::toString() const
 
 /*--------------------------------------------------------------------------------------*/
 
+QString GCTreeWidgetItem::startTag( const QDomElement& element )
+{
+  QString text( "<" );
+  text += element.tagName();
+
+  QDomNamedNodeMap attributes = element.attributes();
+
+  for( int i = 0; i < attributes.size(); ++i )
+  {
+    text += " ";
+
+    QString attribute = attributes.item( i ).toAttr().name();
+    text += attribute;
+    text += "=\"";
+
+    QString attributeValue = attributes.item( i ).toAttr().value();
+    text += attributeValue;
+    text += "\"";
+  }
+
+  return text;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+quint64 GCTreeWidgetItem::contentHash() const
+{
+  if( m_startTagDirty )
+  {
+    toString();
+  }
+
+  return m_contentHash;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+quint64 GCTreeWidgetItem::contentHash( const QString& text )
+{
+  int length = text.size();
+
+  if( text.endsWith( "/>" ) )
+  {
+    length -= 2;
+  }
+  else if( text.endsWith( ">" ) )
+  {
+    length -= 1;
+  }
+
+  /* 64-bit FNV-1a. */
+  quint64 hash = Q_UINT64_C( 14695981039346656037 );
+  addToHash( hash, text, length );
+  return hash;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+quint64 GCTreeWidgetItem::contentHash( const QDomElement& element )
+{
+  /* Hashes the same characters as "startTag" would produce without building the string. */
+  quint64 hash = Q_UINT64_C( 14695981039346656037 );
+  addToHash( hash, "<" );
+  addToHash( hash, element.tagName() );
+
+  QDomNamedNodeMap attributes = element.attributes();
+
+  for( int i = 0; i < attributes.size(); ++i )
+  {
+    QDomAttr attribute = attributes.item( i ).toAttr();
+    addToHash( hash, " " );
+    addToHash( hash, attribute.name() );
+    addToHash( hash, "=\"" );
+    addToHash( hash, attribute.value() );
+    addToHash( hash, "\"" );
+  }
+
+  return hash;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCTreeWidgetItem::addToHash( quint64& hash, const QString& text, int length )
+{
+  length = ( length < 0 ) ? text.size() : length;
+
+  for( int i = 0; i < length; ++i )
+  {
+    hash ^= text.at( i ).unicode();
+    hash *= Q_UINT64_C( 1099511628211 );
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCTreeWidgetItem::invalidateStartTag()
+{
+  m_startTagDirty = true;
+
+  /* The tree keeps track of identical items by their content hashes. */
+  GCDomTreeWidget* tree = dynamic_cast< GCDomTreeWidget* >( treeWidget() );
+
+  if( tree )
+  {
+    tree->updateItemHash( this );
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
+
 void GCTreeWidgetItem::setIndex( int index )
 {
   m_index = index;
@@ -277,6 +383,7 @@ int GCTreeWidgetItem::index() const
 void GCTreeWidgetItem::rename( const QString& newName )
 {
   m_element.setTagName( newName );
+  invalidateStartTag();
   setDisplayText();
 }
 
@@ -294,6 +401,23 @@ QString GCTreeWidgetItem::name() const
 
 /*--------------------------------------------------------------------------------------*/
 
+QStringList GCTreeWidgetItem::namePath( int depth ) const
+{
+  QStringList path( name() );
+  GCTreeWidgetItem* ancestor = gcParent();
+
+  /* Only walk as far up the tree as we have to. */
+  while( ancestor && path.size() < depth )
+  {
+    path.prepend( ancestor->name() );
+    ancestor = ancestor->gcParent();
+  }
+
+  return path;
+}
+
+/*--------------------------------------------------------------------------------------*/
+
 void GCTreeWidgetItem::setVerbose( bool verbose )
 {
   m_verbose = verbose;
@@ -134,9 +134,27 @@ public:
   void revertToFixedValues();
 
   /*! Provides a string representation of the element, its attributes and attribute values (including brackets
-      and other XML characters). */
+      and other XML characters).  The representation is cached and only rebuilt after the element's name or
+      attributes were changed through this item.
+      \sa contentHash */
   QString toString() const;
 
+  /*! Provides the same string representation as the "toString" member for "element" (used for elements
+      that do not have items of their own). */
+  static QString toString( const QDomElement& element );
+
+  /*! Returns a 64-bit hash of the element's name, attributes and attribute values (identical elements
+      have identical hashes).
+      \sa toString */
+  quint64 contentHash() const;
+
+  /*! Returns the content hash matching "text", where "text" is a string representation as provided
+      by "toString" (whether or not the tag is closed does not affect the hash). */
+  static quint64 contentHash( const QString& text );
+
+  /*! Returns the content hash of "element" (used for elements that do not have items of their own). */
+  static quint64 contentHash( const QDomElement& element );
+
   /*! Sets the item's index to "index".
       \sa index */
   void setIndex( int index );
@@ -152,6 +170,11 @@ public:
   /*! Returns the element name. */
   QString name() const;
 
+  /*! Returns the element names of (at most) "depth" - 1 of this item's closest ancestors, outermost
+      first, followed by this item's own name (i.e. the list always contains at least the item's name).
+      \sa GCDataBaseInterface::contextChildren */
+  QStringList namePath( int depth ) const;
+
   /*! Sets the item's element display as "verbose". When "verbose", the entire node is displayed (element
       attributes and values), otherwise only the element name is displayed.
       \sa setDisplayText */
@@ -169,11 +192,29 @@ private:
       \sa setVerbose */
   void setDisplayText();
 
+  /*! Marks the cached string representation as out of date and lets the tree (if any) know
+      that the content hash changed.
+      \sa toString */
+  void invalidateStartTag();
+
+  /*! Returns "element's" opening tag up to (but excluding) the closing bracket, e.g. "<element attr="value"".
+      \sa toString */
+  static QString startTag( const QDomElement& element );
+
+  /*! Adds the first "length" characters of "text" (all of them if "length" is negative) to the
+      FNV-1a "hash".
+      \sa contentHash */
+  static void addToHash( quint64& hash, const QString& text, int length = -1 );
+
   QDomElement m_element;
   bool m_elementExcluded;
   bool m_verbose;
   int m_index;
 
+  mutable QString m_startTag;
+  mutable quint64 m_contentHash;
+  mutable bool m_startTagDirty;
+
   QStringList m_includedAttributes;
   QStringList m_incrementedAttributes;
   QHash< QString/*attr*/, QString /*val*/ > m_fixedValues;
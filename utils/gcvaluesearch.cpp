@@ -0,0 +1,87 @@
+/* Copyright (c) 2012 - 2013 by William Hallatt.
+ *
+ * This file forms part of "XML Mill".
+ *
+ * The official website for this project is <http://www.goblincoding.com> and,
+ * although not compulsory, it would be appreciated if all works of whatever
+ * nature using this source code (in whole or in part) include a reference to
+ * this site.
+ *
+ * Should you wish to contact me for whatever reason, please do so via:
+ *
+ *                 <http://www.goblincoding.com/contact>
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program (GNUGPL.txt).  If not, see
+ *
+ *                    <http://www.gnu.org/licenses/>
+ */
+
+#include "gcvaluesearch.h"
+#include "db/gcdatabaseinterface.h"
+
+#include <QLineEdit>
+#include <QCheckBox>
+#include <QListWidget>
+#include <QTimer>
+
+/*--------------------------------------------------------------------------------------*/
+
+/* The most search results we'll list (the user is expected to narrow down the search instead). */
+static const int SEARCH_RESULTS( 500 );
+
+/* How long the user has to stop typing before we search (in milliseconds). */
+static const int SEARCH_DELAY( 250 );
+
+/*--------------------------------------------------------------------------------------*/
+
+GCValueSearch::GCValueSearch( QLineEdit* lineEdit, QCheckBox* substringCheckBox, QListWidget* resultsList, QObject* parent )
+: QObject            ( parent ),
+  m_lineEdit         ( lineEdit ),
+  m_substringCheckBox( substringCheckBox ),
+  m_resultsList      ( resultsList ),
+  m_timer            ( new QTimer( this ) )
+{
+  m_timer->setSingleShot( true );
+  m_timer->setInterval( SEARCH_DELAY );
+
+  connect( m_timer, SIGNAL( timeout() ), this, SLOT( search() ) );
+  connect( m_lineEdit, SIGNAL( textChanged( QString ) ), this, SLOT( scheduleSearch() ) );
+  connect( m_substringCheckBox, SIGNAL( toggled( bool ) ), this, SLOT( scheduleSearch() ) );
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCValueSearch::scheduleSearch()
+{
+  m_timer->start();
+}
+
+/*--------------------------------------------------------------------------------------*/
+
+void GCValueSearch::search()
+{
+  m_resultsList->clear();
+
+  GCValueIndex::MatchMode mode = m_substringCheckBox->isChecked() ? GCValueIndex::SubstringMatch : GCValueIndex::PrefixMatch;
+  QList< GCValueMatch > matches = GCDataBaseInterface::instance()->findAttributeValues( m_lineEdit->text(), mode, SEARCH_RESULTS );
+
+  foreach( GCValueMatch match, matches )
+  {
+    QListWidgetItem* item = new QListWidgetItem( QString( "%1    [%2 : %3]" ).arg( match.value ).arg( match.element ).arg( match.attribute ) );
+    item->setData( Qt::UserRole, match.element );
+    item->setData( Qt::UserRole + 1, match.attribute );
+    m_resultsList->addItem( item );
+  }
+}
+
+/*--------------------------------------------------------------------------------------*/
\ No newline at end of file
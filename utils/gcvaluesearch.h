@@ -0,0 +1,74 @@
+/* Copyright (c) 2012 - 2013 by William Hallatt.
+ *
+ * This file forms part of "XML Mill".
+ *
+ * The official website for this project is <http://www.goblincoding.com> and,
+ * although not compulsory, it would be appreciated if all works of whatever
+ * nature using this source code (in whole or in part) include a reference to
+ * this site.
+ *
+ * Should you wish to contact me for whatever reason, please do so via:
+ *
+ *                 <http://www.goblincoding.com/contact>
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program (GNUGPL.txt).  If not, see
+ *
+ *                    <http://www.gnu.org/licenses/>
+ */
+
+#ifndef GCVALUESEARCH_H
+#define GCVALUESEARCH_H
+
+#include <QObject>
+
+class QLineEdit;
+class QCheckBox;
+class QListWidget;
+class QTimer;
+
+/// Lists the known attribute values matching a search box's text as the user types.
+
+/** Shared by the forms that let the user look up known attribute values.  The values matching the
+    line edit's text (anywhere in the value if the check box is checked, at the start otherwise) are
+    listed in the list widget along with their elements and attributes.  Each list item carries its
+    element (Qt::UserRole) and attribute (Qt::UserRole + 1).
+
+    The search only runs once the user pauses typing so that every keystroke doesn't trigger a
+    search of its own (the profile may know millions of values).
+*/
+class GCValueSearch : public QObject
+{
+Q_OBJECT
+
+public:
+  /*! Constructor.  Connects to "lineEdit" and "substringCheckBox" and lists the results in
+      "resultsList" (none of which are owned by this object). */
+  GCValueSearch( QLineEdit* lineEdit, QCheckBox* substringCheckBox, QListWidget* resultsList, QObject* parent );
+
+private slots:
+  /*! Triggered when the search text or match mode changes.  (Re)starts the search delay. */
+  void scheduleSearch();
+
+  /*! Triggered once the search delay expires.  Lists the known attribute values matching the
+      search text.
+      \sa GCDataBaseInterface::findAttributeValues */
+  void search();
+
+private:
+  QLineEdit* m_lineEdit;
+  QCheckBox* m_substringCheckBox;
+  QListWidget* m_resultsList;
+  QTimer* m_timer;
+};
+
+#endif // GCVALUESEARCH_H
\ No newline at end of file
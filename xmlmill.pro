@@ -32,7 +32,7 @@
 #
 #-------------------------------------------------
 
-QT       += core xml sql widgets
+QT       += core xml sql widgets concurrent
 
 TARGET = XMLMill
 TEMPLATE = app
@@ -41,6 +41,10 @@ SOURCES += main.cpp\
     db/gcdatabaseinterface.cpp \
     gcmainwindow.cpp \
     db/gcbatchprocessorhelper.cpp \    
+    db/gcprofilecache.cpp \
+    db/gcattributepolicy.cpp \
+    db/gcvalueindex.cpp \
+    db/gcdatabaseworker.cpp \
     xml/xmlsyntaxhighlighter.cpp \
     utils/gccombobox.cpp \
     utils/gcmessagespace.cpp \
@@ -54,12 +58,17 @@ SOURCES += main.cpp\
     utils/gcdomtreewidget.cpp \
     utils/gctreewidgetitem.cpp \
     forms/gcaddsnippetsform.cpp \
-    utils/gcplaintextedit.cpp
+    utils/gcplaintextedit.cpp \
+    utils/gcvaluesearch.cpp
 
 HEADERS  += \
     db/gcdatabaseinterface.h \
     gcmainwindow.h \
     db/gcbatchprocessorhelper.h \
+    db/gcprofilecache.h \
+    db/gcattributepolicy.h \
+    db/gcvalueindex.h \
+    db/gcdatabaseworker.h \
     xml/xmlsyntaxhighlighter.h \
     utils/gccombobox.h \
     utils/gcmessagespace.h \
@@ -73,7 +82,8 @@ HEADERS  += \
     utils/gcdomtreewidget.h \
     utils/gctreewidgetitem.h \
     forms/gcaddsnippetsform.h \
-    utils/gcplaintextedit.h
+    utils/gcplaintextedit.h \
+    utils/gcvaluesearch.h
 
 FORMS    += \
     gcmainwindow.ui \